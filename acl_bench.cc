@@ -9,8 +9,12 @@
 #include <iomanip>
 #include <string>
 #include <cstring>
+#include <limits>
+#include <memory>
 #include <vector>
 #include <utility>
+#include <algorithm>
+#include <random>
 
 #include <time.h>
 #include <sys/time.h>
@@ -22,18 +26,23 @@
 #include <netinet/in.h>
 
 #include "soft_tcam.h"
+#include "soft_tcam_scan.h"
+#include "soft_tcam_tuple.h"
+#include "soft_tcam_rfc.h"
 
 static const std::uint64_t bench_count = 100000000;
 static const std::uint64_t warmup_count = 1000;
+static const std::uint32_t bucket_size = 64;
+static const std::uint64_t trace_count = 1000000;
 
 class sequential_acl {
 public:
-	int insert(const std::bitset<32> &data, const std::bitset<32> &mask,
+	int insert(const std::uint32_t &data, const std::uint32_t &mask,
 			std::uint32_t priority, const std::uint32_t &object) {
-		acl.push_back(std::pair<std::bitset<32>, std::uint32_t>(data, object));
+		acl.push_back(std::pair<std::uint32_t, std::uint32_t>(data, object));
 		return 0;
 	}
-	const std::uint32_t *find(const std::bitset<32> &key) {
+	const std::uint32_t *find(const std::uint32_t &key) {
 		for (auto it = acl.begin(); it != acl.end(); ++it) {
 			if (it->first == key) {
 				return &it->second;
@@ -42,17 +51,17 @@ public:
 		return nullptr;
 	}
 private:
-	std::vector<std::pair<std::bitset<32>, std::uint32_t>> acl;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> acl;
 };
 
 static int
-load_acl(std::vector<std::bitset<32>> &acls, const char *acl_path, std::uint64_t count)
+load_acl(std::vector<std::uint32_t> &acls, const char *acl_path, std::uint64_t count)
 {
 	struct in_addr ina;
 	// struct in6_addr in6a;
 	std::ifstream acl_file;
 	std::string line;
-	std::bitset<32> k;
+	std::uint32_t k;
 
 	acl_file.open(acl_path);
 	if (acl_file.fail()) {
@@ -78,19 +87,148 @@ load_acl(std::vector<std::bitset<32>> &acls, const char *acl_path, std::uint64_t
 	return 0;
 }
 
+template<class table>
+static void
+bench_find(table &t, std::uint32_t k)
+{
+	/*
+	 * read through volatile so the lookup can not be hoisted out of the
+	 * loop when find is inlined.
+	 */
+	volatile std::uint32_t key = k;
+	const std::uint32_t *result;
+	struct rusage ru1, ru2;
+	std::uint64_t find_counter = 0;
+	double fps;
+
+	for (std::uint64_t i = 0; i < warmup_count; ++i) {
+		result = t.find(k);
+	}
+
+	getrusage(RUSAGE_SELF, &ru1);
+	for (std::uint64_t i = 0; i < bench_count; ++i) {
+		result = t.find(std::uint32_t(key));
+		if (result == nullptr) {
+			exit(1);
+		}
+		if (*result != k) {
+			std::cout << "miss-match " << *result << ":" << k << std::endl;
+			exit(1);
+		}
+		++find_counter;
+	}
+	getrusage(RUSAGE_SELF, &ru2);
+	timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
+	fps = ru2.ru_utime.tv_usec;
+	fps /= 1000000;
+	fps += ru2.ru_utime.tv_sec;
+	fps = find_counter / fps;
+	std::cout << "Find counter = " << find_counter << std::endl;
+	std::cout << "Find per second = " << std::fixed << fps << std::endl;
+}
+
+/*
+ * lookups drawn from acls with zipf(1) popularity, the popular entries
+ * spread over the list, like the few flows that carry most packets.
+ */
+static std::vector<std::uint32_t>
+make_skewed_trace(const std::vector<std::uint32_t> &acls, std::uint64_t count)
+{
+	std::vector<std::uint32_t> order(acls), trace;
+	std::vector<double> weights;
+	std::mt19937 rng(1);
+
+	std::shuffle(order.begin(), order.end(), rng);
+	for (std::uint64_t i = 0; i < order.size(); ++i) {
+		weights.push_back(1.0 / (i + 1));
+	}
+	std::discrete_distribution<std::uint64_t> popularity(weights.begin(), weights.end());
+	for (std::uint64_t i = 0; i < count; ++i) {
+		trace.push_back(order[popularity(rng)]);
+	}
+
+	return trace;
+}
+
+static void
+bench_trace(soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled> &t,
+		const std::vector<std::uint32_t> &trace, soft_tcam::soft_tcam_cache<std::uint32_t, 32> *cache)
+{
+	const std::uint32_t *result;
+	struct rusage ru1, ru2;
+	std::uint64_t find_counter = 0;
+	double fps;
+
+	getrusage(RUSAGE_SELF, &ru1);
+	while (find_counter < bench_count) {
+		for (auto it = trace.begin(); it != trace.end(); ++it) {
+			result = (cache != nullptr) ? t.find(*it, *cache) : t.find(*it);
+			if ((result == nullptr) || (*result != *it)) {
+				std::cout << "miss-match " << *it << std::endl;
+				exit(1);
+			}
+			++find_counter;
+		}
+	}
+	getrusage(RUSAGE_SELF, &ru2);
+	timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
+	fps = ru2.ru_utime.tv_usec;
+	fps /= 1000000;
+	fps += ru2.ru_utime.tv_sec;
+	fps = find_counter / fps;
+	std::cout << "Find counter = " << find_counter << std::endl;
+	std::cout << "Find per second = " << std::fixed << fps << std::endl;
+	if (cache != nullptr) {
+		std::cout << "Cache hits = " << cache->get_hit_counter()
+			  << ", misses = " << cache->get_miss_counter() << std::endl;
+	}
+}
+
+/*
+ * a move-only object is inserted with emplace() and erased without one.
+ */
+static void
+check_move_only(const std::vector<std::uint32_t> &acls)
+{
+	soft_tcam::soft_tcam<std::unique_ptr<std::uint32_t>, 32> t;
+	const std::unique_ptr<std::uint32_t> *result;
+	std::uint32_t priority;
+	std::uint64_t erased = 0;
+
+	priority = acls.size();
+	for (auto it = acls.begin(); it != acls.end(); ++it) {
+		t.emplace(*it, 0xffffffff, priority--, new std::uint32_t(*it));
+	}
+	priority = acls.size();
+	for (auto it = acls.begin(); it != acls.end(); ++it, --priority) {
+		if ((*it % 2) && (t.erase(*it, 0xffffffff, priority) == 0)) {
+			++erased;
+		}
+	}
+	for (auto it = acls.begin(); it != acls.end(); ++it) {
+		result = t.find(*it);
+		if ((*it % 2) ? (result != nullptr) : ((result == nullptr) || (**result != *it))) {
+			std::cout << "move-only miss-match " << *it << std::endl;
+			exit(1);
+		}
+	}
+	std::cout << "Move-only entries = " << acls.size() << ", erased without object = " << erased << std::endl;
+}
+
 int
 main(int argc, char *argv[])
 {
-	soft_tcam::soft_tcam<std::uint32_t, 32> *tcam;
+	soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled> *tcam;
+	soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled> *trie;
+	soft_tcam::soft_tcam_scan<std::uint32_t, 32> *scan;
+	soft_tcam::soft_tcam_snapshot<std::uint32_t, 32> snapshot;
+	soft_tcam::soft_tcam_tuple<std::uint32_t, 32> *tuple;
+	soft_tcam::soft_tcam_rfc<std::uint32_t, 32> rfc;
 	sequential_acl *sacl;
 	std::uint64_t priority;
-	std::vector<std::bitset<32>> acls;
-	const std::uint32_t *result;
-	struct rusage ru1, ru2;
-	std::uint64_t find_counter = 0;
+	std::vector<std::uint32_t> acls;
 	std::uint64_t load_num;
-	double fps;
-	std::bitset<32> k;
+	std::uint32_t k;
 
 	if (argc != 3) {
 		std::cout << std::endl
@@ -106,179 +244,152 @@ main(int argc, char *argv[])
 
 	load_num = atoi(argv[2]);
 	load_acl(acls, argv[1], load_num);
+	check_move_only(acls);
 
-	tcam = new soft_tcam::soft_tcam<std::uint32_t, 32>();
+	tcam = new soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>();
+	tcam->set_exact(true);
+	tcam->set_lpm(true);
 	priority = std::numeric_limits<std::uint64_t>::max();
 	for (auto it = acls.begin(); it != acls.end(); ++it) {
-		if (tcam->insert(*it, 0xffffffff, priority, it->to_ulong()) != 0) {
+		if (tcam->insert(*it, 0xffffffff, priority, *it) != 0) {
 			std::cout << "tcam load skip: " << *it << std::endl;
 			continue;
 		}
 		--priority;
 	}
 	std::cout << "Allocated soft_tcam_node = "
-		  << soft_tcam::soft_tcam_node<std::uint32_t, 32>::get_alloc_counter()
-		  << " ( " << (soft_tcam::soft_tcam_node<std::uint32_t, 32>::get_alloc_counter()
-					  * sizeof(soft_tcam::soft_tcam_node<std::uint32_t, 32>)) << " bytes)"
+		  << tcam->get_node_count()
+		  << " ( " << (tcam->get_node_count()
+					  * sizeof(soft_tcam::soft_tcam_node<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>)) << " bytes)"
 		  << std::endl;
 	std::cout << "Allocated soft_tcam_entry = "
-		  << soft_tcam::soft_tcam_entry<std::uint32_t, 32>::get_alloc_counter()
-		  << " ( " << (soft_tcam::soft_tcam_entry<std::uint32_t, 32>::get_alloc_counter()
-					  * sizeof(soft_tcam::soft_tcam_entry<std::uint32_t, 32>)) << " bytes)"
+		  << tcam->get_entry_count()
+		  << " ( " << (tcam->get_entry_count()
+					  * sizeof(soft_tcam::soft_tcam_entry<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>)) << " bytes)"
+		  << std::endl;
+	std::cout << "Exact match entries = " << tcam->get_exact_count() << std::endl;
+
+	/*
+	 * the same rules in the tree only, to compare with the exact match.
+	 */
+	trie = new soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>();
+	priority = std::numeric_limits<std::uint64_t>::max();
+	for (auto it = acls.begin(); it != acls.end(); ++it) {
+		if (trie->insert(*it, 0xffffffff, priority, *it) != 0) {
+			std::cout << "trie load skip: " << *it << std::endl;
+			continue;
+		}
+		--priority;
+	}
+	std::cout << "Allocated soft_tcam_node without exact match = "
+		  << trie->get_node_count()
+		  << " ( " << (trie->get_node_count()
+					  * sizeof(soft_tcam::soft_tcam_node<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>)) << " bytes)"
 		  << std::endl;
 
 	sacl = new sequential_acl;
 	priority = std::numeric_limits<std::uint64_t>::max();
 	for (auto it = acls.begin(); it != acls.end(); ++it) {
-		if (sacl->insert(*it, 0xffffffff, priority, it->to_ulong()) != 0) {
+		if (sacl->insert(*it, 0xffffffff, priority, *it) != 0) {
 			std::cout << "sacl load skip: " << *it << std::endl;
 			continue;
 		}
 		--priority;
 	}
 
-	{
-		std::cout << "### tcam && acl first entry" << std::endl;
-
-		k = *acls.begin();
-
-		soft_tcam::soft_tcam<std::uint32_t, 32>::clear_access_counter();
-		for (std::uint64_t i = 0; i < warmup_count; ++i) {
-			result = tcam->find(k);
-			++find_counter;
-		}
-		soft_tcam::soft_tcam<std::uint32_t, 32>::sort_best();
-		for (std::uint64_t i = 0; i < warmup_count; ++i) {
-			result = tcam->find(k);
-			++find_counter;
+	scan = new soft_tcam::soft_tcam_scan<std::uint32_t, 32>();
+	priority = std::numeric_limits<std::uint64_t>::max();
+	for (auto it = acls.begin(); it != acls.end(); ++it) {
+		if (scan->insert(*it, 0xffffffff, priority, *it) != 0) {
+			std::cout << "scan load skip: " << *it << std::endl;
+			continue;
 		}
+		--priority;
+	}
 
-		find_counter = 0;
-		getrusage(RUSAGE_SELF, &ru1);
-		for (std::uint64_t i = 0; i < bench_count; ++i) {
-			result = tcam->find(k);
-			if (result == nullptr) {
-				exit(1);
-			}
-			if (*result != k.to_ulong()) {
-				std::cout << "miss-match " << *result << ":" << k.to_ulong() << std::endl;
-				exit(1);
-			}
-			++find_counter;
+	tuple = new soft_tcam::soft_tcam_tuple<std::uint32_t, 32>();
+	priority = std::numeric_limits<std::uint64_t>::max();
+	for (auto it = acls.begin(); it != acls.end(); ++it) {
+		if (tuple->insert(*it, 0xffffffff, priority, *it) != 0) {
+			std::cout << "tuple load skip: " << *it << std::endl;
+			continue;
 		}
-		getrusage(RUSAGE_SELF, &ru2);
-		timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
-		fps = ru2.ru_utime.tv_usec;
-		fps /= 1000000;
-		fps += ru2.ru_utime.tv_sec;
-		fps = find_counter / fps;
-		std::cout << "Find counter = " << find_counter << std::endl;
-		std::cout << "Find per second = " << std::fixed << fps << std::endl;
+		--priority;
 	}
 
-	{
-		std::cout << "### tcam && acl last entry" << std::endl;
-
-		k = *(acls.end() - 1);
+	if (rfc.build(*tcam) != 0) {
+		std::cout << "rfc build failed." << std::endl;
+		exit(1);
+	}
+	std::cout << "Rfc tables = " << rfc.get_table_count()
+		  << " ( " << rfc.get_memory_size() << " bytes)"
+		  << std::endl;
 
-		soft_tcam::soft_tcam<std::uint32_t, 32>::clear_access_counter();
-		for (std::uint64_t i = 0; i < warmup_count; ++i) {
-			result = tcam->find(k);
-			++find_counter;
-		}
-		soft_tcam::soft_tcam<std::uint32_t, 32>::sort_best();
-		for (std::uint64_t i = 0; i < warmup_count; ++i) {
-			result = tcam->find(k);
-			++find_counter;
-		}
+	snapshot = tcam->compile(bucket_size);
+	std::cout << "Snapshot nodes = " << snapshot.get_node_count()
+		  << " ( " << snapshot.get_memory_size() << " bytes, bucket size " << bucket_size << ")"
+		  << std::endl;
 
-		find_counter = 0;
-		getrusage(RUSAGE_SELF, &ru1);
-		for (std::uint64_t i = 0; i < bench_count; ++i) {
-			result = tcam->find(k);
-			if (result == nullptr) {
-				exit(1);
-			}
-			if (*result != k.to_ulong()) {
-				std::cout << "miss-match " << *result << ":" << k.to_ulong() << std::endl;
-				exit(1);
-			}
-			++find_counter;
-		}
-		getrusage(RUSAGE_SELF, &ru2);
-		timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
-		fps = ru2.ru_utime.tv_usec;
-		fps /= 1000000;
-		fps += ru2.ru_utime.tv_sec;
-		fps = find_counter / fps;
-		std::cout << "Find counter = " << find_counter << std::endl;
-		std::cout << "Find per second = " << std::fixed << fps << std::endl;
+	/*
+	 * a realistic mix of keys rather than the same one over and over.
+	 */
+	std::vector<std::uint32_t> trace = make_skewed_trace(acls, trace_count);
+	for (int cached = 0; cached < 2; ++cached) {
+		soft_tcam::soft_tcam_cache<std::uint32_t, 32> cache;
+
+		std::cout << "### tcam && skewed trace, cache " << (cached ? "on" : "off") << std::endl;
+		bench_trace(*tcam, trace, cached ? &cache : nullptr);
+
+		std::cout << "### tcam(exact match, without lpm) && skewed trace, cache " << (cached ? "on" : "off") << std::endl;
+		tcam->set_lpm(false);
+		cache.clear_counter();
+		bench_trace(*tcam, trace, cached ? &cache : nullptr);
+		tcam->set_lpm(true);
+
+		std::cout << "### tcam(tree only) && skewed trace, cache " << (cached ? "on" : "off") << std::endl;
+		cache.clear_counter();
+		bench_trace(*trie, trace, cached ? &cache : nullptr);
 	}
 
-	{
-		std::cout << "### sacl && acl first entry" << std::endl;
-
-		k = *acls.begin();
+	for (int last = 0; last < 2; ++last) {
+		k = last ? *(acls.end() - 1) : *acls.begin();
 
+		std::cout << "### tcam && acl " << (last ? "last" : "first") << " entry" << std::endl;
+		soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>::clear_access_counter();
 		for (std::uint64_t i = 0; i < warmup_count; ++i) {
-			result = sacl->find(k);
-			++find_counter;
+			tcam->find(k);
 		}
+		soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>::sort_best();
+		bench_find(*tcam, k);
 
-		find_counter = 0;
-		getrusage(RUSAGE_SELF, &ru1);
-		for (std::uint64_t i = 0; i < bench_count; ++i) {
-			result = sacl->find(k);
-			if (result == nullptr) {
-				exit(1);
-			}
-			if (*result != k.to_ulong()) {
-				std::cout << "miss-match " << *result << ":" << k.to_ulong() << std::endl;
-				exit(1);
-			}
-			++find_counter;
+		std::cout << "### tcam(exact match, without lpm) && acl " << (last ? "last" : "first") << " entry" << std::endl;
+		tcam->set_lpm(false);
+		bench_find(*tcam, k);
+		tcam->set_lpm(true);
+
+		std::cout << "### tcam(tree only) && acl " << (last ? "last" : "first") << " entry" << std::endl;
+		soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>::clear_access_counter();
+		for (std::uint64_t i = 0; i < warmup_count; ++i) {
+			trie->find(k);
 		}
-		getrusage(RUSAGE_SELF, &ru2);
-		timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
-		fps = ru2.ru_utime.tv_usec;
-		fps /= 1000000;
-		fps += ru2.ru_utime.tv_sec;
-		fps = find_counter / fps;
-		std::cout << "Find counter = " << find_counter << std::endl;
-		std::cout << "Find per second = " << std::fixed << fps << std::endl;
-	}
+		soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>::sort_best();
+		bench_find(*trie, k);
 
-	{
-		std::cout << "### sacl && acl last entry" << std::endl;
+		std::cout << "### scan(" << soft_tcam::soft_tcam_scan_kernel<32>::get_name() << ") && acl "
+			  << (last ? "last" : "first") << " entry" << std::endl;
+		bench_find(*scan, k);
 
-		k = *(acls.end() - 1);
+		std::cout << "### snapshot(bucket) && acl " << (last ? "last" : "first") << " entry" << std::endl;
+		bench_find(snapshot, k);
 
-		for (std::uint64_t i = 0; i < warmup_count; ++i) {
-			result = sacl->find(k);
-			++find_counter;
-		}
+		std::cout << "### tuple && acl " << (last ? "last" : "first") << " entry" << std::endl;
+		bench_find(*tuple, k);
 
-		find_counter = 0;
-		getrusage(RUSAGE_SELF, &ru1);
-		for (std::uint64_t i = 0; i < bench_count; ++i) {
-			result = sacl->find(k);
-			if (result == nullptr) {
-				exit(1);
-			}
-			if (*result != k.to_ulong()) {
-				std::cout << "miss-match " << *result << ":" << k.to_ulong() << std::endl;
-				exit(1);
-			}
-			++find_counter;
-		}
-		getrusage(RUSAGE_SELF, &ru2);
-		timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
-		fps = ru2.ru_utime.tv_usec;
-		fps /= 1000000;
-		fps += ru2.ru_utime.tv_sec;
-		fps = find_counter / fps;
-		std::cout << "Find counter = " << find_counter << std::endl;
-		std::cout << "Find per second = " << std::fixed << fps << std::endl;
+		std::cout << "### rfc && acl " << (last ? "last" : "first") << " entry" << std::endl;
+		bench_find(rfc, k);
+
+		std::cout << "### sacl && acl " << (last ? "last" : "first") << " entry" << std::endl;
+		bench_find(*sacl, k);
 	}
 
 }
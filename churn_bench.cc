@@ -0,0 +1,273 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "soft_tcam.h"
+
+typedef soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled> table;
+
+static const std::uint64_t bench_count = 2000000;
+static const std::uint32_t default_rounds = 20;
+static const std::uint32_t default_updates = 100000;
+
+/*
+ * a route of the full route file. its object is its address, as in
+ * fullroute_bench, so that erase can find it again.
+ */
+struct route {
+	std::uint32_t data;
+	std::uint32_t mask;
+	std::uint32_t priority;
+};
+
+static int
+load_routes(std::vector<route> &routes, const char *fullroute_path)
+{
+	struct in_addr ina;
+	std::ifstream fullroute_file;
+	std::string line;
+	char buf[1024 + 1];
+	char *plens;
+	int plen;
+	route r;
+
+	fullroute_file.open(fullroute_path);
+	if (fullroute_file.fail()) {
+		std::cout << fullroute_path <<  " open failed." << std::endl;
+		exit(1);
+	}
+
+	std::cout << "Loading fullroute...";
+	std::cout.flush();
+
+	while (getline(fullroute_file, line)) {
+		if (line.length() >= 1024) {
+			std::cout << "skip: " << line << std::endl;
+			continue;
+		}
+		std::strcpy(buf, line.c_str());
+		std::strtok(buf, "/");
+		plens = std::strtok(nullptr, "/");
+		if (plens == nullptr) {
+			std::cout << "skip: " << line << std::endl;
+			continue;
+		}
+		plen = atoi(plens);
+		if ((plen < 0) || (plen > 32) || (inet_pton(AF_INET, buf, &ina) <= 0)) {
+			std::cout << "skip: " << line << std::endl;
+			continue;
+		}
+		r.mask = (plen == 0) ? 0 : (0xffffffff << (32 - plen));
+		r.data = ntohl(ina.s_addr) & r.mask;
+		r.priority = plen;
+		routes.push_back(r);
+	}
+
+	std::cout << "done." << std::endl;
+
+	return 0;
+}
+
+static int
+load_flow(std::vector<std::uint32_t> &flows, const char *flow_path)
+{
+	struct in_addr ina;
+	std::ifstream flow_file;
+	std::string line;
+	std::uint32_t k;
+
+	flow_file.open(flow_path);
+	if (flow_file.fail()) {
+		std::cout << flow_path << " open failed." << std::endl;
+		exit(1);
+	}
+
+	std::cout << "Loading flow...";
+	std::cout.flush();
+
+	while (getline(flow_file, line)) {
+		if (inet_pton(AF_INET, line.c_str(), &ina) <= 0) {
+			std::cout << "skip: " << line << std::endl;
+			continue;
+		}
+		k = ntohl(ina.s_addr);
+		flows.push_back(k);
+	}
+
+	std::cout << "done." << std::endl;
+
+	return 0;
+}
+
+static double
+per_second(struct rusage &ru1, struct rusage &ru2, std::uint64_t counter)
+{
+	double s;
+
+	timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
+	s = ru2.ru_utime.tv_usec;
+	s /= 1000000;
+	s += ru2.ru_utime.tv_sec;
+
+	return (s > 0) ? counter / s : 0;
+}
+
+static double
+bench_flows(table &tcam, std::vector<std::uint32_t> &flows)
+{
+	const std::uint32_t * volatile result = nullptr;
+	struct rusage ru1, ru2;
+	std::uint64_t find_counter = 0;
+
+	getrusage(RUSAGE_SELF, &ru1);
+
+	while (find_counter < bench_count) {
+		for (std::uint64_t i = 0; i < flows.size(); ++i) {
+			result = tcam.find(flows[i]);
+			++find_counter;
+		}
+	}
+	(void)result;
+
+	getrusage(RUSAGE_SELF, &ru2);
+
+	return per_second(ru1, ru2, find_counter);
+}
+
+static double
+visited_per_find(table &tcam, std::vector<std::uint32_t> &flows)
+{
+	tcam.clear_visit_counter();
+	for (auto it = flows.begin(); it != flows.end(); ++it) {
+		tcam.find(*it);
+	}
+
+	return (double)tcam.get_visit_counter() / flows.size();
+}
+
+static void
+print_state(const std::string &name, table &tcam, std::vector<std::uint32_t> &flows)
+{
+	std::cout << name
+		  << ": nodes = " << tcam.get_node_count()
+		  << ", entries = " << tcam.get_entry_count() + tcam.get_exact_count()
+		  << ", visited nodes per find = " << std::fixed << std::setprecision(2)
+		  << visited_per_find(tcam, flows)
+		  << ", find per second = " << bench_flows(tcam, flows)
+		  << std::endl;
+}
+
+int
+main(int argc, char *argv[])
+{
+	table *tcam;
+	std::vector<route> routes;
+	std::vector<std::uint32_t> flows;
+	std::vector<std::uint32_t> announced, withdrawn;
+	std::uint32_t rounds = default_rounds, updates = default_updates;
+	std::mt19937 rng(1);
+	struct rusage ru1, ru2;
+
+	if ((argc < 3) || (argc > 5)) {
+		std::cout << std::endl
+			  << "usage:" << std::endl
+			  << "        $ " << argv[0] << " fullroute learningflow [rounds [updates]]" << std::endl
+			  << std::endl
+			  << "where:" << std::endl
+			  << "      fullroute := Containing full route file (Ex. fullroute.sample)" << std::endl
+			  << "   learningflow := Containing learing flow file (Ex. learningflow.sample)" << std::endl
+			  << "         rounds := Number of rounds (default: " << default_rounds << ")" << std::endl
+			  << "        updates := Withdrawals and announcements per round (default: "
+			  << default_updates << ")" << std::endl
+			  << std::endl;
+		exit(1);
+	}
+	if (argc >= 4) {
+		rounds = atoi(argv[3]);
+	}
+	if (argc >= 5) {
+		updates = atoi(argv[4]);
+	}
+
+	load_routes(routes, argv[1]);
+	load_flow(flows, argv[2]);
+	if (routes.size() < 10 || flows.empty()) {
+		std::cout << "too few routes or flows" << std::endl;
+		exit(1);
+	}
+
+	/*
+	 * nine in ten routes are announced at first. every update withdraws
+	 * a random announced route and announces a random withdrawn one, so
+	 * the table keeps its size while its shape changes.
+	 */
+	for (std::uint32_t i = 0; i < routes.size(); ++i) {
+		announced.push_back(i);
+	}
+	std::shuffle(announced.begin(), announced.end(), rng);
+	withdrawn.assign(announced.begin() + announced.size() * 9 / 10, announced.end());
+	announced.resize(announced.size() * 9 / 10);
+
+	tcam = new table();
+	for (auto it = announced.begin(); it != announced.end(); ++it) {
+		const route &r = routes[*it];
+		tcam->insert(r.data, r.mask, r.priority, r.data);
+	}
+	print_state("Round 0", *tcam, flows);
+
+	for (std::uint32_t round = 1; round <= rounds; ++round) {
+		getrusage(RUSAGE_SELF, &ru1);
+		for (std::uint32_t i = 0; i < updates; ++i) {
+			std::uint32_t a = rng() % announced.size();
+			std::uint32_t w = rng() % withdrawn.size();
+			const route &ra = routes[announced[a]];
+			const route &rw = routes[withdrawn[w]];
+			if (tcam->erase(ra.data, ra.mask, ra.priority, ra.data) != 0) {
+				std::cout << "erase error" << std::endl;
+				exit(1);
+			}
+			if (tcam->insert(rw.data, rw.mask, rw.priority, rw.data) != 0) {
+				std::cout << "insert error" << std::endl;
+				exit(1);
+			}
+			std::swap(announced[a], withdrawn[w]);
+		}
+		getrusage(RUSAGE_SELF, &ru2);
+		std::cout << "Updates per second = " << std::fixed << std::setprecision(2)
+			  << per_second(ru1, ru2, 2 * std::uint64_t(updates)) << ", ";
+		print_state("Round " + std::to_string(round), *tcam, flows);
+	}
+
+	/*
+	 * the same routes inserted into a new table, which the churned table
+	 * should match.
+	 */
+	delete tcam;
+	tcam = new table();
+	for (auto it = announced.begin(); it != announced.end(); ++it) {
+		const route &r = routes[*it];
+		tcam->insert(r.data, r.mask, r.priority, r.data);
+	}
+	print_state("Rebuilt", *tcam, flows);
+	delete tcam;
+
+	return 0;
+}
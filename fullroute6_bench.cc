@@ -0,0 +1,397 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <bitset>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "soft_tcam.h"
+#include "soft_tcam_tuple.h"
+#include "soft_tcam_lpm.h"
+
+typedef soft_tcam::soft_tcam<std::uint32_t, 128, soft_tcam::soft_tcam_counter_enabled> tcam_type;
+typedef soft_tcam::soft_tcam_bits<128> bits_type;
+typedef bits_type::key_type key_type;
+
+static const std::uint64_t bench_count = 10000000;
+static const std::uint64_t batch_size = 64;
+static const std::uint32_t max_stride = 8;
+
+static key_type
+to_key(const struct in6_addr &in6a)
+{
+	key_type key = key_type();
+
+	for (std::uint32_t i = 0; i < 128; ++i) {
+		if ((in6a.s6_addr[i / 8] >> (7 - i % 8)) & 1) {
+			bits_type::set(key, 127 - i);
+		}
+	}
+
+	return key;
+}
+
+template<class table>
+static int
+load_fullroute6(table &tcam, const char *fullroute_path)
+{
+	struct in6_addr in6a;
+	std::ifstream fullroute_file;
+	std::string line;
+	char buf[1024 + 1];
+	char *plens;
+	int plen;
+	std::uint32_t index = 0;
+
+	fullroute_file.open(fullroute_path);
+	if (fullroute_file.fail()) {
+		std::cout << fullroute_path <<  " open failed." << std::endl;
+		exit(1);
+	}
+
+	std::cout << "Loading fullroute...";
+	std::cout.flush();
+
+	while (getline(fullroute_file, line)) {
+		if (line.length() >= 1024) {
+			std::cout << "skip: " << line << std::endl;
+			continue;
+		}
+		std::strcpy(buf, line.c_str());
+		std::strtok(buf, "/");
+		plens = std::strtok(nullptr, "/");
+		if (plens == nullptr) {
+			std::cout << "skip: " << line << std::endl;
+			continue;
+		}
+		plen = atoi(plens);
+		if ((plen < 0) || (plen > 128) || (inet_pton(AF_INET6, buf, &in6a) <= 0)) {
+			std::cout << "skip: " << line << std::endl;
+			continue;
+		}
+		if (tcam.insert(to_key(in6a), bits_type::prefix_mask(plen), plen, index) != 0) {
+			std::cout << "skip: " << line << std::endl;
+			continue;
+		}
+		++index;
+	}
+
+	std::cout << "done." << std::endl;
+
+	return 0;
+}
+
+static int
+load_flow6(std::vector<key_type> &flows, const char *flow_path)
+{
+	struct in6_addr in6a;
+	std::ifstream flow_file;
+	std::string line;
+
+	flow_file.open(flow_path);
+	if (flow_file.fail()) {
+		std::cout << flow_path << " open failed." << std::endl;
+		exit(1);
+	}
+
+	std::cout << "Loading flow...";
+	std::cout.flush();
+
+	while (getline(flow_file, line)) {
+		if (inet_pton(AF_INET6, line.c_str(), &in6a) <= 0) {
+			std::cout << "skip: " << line << std::endl;
+			continue;
+		}
+		flows.push_back(to_key(in6a));
+	}
+
+	std::cout << "done." << std::endl;
+
+	return 0;
+}
+
+static double
+find_per_second(struct rusage &ru1, struct rusage &ru2, std::uint64_t find_counter)
+{
+	double fps;
+
+	timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
+	fps = ru2.ru_utime.tv_usec;
+	fps /= 1000000;
+	fps += ru2.ru_utime.tv_sec;
+	fps = find_counter / fps;
+
+	return fps;
+}
+
+static double
+bench_flows(tcam_type &tcam, std::vector<key_type> &flows, bool batch)
+{
+	std::vector<const std::uint32_t *> results(flows.size());
+	struct rusage ru1, ru2;
+	std::uint64_t find_counter = 0;
+
+	getrusage(RUSAGE_SELF, &ru1);
+
+	while (find_counter < bench_count) {
+		if (batch) {
+			for (std::uint64_t i = 0; i < flows.size(); i += batch_size) {
+				std::uint64_t n = std::min<std::uint64_t>(batch_size, flows.size() - i);
+				tcam.find_batch(&flows[i], n, &results[i]);
+				find_counter += n;
+			}
+		} else {
+			for (std::uint64_t i = 0; i < flows.size(); ++i) {
+				results[i] = tcam.find(flows[i]);
+				++find_counter;
+			}
+		}
+	}
+
+	getrusage(RUSAGE_SELF, &ru2);
+
+	return find_per_second(ru1, ru2, find_counter);
+}
+
+template<class table>
+static double
+bench_table(const table &t, std::vector<key_type> &flows)
+{
+	std::vector<const std::uint32_t *> results(flows.size());
+	struct rusage ru1, ru2;
+	std::uint64_t find_counter = 0;
+
+	getrusage(RUSAGE_SELF, &ru1);
+
+	while (find_counter < bench_count) {
+		for (std::uint64_t i = 0; i < flows.size(); ++i) {
+			results[i] = t.find(flows[i]);
+			++find_counter;
+		}
+	}
+
+	getrusage(RUSAGE_SELF, &ru2);
+
+	return find_per_second(ru1, ru2, find_counter);
+}
+
+/*
+ * dTLB read misses per lookup over the flows, counted by a perf event of
+ * this thread. "n/a" when the event cannot be opened.
+ */
+template<class table>
+static std::string
+bench_dtlb(table &t, std::vector<key_type> &flows)
+{
+	struct perf_event_attr attr;
+	const std::uint32_t * volatile result = nullptr;
+	std::uint64_t misses;
+	std::ostringstream os;
+	int fd;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = PERF_COUNT_HW_CACHE_DTLB
+		| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+		| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (fd < 0) {
+		return "n/a";
+	}
+
+	ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	for (std::uint64_t i = 0; i < flows.size(); ++i) {
+		result = t.find(flows[i]);
+	}
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	(void)result;
+	if (read(fd, &misses, sizeof(misses)) != sizeof(misses)) {
+		close(fd);
+		return "n/a";
+	}
+	close(fd);
+
+	os << std::fixed << std::setprecision(3) << (double)misses / flows.size();
+
+	return os.str();
+}
+
+int
+main(int argc, char *argv[])
+{
+	tcam_type *tcam;
+	std::vector<key_type> flows;
+	std::uint64_t misses = 0;
+
+	if ((argc != 3) && (argc != 4)) {
+		std::cout << std::endl
+			  << "usage:" << std::endl
+			  << "        $ " << argv[0] << " fullroute6 learningflow6 [order]" << std::endl
+			  << std::endl
+			  << "where:" << std::endl
+			  << "     fullroute6 := Containing IPv6 full route file, one prefix per line (Ex. 2001:db8::/32)" << std::endl
+			  << "  learningflow6 := Containing IPv6 learning flow file, one address per line" << std::endl
+			  << "          order := [ \"lsb\" | \"msb\" | \"learn\" ] (default: msb)" << std::endl
+			  << std::endl;
+		exit(1);
+	}
+
+	tcam = new tcam_type();
+
+	if ((argc == 3) || !strncmp(argv[3], "msb", 4)) {
+		tcam->set_order(soft_tcam::soft_tcam_order<128>::msb_first());
+	} else if (strncmp(argv[3], "lsb", 4) && strncmp(argv[3], "learn", 6)) {
+		std::cout << "order arg error" << std::endl;
+		exit(1);
+	}
+
+	load_fullroute6(*tcam, argv[1]);
+	load_flow6(flows, argv[2]);
+
+	if ((argc == 4) && !strncmp(argv[3], "learn", 6)) {
+		std::cout << "Learning order...";
+		std::cout.flush();
+		tcam->learn_order();
+		std::cout << "done." << std::endl;
+	}
+
+	std::cout << "Allocated soft_tcam_node = "
+		  << tcam->get_node_count()
+		  << " ( " << (tcam->get_node_count()
+			* (sizeof(soft_tcam::soft_tcam_node<std::uint32_t, 128, soft_tcam::soft_tcam_counter_enabled>)
+			 + sizeof(soft_tcam::soft_tcam_node_cold<std::uint32_t, 128, soft_tcam::soft_tcam_counter_enabled>))) << " bytes)"
+		  << std::endl;
+	std::cout << "Allocated soft_tcam_entry = "
+		  << tcam->get_entry_count()
+		  << " ( " << (tcam->get_entry_count()
+			* sizeof(soft_tcam::soft_tcam_entry<std::uint32_t, 128, soft_tcam::soft_tcam_counter_enabled>)) << " bytes)"
+		  << std::endl;
+	std::cout << "Masks = " << tcam->get_mask_count() << std::endl;
+
+	if (flows.empty()) {
+		return 0;
+	}
+
+	tcam->clear_visit_counter();
+	for (auto it = flows.begin(); it != flows.end(); ++it) {
+		if (tcam->find(*it) == nullptr) {
+			++misses;
+		}
+	}
+	std::cout << "Visited nodes per find = "
+		  << std::fixed << std::setprecision(2)
+		  << (double)tcam->get_visit_counter() / flows.size()
+		  << ", flows without a route = " << misses
+		  << std::endl;
+
+	std::cout << "Find per second (learningflow, one at a time) = "
+		  << std::fixed << bench_flows(*tcam, flows, false)
+		  << std::endl;
+	std::cout << "Find per second (learningflow, batch of " << batch_size << ") = "
+		  << std::fixed << bench_flows(*tcam, flows, true)
+		  << std::endl;
+
+	soft_tcam::soft_tcam_snapshot<std::uint32_t, 128> snapshot = tcam->compile();
+	std::cout << "Compiled snapshot = "
+		  << snapshot.get_node_count()
+		  << " ( " << snapshot.get_memory_size() << " bytes, depth "
+		  << snapshot.get_depth() << ")"
+		  << std::endl;
+	std::cout << "Find per second (learningflow, snapshot) = "
+		  << std::fixed << bench_table(snapshot, flows)
+		  << std::endl;
+
+	soft_tcam::soft_tcam_snapshot<std::uint32_t, 128> multibit = tcam->compile(0, max_stride);
+	std::cout << "Compiled multibit snapshot = "
+		  << multibit.get_node_count()
+		  << " ( " << multibit.get_memory_size() << " bytes, depth "
+		  << multibit.get_depth() << ", max stride " << max_stride << ")"
+		  << std::endl;
+	std::cout << "Find per second (learningflow, multibit snapshot) = "
+		  << std::fixed << bench_table(multibit, flows)
+		  << std::endl;
+
+	/*
+	 * the same tree and multibit snapshot in 2 MiB pages.
+	 */
+	std::cout << "dTLB misses per find (learningflow) = "
+		  << bench_dtlb(*tcam, flows)
+		  << std::endl;
+	std::cout << "dTLB misses per find (learningflow, multibit snapshot) = "
+		  << bench_dtlb(multibit, flows)
+		  << std::endl;
+	tcam->set_huge_pages(true);
+	std::cout << "Find per second (learningflow, one at a time, huge pages) = "
+		  << std::fixed << bench_flows(*tcam, flows, false)
+		  << std::endl;
+	std::cout << "dTLB misses per find (learningflow, huge pages) = "
+		  << bench_dtlb(*tcam, flows)
+		  << std::endl;
+	soft_tcam::soft_tcam_snapshot<std::uint32_t, 128> multibit_huge = tcam->compile(0, max_stride);
+	std::cout << "Find per second (learningflow, multibit snapshot, huge pages) = "
+		  << std::fixed << bench_table(multibit_huge, flows)
+		  << std::endl;
+	std::cout << "dTLB misses per find (learningflow, multibit snapshot, huge pages) = "
+		  << bench_dtlb(multibit_huge, flows)
+		  << std::endl;
+	tcam->set_huge_pages(false);
+
+	{
+		soft_tcam::soft_tcam_tuple<std::uint32_t, 128> tuple(true);
+		load_fullroute6(tuple, argv[1]);
+		std::cout << "Tuples = "
+			  << tuple.get_tuple_count()
+			  << " ( " << tuple.get_memory_size() << " bytes)"
+			  << std::endl;
+		std::cout << "Find per second (learningflow, tuple + bloom) = "
+			  << std::fixed << bench_table(tuple, flows)
+			  << std::endl;
+	}
+
+	for (std::uint32_t group_bits : {8, 4}) {
+		soft_tcam::soft_tcam_lpm<std::uint32_t, 128> lpm(16, group_bits);
+		load_fullroute6(lpm, argv[1]);
+		std::cout << "Lpm 16-" << group_bits << " routes = "
+			  << lpm.get_route_count()
+			  << ", groups = " << lpm.get_group_count()
+			  << " ( " << lpm.get_memory_size() << " bytes)"
+			  << std::endl;
+		std::cout << "Find per second (learningflow, lpm 16-" << group_bits << ") = "
+			  << std::fixed << bench_table(lpm, flows)
+			  << std::endl;
+	}
+
+	tcam->set_lpm(true);
+	std::cout << "Find per second (learningflow, soft_tcam with lpm"
+		  << (tcam->is_lpm() ? "" : " not used") << ") = "
+		  << std::fixed << bench_flows(*tcam, flows, false)
+		  << std::endl;
+
+	return 0;
+}
@@ -8,11 +8,19 @@
 #include <fstream>
 #include <iomanip>
 #include <string>
+#include <sstream>
 #include <cstring>
+#include <vector>
+#include <algorithm>
+#include <random>
 
 #include <time.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -20,12 +28,19 @@
 #include <netinet/in.h>
 
 #include "soft_tcam.h"
+#include "soft_tcam_tuple.h"
+#include "soft_tcam_lpm.h"
 
 static const std::uint64_t bench_count = 10000000;
 static const std::uint64_t warmup_count = 1000;
+static const std::uint64_t batch_size = 64;
+static const std::uint32_t max_stride = 8;
+static const size_t dag_max_nodes = 1 << 22;
+static const std::uint64_t trace_count = 1000000;
 
+template<class table>
 static int
-load_fullroute(soft_tcam::soft_tcam<std::uint32_t, 32> &tcam, const char *fullroute_path)
+load_fullroute(table &tcam, const char *fullroute_path)
 {
 	struct in_addr ina;
 	// struct in6_addr in6a;
@@ -34,7 +49,7 @@ load_fullroute(soft_tcam::soft_tcam<std::uint32_t, 32> &tcam, const char *fullro
 	char buf[1024 + 1];
 	char *plens;
 	int plen;
-	std::bitset<32> d, m;
+	std::uint32_t d, m;
 
 	fullroute_file.open(fullroute_path);
 	if (fullroute_file.fail()) {
@@ -67,7 +82,7 @@ load_fullroute(soft_tcam::soft_tcam<std::uint32_t, 32> &tcam, const char *fullro
 			continue;
 		}
 		d = ntohl(ina.s_addr);
-		m = (0xffffffff << (32 - plen));
+		m = (plen == 0) ? 0 : (0xffffffff << (32 - plen));
 		if (tcam.insert(d, m, plen, ntohl(ina.s_addr)) != 0) {
 			std::cout << "skip: " << line << std::endl;
 			continue;
@@ -80,13 +95,13 @@ load_fullroute(soft_tcam::soft_tcam<std::uint32_t, 32> &tcam, const char *fullro
 }
 
 static int
-load_flow(std::vector<std::bitset<32>> &flows, const char *flow_path)
+load_flow(std::vector<std::uint32_t> &flows, const char *flow_path)
 {
 	struct in_addr ina;
 	// struct in6_addr in6a;
 	std::ifstream flow_file;
 	std::string line;
-	std::bitset<32> k;
+	std::uint32_t k;
 
 	flow_file.open(flow_path);
 	if (flow_file.fail()) {
@@ -111,56 +126,259 @@ load_flow(std::vector<std::bitset<32>> &flows, const char *flow_path)
 	return 0;
 }
 
+/*
+ * lookups drawn from flows with zipf(1) popularity, the popular flows
+ * spread over the list, like the few flows that carry most packets.
+ */
+static std::vector<std::uint32_t>
+make_skewed_trace(const std::vector<std::uint32_t> &flows, std::uint64_t count)
+{
+	std::vector<std::uint32_t> order(flows), trace;
+	std::vector<double> weights;
+	std::mt19937 rng(1);
+
+	std::shuffle(order.begin(), order.end(), rng);
+	for (std::uint64_t i = 0; i < order.size(); ++i) {
+		weights.push_back(1.0 / (i + 1));
+	}
+	std::discrete_distribution<std::uint64_t> popularity(weights.begin(), weights.end());
+	for (std::uint64_t i = 0; i < count; ++i) {
+		trace.push_back(order[popularity(rng)]);
+	}
+
+	return trace;
+}
+
+static double
+find_per_second(struct rusage &ru1, struct rusage &ru2, std::uint64_t find_counter)
+{
+	double fps;
+
+	timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
+	fps = ru2.ru_utime.tv_usec;
+	fps /= 1000000;
+	fps += ru2.ru_utime.tv_sec;
+	fps = find_counter / fps;
+
+	return fps;
+}
+
+enum bench_mode {
+	bench_mode_single,
+	bench_mode_batch,
+	bench_mode_bulk,
+	bench_mode_cache,
+};
+
+static double
+bench_flows(soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled> &tcam,
+		std::vector<std::uint32_t> &flows, bench_mode mode,
+		soft_tcam::soft_tcam_cache<std::uint32_t, 32> *cache = nullptr)
+{
+	std::vector<const std::uint32_t *> results(flows.size());
+	struct rusage ru1, ru2;
+	std::uint64_t find_counter = 0;
+
+	getrusage(RUSAGE_SELF, &ru1);
+
+	while (find_counter < bench_count) {
+		if (mode == bench_mode_bulk) {
+			tcam.find_bulk(flows.data(), flows.size(), results.data());
+			find_counter += flows.size();
+		} else if (mode == bench_mode_batch) {
+			for (std::uint64_t i = 0; i < flows.size(); i += batch_size) {
+				std::uint64_t n = std::min<std::uint64_t>(batch_size, flows.size() - i);
+				tcam.find_batch(&flows[i], n, &results[i]);
+				find_counter += n;
+			}
+		} else if (mode == bench_mode_cache) {
+			for (std::uint64_t i = 0; i < flows.size(); ++i) {
+				results[i] = tcam.find(flows[i], *cache);
+				++find_counter;
+			}
+		} else {
+			for (std::uint64_t i = 0; i < flows.size(); ++i) {
+				results[i] = tcam.find(flows[i]);
+				++find_counter;
+			}
+		}
+	}
+
+	getrusage(RUSAGE_SELF, &ru2);
+
+	return find_per_second(ru1, ru2, find_counter);
+}
+
+template<class table>
+static double
+bench_table(const table &t, std::vector<std::uint32_t> &flows)
+{
+	std::vector<const std::uint32_t *> results(flows.size());
+	struct rusage ru1, ru2;
+	std::uint64_t find_counter = 0;
+
+	getrusage(RUSAGE_SELF, &ru1);
+
+	while (find_counter < bench_count) {
+		for (std::uint64_t i = 0; i < flows.size(); ++i) {
+			results[i] = t.find(flows[i]);
+			++find_counter;
+		}
+	}
+
+	getrusage(RUSAGE_SELF, &ru2);
+
+	return find_per_second(ru1, ru2, find_counter);
+}
+
+/*
+ * dTLB read misses per lookup over the flows, counted by a perf event of
+ * this thread. "n/a" when the event cannot be opened.
+ */
+template<class table>
+static std::string
+bench_dtlb(table &t, std::vector<std::uint32_t> &flows)
+{
+	struct perf_event_attr attr;
+	const std::uint32_t * volatile result = nullptr;
+	std::uint64_t misses;
+	std::ostringstream os;
+	int fd;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = PERF_COUNT_HW_CACHE_DTLB
+		| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+		| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (fd < 0) {
+		return "n/a";
+	}
+
+	ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	for (std::uint64_t i = 0; i < flows.size(); ++i) {
+		result = t.find(flows[i]);
+	}
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	(void)result;
+	if (read(fd, &misses, sizeof(misses)) != sizeof(misses)) {
+		close(fd);
+		return "n/a";
+	}
+	close(fd);
+
+	os << std::fixed << std::setprecision(3) << (double)misses / flows.size();
+
+	return os.str();
+}
+
+/*
+ * p50 and p99 of the time of one lookup over the flows, in nanoseconds.
+ * the clock is read around every lookup, so the times include its cost.
+ */
+template<class table>
+static std::string
+bench_latency(const table &t, std::vector<std::uint32_t> &flows)
+{
+	std::vector<double> times;
+	struct timespec ts1, ts2;
+	const std::uint32_t * volatile result = nullptr;
+
+	for (std::uint64_t i = 0; i < flows.size(); ++i) {
+		clock_gettime(CLOCK_MONOTONIC, &ts1);
+		result = t.find(flows[i]);
+		clock_gettime(CLOCK_MONOTONIC, &ts2);
+		times.push_back((ts2.tv_sec - ts1.tv_sec) * 1000000000.0 + (ts2.tv_nsec - ts1.tv_nsec));
+	}
+	(void)result;
+	std::sort(times.begin(), times.end());
+
+	return std::to_string(std::uint64_t(times[times.size() / 2])) + ", "
+		+ std::to_string(std::uint64_t(times[times.size() * 99 / 100]));
+}
+
 int
 main(int argc, char *argv[])
 {
-	soft_tcam::soft_tcam<std::uint32_t, 32> *tcam;
-	std::vector<std::bitset<32>> flows;
-	const std::uint32_t *result;
+	soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled> *tcam;
+	std::vector<std::uint32_t> flows;
+	const std::uint32_t * volatile result = nullptr;
 	struct rusage ru1, ru2;
 	std::uint64_t find_counter = 0;
 	double fps;
 
-	if (argc != 5) {
+	if ((argc != 5) && (argc != 6)) {
 		std::cout << std::endl
 			  << "usage:" << std::endl
-			  << "        $ " << argv[0] << " fullroute learningflow targetaddr sort" << std::endl
+			  << "        $ " << argv[0] << " fullroute learningflow targetaddr sort [order]" << std::endl
 			  << std::endl
 			  << "where:" << std::endl
 			  << "      fullroute := Containing full route file (Ex. fullroute.sample)" << std::endl
 			  << "   learningflow := Containing learing flow file (Ex. learningflow.sample)" << std::endl
 			  << "     targetaddr := Target IPv4 address (Ex. 192.168.1.1)" << std::endl
 			  << "           sort := [ \"none\" | \"best\" | \"worst\" ]" << std::endl
+			  << "          order := [ \"lsb\" | \"msb\" | \"learn\" ] (default: lsb)" << std::endl
 			  << std::endl;
 		exit(1);
 	}
 
-	tcam = new soft_tcam::soft_tcam<std::uint32_t, 32>();
+	tcam = new soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>();
+
+	if ((argc == 6) && !strncmp(argv[5], "msb", 4)) {
+		tcam->set_order(soft_tcam::soft_tcam_order<32>::msb_first());
+	} else if ((argc == 6) && strncmp(argv[5], "lsb", 4) && strncmp(argv[5], "learn", 6)) {
+		std::cout << "order arg error" << std::endl;
+		exit(1);
+	}
 
 	load_fullroute(*tcam, argv[1]);
 	load_flow(flows, argv[2]);
 
+	if ((argc == 6) && !strncmp(argv[5], "learn", 6)) {
+		std::cout << "Learning order...";
+		std::cout.flush();
+		tcam->learn_order();
+		std::cout << "done." << std::endl;
+	}
+
 	std::cout << "Allocated soft_tcam_node = "
-		  << soft_tcam::soft_tcam_node<std::uint32_t, 32>::get_alloc_counter()
-		  << " ( " << (soft_tcam::soft_tcam_node<std::uint32_t, 32>::get_alloc_counter()
-			* sizeof(soft_tcam::soft_tcam_node<std::uint32_t, 32>)) << " bytes)"
+		  << tcam->get_node_count()
+		  << " ( " << (tcam->get_node_count()
+			* sizeof(soft_tcam::soft_tcam_node<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>)) << " bytes)"
+		  << std::endl;
+	std::cout << "Allocated soft_tcam_node_cold = "
+		  << tcam->get_node_count()
+		  << " ( " << (tcam->get_node_count()
+			* sizeof(soft_tcam::soft_tcam_node_cold<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>)) << " bytes)"
 		  << std::endl;
 	std::cout << "Allocated soft_tcam_entry = "
-		  << soft_tcam::soft_tcam_entry<std::uint32_t, 32>::get_alloc_counter()
-		  << " ( " << (soft_tcam::soft_tcam_entry<std::uint32_t, 32>::get_alloc_counter()
-			* sizeof(soft_tcam::soft_tcam_entry<std::uint32_t, 32>)) << " bytes)"
+		  << tcam->get_entry_count()
+		  << " ( " << (tcam->get_entry_count()
+			* sizeof(soft_tcam::soft_tcam_entry<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>)) << " bytes)"
 		  << std::endl;
+	std::cout << "Masks = " << tcam->get_mask_count() << std::endl;
 
-	soft_tcam::soft_tcam<std::uint32_t, 32>::clear_access_counter();
+	soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>::clear_access_counter();
+	tcam->clear_visit_counter();
 
 	for (auto it = flows.begin(); it != flows.end(); ++it) {
 		tcam->find(*it);
 	}
 
+	std::cout << "Visited nodes per find = "
+		  << std::fixed << std::setprecision(2)
+		  << (flows.empty() ? 0.0 : (double)tcam->get_visit_counter() / flows.size())
+		  << std::endl;
+
 	if (!strncmp(argv[4], "best", 5)) {
-		soft_tcam::soft_tcam<std::uint32_t, 32>::sort_best();
+		soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>::sort_best();
 	} else if (!strncmp(argv[4], "worst", 6)) {
-		soft_tcam::soft_tcam<std::uint32_t, 32>::sort_worst();
+		soft_tcam::soft_tcam<std::uint32_t, 32, soft_tcam::soft_tcam_counter_enabled>::sort_worst();
 	} else if (!strncmp(argv[4], "none", 5)) {
 	} else {
 		std::cout << "sort arg error" << std::endl;
@@ -168,7 +386,7 @@ main(int argc, char *argv[])
 	}
 
 	struct in_addr ina;
-	std::bitset<32> k;
+	std::uint32_t k;
 	if (inet_pton(AF_INET, argv[3], &ina) <= 0) {
 		std::cout << "inet_pton error" << std::endl;
 		exit(1);
@@ -185,6 +403,7 @@ main(int argc, char *argv[])
 		result = tcam->find(k);
 		++find_counter;
 	}
+	(void)result;
 
 	getrusage(RUSAGE_SELF, &ru2);
 
@@ -200,6 +419,120 @@ main(int argc, char *argv[])
 		  << std::fixed << fps
 		  << std::endl;
 
+	if (!flows.empty()) {
+		std::cout << "Find per second (learningflow, one at a time) = "
+			  << std::fixed << bench_flows(*tcam, flows, bench_mode_single)
+			  << std::endl;
+		std::cout << "Find per second (learningflow, batch of " << batch_size << ") = "
+			  << std::fixed << bench_flows(*tcam, flows, bench_mode_batch)
+			  << std::endl;
+		std::cout << "Find per second (learningflow, bulk) = "
+			  << std::fixed << bench_flows(*tcam, flows, bench_mode_bulk)
+			  << std::endl;
+
+		std::vector<std::uint32_t> trace = make_skewed_trace(flows, trace_count);
+		soft_tcam::soft_tcam_cache<std::uint32_t, 32> cache;
+		std::cout << "Find per second (skewed trace, cache off) = "
+			  << std::fixed << bench_flows(*tcam, trace, bench_mode_single)
+			  << std::endl;
+		std::cout << "Find per second (skewed trace, cache on) = "
+			  << std::fixed << bench_flows(*tcam, trace, bench_mode_cache, &cache)
+			  << ", hits = " << cache.get_hit_counter()
+			  << ", misses = " << cache.get_miss_counter()
+			  << " ( " << cache.get_memory_size() << " bytes)"
+			  << std::endl;
+
+		soft_tcam::soft_tcam_snapshot<std::uint32_t, 32> snapshot = tcam->compile();
+		std::cout << "Compiled snapshot = "
+			  << snapshot.get_node_count()
+			  << " ( " << snapshot.get_memory_size() << " bytes, depth "
+			  << snapshot.get_depth() << ")"
+			  << std::endl;
+		std::cout << "Find per second (learningflow, snapshot) = "
+			  << std::fixed << bench_table(snapshot, flows)
+			  << std::endl;
+		std::cout << "Latency ns (learningflow, snapshot, p50, p99) = "
+			  << bench_latency(snapshot, flows)
+			  << std::endl;
+
+		soft_tcam::soft_tcam_snapshot<std::uint32_t, 32> multibit = tcam->compile(0, max_stride);
+		std::cout << "Compiled multibit snapshot = "
+			  << multibit.get_node_count()
+			  << " ( " << multibit.get_memory_size() << " bytes, depth "
+			  << multibit.get_depth() << ", max stride " << max_stride << ")"
+			  << std::endl;
+		std::cout << "Find per second (learningflow, multibit snapshot) = "
+			  << std::fixed << bench_table(multibit, flows)
+			  << std::endl;
+
+		soft_tcam::soft_tcam_snapshot<std::uint32_t, 32> dag = tcam->compile_dag(dag_max_nodes);
+		std::cout << "Compiled dag snapshot = "
+			  << dag.get_node_count()
+			  << " ( " << dag.get_memory_size() << " bytes, depth "
+			  << dag.get_depth() << ", max nodes " << dag_max_nodes << ")"
+			  << std::endl;
+		std::cout << "Find per second (learningflow, dag snapshot) = "
+			  << std::fixed << bench_table(dag, flows)
+			  << std::endl;
+		std::cout << "Latency ns (learningflow, dag snapshot, p50, p99) = "
+			  << bench_latency(dag, flows)
+			  << std::endl;
+
+		/*
+		 * the same tree and multibit snapshot in 2 MiB pages.
+		 */
+		std::cout << "dTLB misses per find (learningflow) = "
+			  << bench_dtlb(*tcam, flows)
+			  << std::endl;
+		std::cout << "dTLB misses per find (learningflow, multibit snapshot) = "
+			  << bench_dtlb(multibit, flows)
+			  << std::endl;
+		tcam->set_huge_pages(true);
+		std::cout << "Find per second (learningflow, one at a time, huge pages) = "
+			  << std::fixed << bench_flows(*tcam, flows, bench_mode_single)
+			  << std::endl;
+		std::cout << "dTLB misses per find (learningflow, huge pages) = "
+			  << bench_dtlb(*tcam, flows)
+			  << std::endl;
+		soft_tcam::soft_tcam_snapshot<std::uint32_t, 32> multibit_huge = tcam->compile(0, max_stride);
+		std::cout << "Find per second (learningflow, multibit snapshot, huge pages) = "
+			  << std::fixed << bench_table(multibit_huge, flows)
+			  << std::endl;
+		std::cout << "dTLB misses per find (learningflow, multibit snapshot, huge pages) = "
+			  << bench_dtlb(multibit_huge, flows)
+			  << std::endl;
+		tcam->set_huge_pages(false);
+
+		for (int bloom = 0; bloom < 2; ++bloom) {
+			soft_tcam::soft_tcam_tuple<std::uint32_t, 32> tuple(bloom != 0);
+			load_fullroute(tuple, argv[1]);
+			std::cout << "Tuples = "
+				  << tuple.get_tuple_count()
+				  << " ( " << tuple.get_memory_size() << " bytes)"
+				  << std::endl;
+			std::cout << "Find per second (learningflow, tuple" << (bloom ? " + bloom" : "") << ") = "
+				  << std::fixed << bench_table(tuple, flows)
+				  << std::endl;
+		}
+
+		soft_tcam::soft_tcam_lpm<std::uint32_t, 32> lpm;
+		load_fullroute(lpm, argv[1]);
+		std::cout << "Lpm routes = "
+			  << lpm.get_route_count()
+			  << ", groups = " << lpm.get_group_count()
+			  << " ( " << lpm.get_memory_size() << " bytes)"
+			  << std::endl;
+		std::cout << "Find per second (learningflow, lpm) = "
+			  << std::fixed << bench_table(lpm, flows)
+			  << std::endl;
+
+		tcam->set_lpm(true);
+		std::cout << "Find per second (learningflow, soft_tcam with lpm"
+			  << (tcam->is_lpm() ? "" : " not used") << ") = "
+			  << std::fixed << bench_flows(*tcam, flows, bench_mode_single)
+			  << std::endl;
+	}
+
 	// tcam->dump();
 
 	return 0;
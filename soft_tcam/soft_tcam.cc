@@ -12,6 +12,12 @@
 #include <cstdlib>
 #include <cstdio>
 
+#include "soft_tcam_bits.h"
+#include "soft_tcam_order.h"
+#include "soft_tcam_snapshot.h"
+#include "soft_tcam_lpm.h"
+#include "soft_tcam_exact.h"
+#include "soft_tcam_cache.h"
 #include "soft_tcam_node.h"
 #include "soft_tcam_entry.h"
 
@@ -19,468 +25,2005 @@
 
 namespace soft_tcam {
 
-	template<class T, size_t size>
-	soft_tcam<T, size>::soft_tcam()
+	template<class T, size_t size, class counter>
+	soft_tcam<T, size, counter>::soft_tcam()
+		: m_node_count(0), m_lpm(lpm_first_bits, lpm_group_bits)
 	{
-		m_root = nullptr;
+		m_root = 0;
+		m_free = 0;
+		m_lpm_enabled = false;
+		m_lpm_ready = false;
+		m_lpm_misses = 0;
+		m_exact_enabled = false;
+		m_generation = ++s_generation;
+
+		/*
+		 * index 0 is never handed out so that it can mean "no node".
+		 */
+		m_nodes.push_back(soft_tcam_node<T, size, counter>());
+		m_colds.push_back(soft_tcam_node_cold<T, size, counter>());
+		m_masks.push_back(key_type());
+		m_mask_refs.push_back(0);
+		m_mask_index.resize(min_mask_slots);
 
 		m_list_next = s_list_head;
 		s_list_head = this;
 	}
 
-	template<class T, size_t size>
-	soft_tcam<T, size>::~soft_tcam()
+	template<class T, size_t size, class counter>
+	soft_tcam<T, size, counter>::~soft_tcam()
 	{
-		soft_tcam<T, size> *curr, *prev;
+		soft_tcam<T, size, counter> *curr, *prev;
 
-		if (m_root != nullptr) {
-			destroy_node(m_root);
-			m_root = nullptr;
-		}
+		destroy_all();
 
 		if (s_list_head == this) {
 			s_list_head = m_list_next;
 			return;
 		}
 
-		prev = s_list_head;
-		curr = s_list_head->m_list_next;
-		while (curr != nullptr) {
-			if (curr == this) {
-				prev->m_list_next = m_list_next;
-				return;
+		prev = s_list_head;
+		curr = s_list_head->m_list_next;
+		while (curr != nullptr) {
+			if (curr == this) {
+				prev->m_list_next = m_list_next;
+				return;
+			}
+			prev = curr;
+			curr = curr->m_list_next;
+		}
+	}
+
+	template<class T, size_t size, class counter>
+	void *
+	soft_tcam<T, size, counter>::operator new(size_t s)
+	{
+		++s_alloc_counter;
+		return malloc(s);
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::operator delete(void *p)
+	{
+		--s_alloc_counter;
+		free(p);
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+			const T &object)
+	{
+		return insert(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::insert(const key_type &key_data, const key_type &key_mask, std::uint32_t priority,
+			const T &object)
+	{
+		if (m_exact_enabled && (soft_tcam_bits<size>::prefix_length(key_mask) == size)) {
+			return insert_exact(key_data, key_mask, priority, object, copyable());
+		}
+
+		return emplace(key_data, key_mask, priority, object);
+	}
+
+	template<class T, size_t size, class counter>
+	template<class... Args>
+	int
+	soft_tcam<T, size, counter>::emplace(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+			Args &&...args)
+	{
+		return emplace(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, std::forward<Args>(args)...);
+	}
+
+	template<class T, size_t size, class counter>
+	template<class... Args>
+	int
+	soft_tcam<T, size, counter>::emplace(const key_type &key_data, const key_type &key_mask, std::uint32_t priority,
+			Args &&...args)
+	{
+		soft_tcam_entry<T, size, counter> *entry;
+
+		if (m_exact_enabled && (soft_tcam_bits<size>::prefix_length(key_mask) == size)) {
+			return insert_exact(key_data, key_mask, priority, T(std::forward<Args>(args)...), copyable());
+		}
+
+		entry = insert_trie(key_data, key_mask, priority, std::forward<Args>(args)...);
+		if (entry == nullptr) {
+			return -1;
+		}
+		insert_lpm(key_data, key_mask, priority, entry->get_object(), copyable());
+		m_generation = ++s_generation;
+
+		return 0;
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+			const T &object)
+	{
+		return erase(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::erase(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object)
+	{
+		if (m_exact_enabled && (soft_tcam_bits<size>::prefix_length(mask) == size)) {
+			if (erase_exact(data, mask, priority, object, copyable()) != 0) {
+				return -1;
+			}
+		} else if (erase_trie(data, mask, priority, [&object](const T &o) { return o == object; }) != 0) {
+			return -1;
+		}
+		erase_lpm(data, mask, priority, object, copyable());
+		m_generation = ++s_generation;
+
+		return 0;
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority)
+	{
+		return erase(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority);
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::erase(const key_type &data, const key_type &mask, std::uint32_t priority)
+	{
+		return erase_any(data, mask, priority, copyable());
+	}
+
+	template<class T, size_t size, class counter>
+	template<class... Args>
+	soft_tcam_entry<T, size, counter> *
+	soft_tcam<T, size, counter>::insert_trie(const key_type &key_data, const key_type &key_mask, std::uint32_t priority,
+			Args &&...args)
+	{
+		soft_tcam_entry<T, size, counter> *entry;
+		std::uint32_t node, nearest, temp;
+		key_type data, mask;
+
+		data = m_order.apply(key_data);
+		mask = m_order.apply(key_mask);
+
+		if (!soft_tcam_bits<size>::is_valid(data, mask)) {
+			std::cerr << "insert: data/mask error." << std::endl;
+			return nullptr;
+		}
+
+		/*
+		 * the new leaf and the branch above it may each need a new mask.
+		 */
+		if (max_masks - m_masks.size() + m_mask_free.size() < 2) {
+			std::cerr << "insert: too many masks." << std::endl;
+			return nullptr;
+		}
+
+		entry = m_entries.alloc(priority, std::forward<Args>(args)...);
+
+		if (m_root == 0) {
+			node = new_node(data, mask, size);
+			insert_entry(node, entry);
+			m_root = node;
+			return entry;
+		}
+
+		nearest = find_nearest_node(data, mask);
+
+		if (nearest == 0) {
+			node = new_node(data, mask, size);
+			insert_entry(node, entry);
+			insert_between(0, m_root, node);
+			return entry;
+		}
+
+		if (m_nodes[nearest].get_position() == size) {
+			insert_entry(nearest, entry);
+			return entry;
+		}
+
+		node = new_node(data, mask, size);
+		insert_entry(node, entry);
+
+		if (!soft_tcam_bits<size>::test(mask, m_nodes[nearest].get_position())) {
+			temp = m_nodes[nearest].get_ndc();
+			if (temp == 0) {
+				m_nodes[nearest].set_ndc(node);
+				m_colds[node].set_parent(nearest);
+				update_bound(nearest);
+				return entry;
+			}
+		} else if (!soft_tcam_bits<size>::test(data, m_nodes[nearest].get_position())) {
+			temp = m_nodes[nearest].get_n0();
+			if (temp == 0) {
+				m_nodes[nearest].set_n0(node);
+				m_colds[node].set_parent(nearest);
+				update_bound(nearest);
+				return entry;
+			}
+		} else {
+			temp = m_nodes[nearest].get_n1();
+			if (temp == 0) {
+				m_nodes[nearest].set_n1(node);
+				m_colds[node].set_parent(nearest);
+				update_bound(nearest);
+				return entry;
+			}
+		}
+
+		insert_between(nearest, temp, node);
+
+		return entry;
+	}
+
+	template<class T, size_t size, class counter>
+	template<class Match>
+	soft_tcam_entry<T, size, counter> *
+	soft_tcam<T, size, counter>::find_entry(const key_type &data, const key_type &mask, std::uint32_t priority,
+			Match match, std::uint32_t &node)
+	{
+		soft_tcam_entry<T, size, counter> *entry;
+
+		node = find_nearest_node(m_order.apply(data), m_order.apply(mask));
+		if ((node == 0)
+		 || (m_nodes[node].get_position() != size)) {
+			std::cerr << "erase: node not found." << std::endl;
+			return nullptr;
+		}
+
+		entry = m_colds[node].get_entry_head();
+		while (entry != nullptr) {
+			if ((entry->get_priority() == priority)
+			 && match(entry->get_object())) {
+				return entry;
+			}
+			entry = entry->get_next();
+		}
+
+		std::cerr << "erase: entry not found." << std::endl;
+		return nullptr;
+	}
+
+	template<class T, size_t size, class counter>
+	template<class Match>
+	int
+	soft_tcam<T, size, counter>::erase_trie(const key_type &data, const key_type &mask, std::uint32_t priority,
+			Match match)
+	{
+		std::uint32_t node;
+		soft_tcam_entry<T, size, counter> *entry;
+
+		entry = find_entry(data, mask, priority, match, node);
+		if (entry == nullptr) {
+			return -1;
+		}
+
+		erase_entry(node, entry);
+		if (m_colds[node].get_entry_head() == nullptr) {
+			erase_node(node);
+		}
+
+		return 0;
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::erase_any(const key_type &data, const key_type &mask, std::uint32_t priority,
+			std::true_type)
+	{
+		std::uint32_t node;
+		soft_tcam_entry<T, size, counter> *entry;
+		const T *object;
+
+		/*
+		 * the exact and lpm tiers may hold a copy, which only an equal
+		 * object finds, so the object of the rule is looked up first and
+		 * a copy of it erased as usual.
+		 */
+		if (m_exact_enabled && (soft_tcam_bits<size>::prefix_length(mask) == size)) {
+			object = m_exact.find_rule(data, priority);
+			if (object == nullptr) {
+				std::cerr << "erase: entry not found." << std::endl;
+				return -1;
+			}
+		} else {
+			entry = find_entry(data, mask, priority, [](const T &) { return true; }, node);
+			if (entry == nullptr) {
+				return -1;
+			}
+			object = &entry->get_object();
+		}
+
+		return erase(data, mask, priority, T(*object));
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::erase_any(const key_type &data, const key_type &mask, std::uint32_t priority,
+			std::false_type)
+	{
+		if (erase_trie(data, mask, priority, [](const T &) { return true; }) != 0) {
+			return -1;
+		}
+		m_generation = ++s_generation;
+
+		return 0;
+	}
+
+	template<class T, size_t size, class counter>
+	const T *
+	soft_tcam<T, size, counter>::find(const std::bitset<size> &key)
+	{
+		return find(soft_tcam_bits<size>::from_bitset(key));
+	}
+
+	template<class T, size_t size, class counter>
+	const T *
+	soft_tcam<T, size, counter>::find(const key_type &key)
+	{
+		std::uint32_t priority;
+
+		return find(key, priority);
+	}
+
+	template<class T, size_t size, class counter>
+	const T *
+	soft_tcam<T, size, counter>::find(const key_type &key, std::uint32_t &priority)
+	{
+		const T *p;
+		std::uint32_t node;
+
+		if (m_lpm_ready) {
+			return m_lpm.find(key, priority);
+		}
+
+		/*
+		 * the root has the highest priority in the tree, an exact match
+		 * with at least that is the answer without a walk.
+		 */
+		p = m_exact.find(key, priority);
+		if ((p != nullptr) && ((m_root == 0) || (priority >= m_nodes[m_root].get_priority()))) {
+			return p;
+		}
+
+		node = find_entry(m_order.apply(key));
+		if ((node != 0) && ((p == nullptr) || (m_nodes[node].get_priority() > priority))) {
+			p = m_nodes[node].get_object();
+			priority = m_nodes[node].get_priority();
+		}
+
+		return p;
+	}
+
+	template<class T, size_t size, class counter>
+	const T *
+	soft_tcam<T, size, counter>::find(const std::bitset<size> &key, soft_tcam_cache<T, size> &cache)
+	{
+		return find(soft_tcam_bits<size>::from_bitset(key), cache);
+	}
+
+	template<class T, size_t size, class counter>
+	const T *
+	soft_tcam<T, size, counter>::find(const key_type &key, soft_tcam_cache<T, size> &cache)
+	{
+		const T *p;
+
+		if (cache.lookup(this, m_generation, key, p)) {
+			return p;
+		}
+		p = find(key);
+		cache.store(key, p);
+
+		return p;
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::find_batch(const std::bitset<size> *keys, size_t n, const T **out)
+	{
+		key_type temp[batch_width];
+
+		for (size_t i = 0; i < n; i += batch_width) {
+			size_t m = std::min(n - i, size_t(batch_width));
+			for (size_t j = 0; j < m; ++j) {
+				temp[j] = soft_tcam_bits<size>::from_bitset(keys[i + j]);
+			}
+			find_batch(temp, m, out + i);
+		}
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::find_batch(const key_type *keys, size_t n, const T **out)
+	{
+		struct state {
+			key_type key;
+			size_t slot;
+			const T *exact;
+			std::uint32_t index;
+			std::uint32_t prev;
+			std::uint32_t best;
+			std::uint32_t priority;
+			std::uint32_t depth;
+			std::uint32_t stack_node[size];
+			std::uint32_t stack_size[size];
+		};
+		soft_tcam_node<T, size, counter> *nodes = m_nodes.data();
+		const key_type *masks = m_masks.data();
+		state states[batch_width];
+		size_t next = 0, active = 0;
+
+		if (m_lpm_ready) {
+			for (size_t i = 0; i < n; ++i) {
+				out[i] = m_lpm.find(keys[i]);
+			}
+			return;
+		}
+
+		/*
+		 * takes the next key that the exact match does not settle. an
+		 * exact match that does not beat the whole tree is where the walk
+		 * starts from, the walk only takes a rule with a higher priority.
+		 */
+		auto start = [&](state &s) -> bool {
+			while (next < n) {
+				s.slot = next++;
+				s.priority = 0;
+				s.exact = m_exact.find(keys[s.slot], s.priority);
+				if ((s.exact != nullptr) && ((m_root == 0) || (s.priority >= nodes[m_root].get_priority()))) {
+					out[s.slot] = s.exact;
+					continue;
+				}
+				s.key = m_order.apply(keys[s.slot]);
+				s.index = m_root;
+				s.prev = 0;
+				s.best = 0;
+				s.depth = 0;
+				__builtin_prefetch(&nodes[s.index]);
+				return true;
+			}
+			return false;
+		};
+
+		/*
+		 * group prefetching: each pass over states advances every lookup
+		 * by one node. the node a lookup reads was prefetched on the
+		 * previous pass, while the other lookups were busy.
+		 */
+		while ((active < batch_width) && start(states[active])) {
+			++active;
+		}
+
+		while (active > 0) {
+			for (size_t i = 0; i < active; ) {
+				state &s = states[i];
+				soft_tcam_node<T, size, counter> *node = &nodes[s.index];
+				std::uint32_t temp = 0, ndc, curr;
+
+				if (s.index != 0) {
+					m_visit_counter.count_access();
+				}
+				if ((s.index != 0)
+				 && (((s.best == 0) && (s.exact == nullptr)) || (node->get_priority() > s.priority))) {
+					curr = node->get_position();
+					if (soft_tcam_bits<size>::is_match(s.key, node->get_data(), masks[node->get_mask()], s.prev, curr)) {
+						if (curr == size) {
+							s.best = s.index;
+							s.priority = node->get_priority();
+						} else {
+							if (!soft_tcam_bits<size>::test(s.key, curr)) {
+								temp = node->get_n0();
+							} else {
+								temp = node->get_n1();
+							}
+							ndc = node->get_ndc();
+							if (ndc != 0) {
+								if (temp != 0) {
+									if (nodes[ndc].get_priority() > nodes[temp].get_priority()) {
+										std::swap(temp, ndc);
+									}
+									s.stack_node[s.depth] = ndc;
+									s.stack_size[s.depth] = curr;
+									++s.depth;
+								} else {
+									temp = ndc;
+								}
+							}
+							s.prev = curr;
+						}
+					}
+				}
+				if ((temp == 0) && (s.depth > 0)) {
+					--s.depth;
+					temp = s.stack_node[s.depth];
+					s.prev = s.stack_size[s.depth];
+				}
+				if (temp != 0) {
+					s.index = temp;
+					__builtin_prefetch(&nodes[temp]);
+					++i;
+					continue;
+				}
+
+				out[s.slot] = (s.best != 0) ? nodes[s.best].get_object() : s.exact;
+				if (start(s)) {
+					++i;
+				} else {
+					--active;
+					if (i != active) {
+						s = states[active];
+					}
+				}
+			}
+		}
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::find_bulk(const std::bitset<size> *keys, size_t n, const T **out)
+	{
+		std::vector<key_type> temp(n);
+
+		for (size_t i = 0; i < n; ++i) {
+			temp[i] = soft_tcam_bits<size>::from_bitset(keys[i]);
+		}
+		find_bulk(temp.data(), n, out);
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::find_bulk(const key_type *keys, size_t n, const T **out)
+	{
+		std::vector<key_type> temp(n);
+		std::vector<std::uint32_t> slot(n), best(n, 0), priority(n, 0), exact(n, 0);
+		size_t count = 0;
+
+		if (m_lpm_ready) {
+			for (size_t i = 0; i < n; ++i) {
+				out[i] = m_lpm.find(keys[i]);
+			}
+			return;
+		}
+
+		/*
+		 * keys settled by the exact match are left out of the walk, the
+		 * others keep their exact match to compare with in the end.
+		 */
+		for (size_t i = 0; i < n; ++i) {
+			out[i] = m_exact.find(keys[i], exact[i]);
+			if ((out[i] != nullptr) && ((m_root == 0) || (exact[i] >= m_nodes[m_root].get_priority()))) {
+				continue;
+			}
+			temp[i] = m_order.apply(keys[i]);
+			slot[count] = i;
+			++count;
+		}
+
+		if ((m_root != 0) && (count > 0)) {
+			find_bulk_node(m_root, 0, temp.data(), slot.data(), slot.data() + count, best.data(), priority.data());
+		}
+
+		for (size_t i = 0; i < n; ++i) {
+			if ((best[i] != 0) && ((out[i] == nullptr) || (priority[i] > exact[i]))) {
+				out[i] = m_nodes[best[i]].get_object();
+			}
+		}
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::dump()
+	{
+		std::cout << " depth            data ";
+		for (int i = 5; i < size; ++i) { std::cout << " "; }
+		std::cout << " parent           node             node->n0         node->n1         node->ndc"
+			  << std::endl;
+		std::cout << " node->position   mask ";
+		for (int i = 5; i < size; ++i) { std::cout << " "; }
+		std::cout << " entry->priority  entry->node      entry            ..."
+			  << std::endl;
+		if (m_root != 0)
+			dump_node(m_root, 0);
+	}
+
+	template<class T, size_t size, class counter>
+	soft_tcam_snapshot<T, size>
+	soft_tcam<T, size, counter>::compile(std::uint32_t bucket_size, std::uint32_t max_stride)
+	{
+		soft_tcam_snapshot<T, size> snapshot(m_nodes.get_allocator().is_huge(), m_nodes.get_allocator().is_lock());
+		std::vector<std::uint32_t> bfs, leaves, targets;
+		std::vector<std::uint32_t> nm(m_nodes.size(), 0);
+		std::vector<std::uint32_t> rules(m_nodes.size(), 0);
+		std::vector<std::uint32_t> prev(m_nodes.size(), 0);
+		std::vector<std::uint32_t> stride(m_nodes.size(), 0);
+		std::vector<std::uint32_t> first(m_nodes.size(), 0);
+		std::vector<bool> queued(m_nodes.size(), false);
+
+		snapshot.m_order = m_order;
+		snapshot.m_exact = m_exact;
+		if (m_root == 0) {
+			return snapshot;
+		}
+		max_stride = std::min(max_stride, std::uint32_t(max_compile_stride));
+
+		/*
+		 * count the rules below each node, children come after their
+		 * parent in bfs so go backwards.
+		 */
+		if (bucket_size > 0) {
+			bfs.push_back(m_root);
+			for (std::uint32_t i = 0; i < bfs.size(); ++i) {
+				soft_tcam_node<T, size, counter> &node = m_nodes[bfs[i]];
+				if (node.get_n0() != 0) {
+					bfs.push_back(node.get_n0());
+				}
+				if (node.get_n1() != 0) {
+					bfs.push_back(node.get_n1());
+				}
+				if (node.get_ndc() != 0) {
+					bfs.push_back(node.get_ndc());
+				}
+			}
+			for (std::uint32_t i = bfs.size(); i > 0; --i) {
+				soft_tcam_node<T, size, counter> &node = m_nodes[bfs[i - 1]];
+				rules[bfs[i - 1]] = (node.get_position() == size) ? 1
+					: rules[node.get_n0()] + rules[node.get_n1()] + rules[node.get_ndc()];
+			}
+			rules[0] = 0;
+			bfs.clear();
+		}
+
+		/*
+		 * prev is where the bits a node checks start, the position of its
+		 * parent or the end of the span of a multibit parent.
+		 */
+		bfs.push_back(m_root);
+		for (std::uint32_t i = 0; i < bfs.size(); ++i) {
+			std::uint32_t index = bfs[i];
+			soft_tcam_node<T, size, counter> &node = m_nodes[index];
+			std::uint32_t position = node.get_position();
+			nm[index] = i;
+			if ((position == size)
+			 || ((bucket_size > 0) && (rules[index] <= bucket_size))) {
+				continue;
+			}
+			if (max_stride >= 2) {
+				stride[index] = choose_stride(index, max_stride, rules, bucket_size);
+			}
+			if (stride[index] != 0) {
+				first[index] = targets.size();
+				for (std::uint32_t v = 0; v < (std::uint32_t(1) << stride[index]); ++v) {
+					std::uint32_t target = stride_target(index, stride[index], v);
+					targets.push_back(target);
+					if ((target != 0) && !queued[target]) {
+						queued[target] = true;
+						prev[target] = position + stride[index];
+						bfs.push_back(target);
+					}
+				}
+			} else {
+				if (node.get_n0() != 0) {
+					prev[node.get_n0()] = position;
+					bfs.push_back(node.get_n0());
+				}
+				if (node.get_n1() != 0) {
+					prev[node.get_n1()] = position;
+					bfs.push_back(node.get_n1());
+				}
+			}
+			if (node.get_ndc() != 0) {
+				prev[node.get_ndc()] = position;
+				bfs.push_back(node.get_ndc());
+			}
+		}
+
+		snapshot.m_nodes.resize(bfs.size());
+		for (std::uint32_t i = 0; i < bfs.size(); ++i) {
+			soft_tcam_node<T, size, counter> &node = m_nodes[bfs[i]];
+			typename soft_tcam_snapshot<T, size>::node &n = snapshot.m_nodes[i];
+
+			/*
+			 * keep only [prev, position), the bits this node checks that
+			 * its parent did not.
+			 */
+			n.data = node.get_data();
+			n.mask = m_masks[node.get_mask()];
+			soft_tcam_bits<size>::clear_below(n.data, prev[bfs[i]]);
+			soft_tcam_bits<size>::clear_below(n.mask, prev[bfs[i]]);
+			n.position = node.get_position();
+			n.n0 = (node.get_n0() != 0) ? nm[node.get_n0()] - i : 0;
+			n.n1 = (node.get_n1() != 0) ? nm[node.get_n1()] - i : 0;
+			n.ndc = (node.get_ndc() != 0) ? nm[node.get_ndc()] - i : 0;
+			n.priority = node.get_priority();
+			if (node.get_object() != nullptr) {
+				n.object = *node.get_object();
+			}
+
+			if (stride[bfs[i]] != 0) {
+				n.position = snapshot.multibit_position + node.get_position();
+				n.n0 = snapshot.m_children.size();
+				n.n1 = stride[bfs[i]];
+				for (std::uint32_t v = 0; v < (std::uint32_t(1) << stride[bfs[i]]); ++v) {
+					std::uint32_t target = targets[first[bfs[i]] + v];
+					snapshot.m_children.push_back((target != 0) ? nm[target] : 0);
+				}
+				continue;
+			}
+
+			if ((bucket_size == 0) || (node.get_position() == size) || (rules[bfs[i]] > bucket_size)) {
+				continue;
+			}
+
+			/*
+			 * the leaves below become the rules of a bucket, highest
+			 * priority first.
+			 */
+			leaves.clear();
+			leaves.push_back(bfs[i]);
+			for (std::uint32_t j = 0; j < leaves.size(); ) {
+				soft_tcam_node<T, size, counter> &leaf = m_nodes[leaves[j]];
+				if (leaf.get_position() == size) {
+					++j;
+					continue;
+				}
+				leaves[j] = leaves.back();
+				leaves.pop_back();
+				if (leaf.get_n0() != 0) {
+					leaves.push_back(leaf.get_n0());
+				}
+				if (leaf.get_n1() != 0) {
+					leaves.push_back(leaf.get_n1());
+				}
+				if (leaf.get_ndc() != 0) {
+					leaves.push_back(leaf.get_ndc());
+				}
+			}
+			std::stable_sort(leaves.begin(), leaves.end(),
+					[&](std::uint32_t l, std::uint32_t r) {
+						return m_nodes[l].get_priority() > m_nodes[r].get_priority();
+					});
+			n.position = snapshot.bucket_position;
+			n.n0 = snapshot.m_bucket_data.size();
+			n.n1 = leaves.size();
+			n.ndc = 0;
+			for (auto it = leaves.begin(); it != leaves.end(); ++it) {
+				snapshot.m_bucket_data.push_back(m_nodes[*it].get_data());
+				snapshot.m_bucket_mask.push_back(m_masks[m_nodes[*it].get_mask()]);
+				snapshot.m_bucket_priority.push_back(m_nodes[*it].get_priority());
+				snapshot.m_bucket_object.push_back(*m_nodes[*it].get_object());
+			}
+		}
+
+		return snapshot;
+	}
+
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam<T, size, counter>::choose_stride(std::uint32_t node, std::uint32_t max_stride,
+			const std::vector<std::uint32_t> &rules, std::uint32_t bucket_size)
+	{
+		std::uint32_t position = m_nodes[node].get_position();
+		std::uint32_t best = 0;
+		std::uint64_t filled;
+
+		/*
+		 * as in an lc-trie, the widest span that still has at least half
+		 * of its children.
+		 */
+		for (std::uint32_t k = 2; (k <= max_stride) && (position + k <= size); ++k) {
+			filled = 0;
+			if (!count_stride(node, position, position + k, 0, rules, bucket_size, filled)) {
+				break;
+			}
+			if (filled * 2 >= (std::uint64_t(1) << k)) {
+				best = k;
+			}
+		}
+
+		return best;
+	}
+
+	template<class T, size_t size, class counter>
+	bool
+	soft_tcam<T, size, counter>::count_stride(std::uint32_t node, std::uint32_t from, std::uint32_t to,
+			std::uint32_t wild, const std::vector<std::uint32_t> &rules, std::uint32_t bucket_size,
+			std::uint64_t &filled)
+	{
+		std::uint32_t children[2] = { m_nodes[node].get_n0(), m_nodes[node].get_n1() };
+
+		/*
+		 * a child below the span is reached by 2^wild values of it, wild
+		 * being the bits of the span none of the rules on the way check.
+		 * inside the span, a wildcard branch or a bucket ends it.
+		 */
+		for (std::uint32_t c = 0; c < 2; ++c) {
+			std::uint32_t child = children[c], w = wild, end;
+			if (child == 0) {
+				continue;
+			}
+			end = std::min(m_nodes[child].get_position(), to);
+			for (std::uint32_t b = m_nodes[node].get_position() + 1; b < end; ++b) {
+				if (!soft_tcam_bits<size>::test(m_masks[m_nodes[child].get_mask()], b)) {
+					++w;
+				}
+			}
+			if (m_nodes[child].get_position() >= to) {
+				filled += std::uint64_t(1) << w;
+				continue;
+			}
+			if ((m_nodes[child].get_ndc() != 0)
+			 || ((bucket_size > 0) && (rules[child] <= bucket_size))) {
+				return false;
+			}
+			if (!count_stride(child, from, to, w, rules, bucket_size, filled)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam<T, size, counter>::stride_target(std::uint32_t node, std::uint32_t stride, std::uint32_t value)
+	{
+		std::uint32_t from = m_nodes[node].get_position(), to = from + stride;
+		std::uint32_t index = node, child, end;
+
+		/*
+		 * the node below the span that a key with value in bits
+		 * [from, to) reaches, or 0.
+		 */
+		for (;;) {
+			std::uint32_t position = m_nodes[index].get_position();
+			if ((value >> (position - from)) & 1) {
+				child = m_nodes[index].get_n1();
+			} else {
+				child = m_nodes[index].get_n0();
+			}
+			if (child == 0) {
+				return 0;
+			}
+			end = std::min(m_nodes[child].get_position(), to);
+			for (std::uint32_t b = position + 1; b < end; ++b) {
+				if (soft_tcam_bits<size>::test(m_masks[m_nodes[child].get_mask()], b)
+				 && (soft_tcam_bits<size>::test(m_nodes[child].get_data(), b) != (((value >> (b - from)) & 1) != 0))) {
+					return 0;
+				}
+			}
+			if (m_nodes[child].get_position() >= to) {
+				return child;
+			}
+			index = child;
+		}
+	}
+
+	template<class T, size_t size, class counter>
+	soft_tcam_snapshot<T, size>
+	soft_tcam<T, size, counter>::compile_dag(size_t max_nodes)
+	{
+		soft_tcam_snapshot<T, size> snapshot(m_nodes.get_allocator().is_huge(), m_nodes.get_allocator().is_lock());
+		soft_tcam_entry<T, size, counter> *entry;
+		dag_state state;
+		std::vector<std::uint32_t> rules;
+		std::uint32_t root, count, index;
+
+		snapshot.m_order = m_order;
+		snapshot.m_exact = m_exact;
+
+		/*
+		 * the rules of the tree, in bit test order and highest priority
+		 * first.
+		 */
+		for (std::uint32_t i = 1; i < m_nodes.size(); ++i) {
+			if (m_nodes[i].is_free() || (m_nodes[i].get_position() != size)) {
+				continue;
+			}
+			for (entry = m_colds[i].get_entry_head(); entry != nullptr; entry = entry->get_next()) {
+				state.rules.push_back(dag_rule{m_nodes[i].get_data(), m_masks[m_nodes[i].get_mask()],
+						entry->get_priority(), entry->get_object()});
+			}
+		}
+		for (std::uint32_t i = 0; i < state.rules.size(); ++i) {
+			rules.push_back(i);
+		}
+		std::stable_sort(rules.begin(), rules.end(),
+				[&](std::uint32_t l, std::uint32_t r) {
+					return state.rules[l].priority > state.rules[r].priority;
+				});
+		state.max_nodes = max_nodes;
+
+		root = build_dag(state, rules, 0, true);
+		if (root == dag_none) {
+			return snapshot;
+		}
+
+		/*
+		 * a node is made after its children, so in reverse order every
+		 * node comes before its children and the root is first.
+		 */
+		count = state.nodes.size();
+		snapshot.m_nodes.resize(count);
+		for (std::uint32_t id = 0; id < count; ++id) {
+			const dag_node &node = state.nodes[id];
+			typename soft_tcam_snapshot<T, size>::node &n = snapshot.m_nodes[count - 1 - id];
+			index = count - 1 - id;
+			n.data = node.data;
+			n.mask = node.mask;
+			n.position = node.position;
+			n.n0 = (node.n0 != dag_none) ? count - 1 - node.n0 - index : 0;
+			n.n1 = (node.n1 != dag_none) ? count - 1 - node.n1 - index : 0;
+			n.ndc = (node.ndc != dag_none) ? count - 1 - node.ndc - index : 0;
+			n.priority = node.priority;
+			if (node.position == size) {
+				n.object = state.rules[node.rule].object;
+			}
+		}
+
+		return snapshot;
+	}
+
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam<T, size, counter>::build_dag(dag_state &state, const std::vector<std::uint32_t> &rules,
+			std::uint32_t from, bool replicate)
+	{
+		std::vector<std::uint32_t> key, r0, r1, rdc;
+		std::uint32_t position = size, last, id;
+		dag_node node;
+
+		if (rules.empty()) {
+			return dag_none;
+		}
+
+		key.push_back(replicate);
+		key.push_back(from);
+		key.insert(key.end(), rules.begin(), rules.end());
+		auto it = state.built.find(key);
+		if (it != state.built.end()) {
+			return it->second;
+		}
+
+		/*
+		 * a rule with no bits left to check matches every key that gets
+		 * here, so the rules after it never win.
+		 */
+		last = 0;
+		while ((last + 1 < rules.size())
+		    && !soft_tcam_bits<size>::is_match(state.rules[rules[last]].mask, key_type(),
+				    state.rules[rules[last]].mask, from, size)) {
+			++last;
+		}
+
+		/*
+		 * the bits up to the first one where the rules differ are the
+		 * same for all of them, and are checked by this node.
+		 */
+		const dag_rule &top = state.rules[rules[0]];
+		for (std::uint32_t i = 1; i <= last; ++i) {
+			const dag_rule &rule = state.rules[rules[i]];
+			position = std::min(position, soft_tcam_bits<size>::find_difference(top.data, top.mask,
+						rule.data, rule.mask, from, position));
+		}
+		node.data = top.data;
+		node.mask = top.mask;
+		soft_tcam_bits<size>::clear_below(node.data, from);
+		soft_tcam_bits<size>::clear_below(node.mask, from);
+		node.position = position;
+		node.n0 = dag_none;
+		node.n1 = dag_none;
+		node.ndc = dag_none;
+		node.rule = rules[0];
+		node.priority = top.priority;
+
+		if (position != size) {
+			soft_tcam_bits<size>::clear_from(node.data, position);
+			soft_tcam_bits<size>::clear_from(node.mask, position);
+
+			/*
+			 * a rule that does not care about the bit goes to both sides
+			 * while the budget lasts, to the wildcard branch after that.
+			 */
+			if (state.nodes.size() >= state.max_nodes) {
+				replicate = false;
+			}
+			for (std::uint32_t i = 0; i <= last; ++i) {
+				const dag_rule &rule = state.rules[rules[i]];
+				if (!soft_tcam_bits<size>::test(rule.mask, position)) {
+					if (replicate) {
+						r0.push_back(rules[i]);
+						r1.push_back(rules[i]);
+					} else {
+						rdc.push_back(rules[i]);
+					}
+				} else if (!soft_tcam_bits<size>::test(rule.data, position)) {
+					r0.push_back(rules[i]);
+				} else {
+					r1.push_back(rules[i]);
+				}
+			}
+			node.n0 = build_dag(state, r0, position + 1, replicate);
+			node.n1 = build_dag(state, r1, position + 1, replicate);
+			node.ndc = build_dag(state, rdc, position + 1, replicate);
+		}
+
+		id = share_dag_node(state, node);
+		state.built[key] = id;
+
+		return id;
+	}
+
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam<T, size, counter>::share_dag_node(dag_state &state, const dag_node &node)
+	{
+		std::uint64_t hash;
+
+		/*
+		 * a leaf is its rule, an inner node is its bits and children.
+		 */
+		hash = soft_tcam_bits<size>::hash(node.data) * 31 + soft_tcam_bits<size>::hash(node.mask);
+		hash = hash * 31 + node.position;
+		if (node.position == size) {
+			hash = hash * 31 + node.rule;
+		} else {
+			hash = ((hash * 31 + node.n0) * 31 + node.n1) * 31 + node.ndc;
+		}
+
+		std::vector<std::uint32_t> &ids = state.shared[hash];
+		for (auto it = ids.begin(); it != ids.end(); ++it) {
+			const dag_node &other = state.nodes[*it];
+			if ((other.data == node.data) && (other.mask == node.mask) && (other.position == node.position)
+			 && ((node.position == size) ? (other.rule == node.rule)
+			  : ((other.n0 == node.n0) && (other.n1 == node.n1) && (other.ndc == node.ndc)))) {
+				return *it;
+			}
+		}
+		ids.push_back(state.nodes.size());
+		state.nodes.push_back(node);
+
+		return ids.back();
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::get_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+			std::vector<std::uint32_t> &priority, std::vector<T> &object)
+	{
+		soft_tcam_entry<T, size, counter> *entry;
+
+		for (std::uint32_t i = 1; i < m_nodes.size(); ++i) {
+			if (m_nodes[i].is_free() || (m_nodes[i].get_position() != size)) {
+				continue;
+			}
+			entry = m_colds[i].get_entry_head();
+			while (entry != nullptr) {
+				data.push_back(m_order.restore(m_nodes[i].get_data()));
+				mask.push_back(m_order.restore(m_masks[m_nodes[i].get_mask()]));
+				priority.push_back(entry->get_priority());
+				object.push_back(entry->get_object());
+				entry = entry->get_next();
+			}
+		}
+		m_exact.get_entries(data, mask, priority, object);
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::set_lpm(bool enable)
+	{
+		m_lpm_enabled = enable && copyable::value;
+		rebuild_lpm(copyable());
+		m_generation = ++s_generation;
+	}
+
+	template<class T, size_t size, class counter>
+	bool
+	soft_tcam<T, size, counter>::is_lpm()
+	{
+		return m_lpm_ready;
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::set_exact(bool enable)
+	{
+		enable = enable && copyable::value;
+		if (enable != m_exact_enabled) {
+			m_exact_enabled = enable;
+			set_order(m_order);
+		}
+	}
+
+	template<class T, size_t size, class counter>
+	size_t
+	soft_tcam<T, size, counter>::get_exact_count()
+	{
+		return m_exact.get_entry_count();
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::reserve(size_t rules)
+	{
+		size_t masks, slots;
+
+		/*
+		 * a rule adds at most a leaf and the branch above it, and so at
+		 * most two masks.
+		 */
+		m_nodes.reserve(2 * rules + 1);
+		m_colds.reserve(2 * rules + 1);
+		m_entries.reserve(rules);
+
+		masks = (2 * rules + 1 < max_masks) ? 2 * rules + 1 : max_masks;
+		slots = m_mask_index.size();
+
+		/*
+		 * the lpm mirror can not be sized ahead of time, so a reserved
+		 * table does without it.
+		 */
+		if (m_lpm_enabled) {
+			set_lpm(false);
+		}
+		if (m_exact_enabled) {
+			m_exact.reserve(rules, rules);
+		}
+
+		m_masks.reserve(masks);
+		m_mask_refs.reserve(masks);
+		m_mask_free.reserve(masks);
+		while (slots < 2 * masks) {
+			slots *= 2;
+		}
+		if (slots > m_mask_index.size()) {
+			rehash_masks(slots);
+		}
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::set_huge_pages(bool enable, bool lock)
+	{
+		std::vector<soft_tcam_node<T, size, counter>, soft_tcam_allocator<soft_tcam_node<T, size, counter>>>
+			nodes(soft_tcam_allocator<soft_tcam_node<T, size, counter>>(enable, lock));
+
+		nodes.reserve(m_nodes.capacity());
+		nodes.assign(m_nodes.begin(), m_nodes.end());
+		m_nodes.swap(nodes);
+
+		/*
+		 * results a cache holds point into the old nodes.
+		 */
+		m_generation = ++s_generation;
+	}
+
+	template<class T, size_t size, class counter>
+	bool
+	soft_tcam<T, size, counter>::is_huge_pages()
+	{
+		return m_nodes.get_allocator().is_huge();
+	}
+
+	template<class T, size_t size, class counter>
+	size_t
+	soft_tcam<T, size, counter>::get_node_count() const
+	{
+		return m_node_count.load(std::memory_order_relaxed);
+	}
+
+	template<class T, size_t size, class counter>
+	size_t
+	soft_tcam<T, size, counter>::get_entry_count() const
+	{
+		return m_entries.get_count();
+	}
+
+	template<class T, size_t size, class counter>
+	size_t
+	soft_tcam<T, size, counter>::get_mask_count() const
+	{
+		return m_masks.size() - 1 - m_mask_free.size();
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::set_order(const soft_tcam_order<size> &order)
+	{
+		std::vector<key_type> data, mask;
+		std::vector<std::uint32_t> priority;
+		std::vector<T> object;
+		int ret = 0;
+
+		take_entries(data, mask, priority, object);
+
+		destroy_all();
+		m_order = order;
+
+		for (std::uint32_t i = 0; i < data.size(); ++i) {
+			if (emplace(data[i], mask[i], priority[i], std::move(object[i])) != 0) {
+				ret = -1;
+			}
+		}
+
+		return ret;
+	}
+
+	template<class T, size_t size, class counter>
+	const soft_tcam_order<size> &
+	soft_tcam<T, size, counter>::get_order()
+	{
+		return m_order;
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::learn_order()
+	{
+		std::vector<key_type> data, mask;
+
+		for (std::uint32_t i = 1; i < m_nodes.size(); ++i) {
+			if (m_nodes[i].is_free() || (m_nodes[i].get_position() != size)) {
+				continue;
+			}
+			data.push_back(m_order.restore(m_nodes[i].get_data()));
+			mask.push_back(m_order.restore(m_masks[m_nodes[i].get_mask()]));
+		}
+
+		return set_order(soft_tcam_order<size>::learn(data, mask));
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::clear_visit_counter()
+	{
+		m_visit_counter.set_access_counter(0);
+	}
+
+	template<class T, size_t size, class counter>
+	std::uint64_t
+	soft_tcam<T, size, counter>::get_visit_counter()
+	{
+		return m_visit_counter.get_access_counter();
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::insert_lpm(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object, std::true_type)
+	{
+		/*
+		 * one rule m_lpm can not hold is enough to leave it empty until
+		 * that rule is gone again.
+		 */
+		if (soft_tcam_bits<size>::prefix_length(mask) > size) {
+			if (m_lpm_misses++ == 0) {
+				m_lpm.clear();
+				m_lpm_ready = false;
+			}
+			return;
+		}
+		if (m_lpm_enabled && (m_lpm_misses == 0)) {
+			m_lpm.insert(data, mask, priority, object);
+			m_lpm_ready = m_lpm.is_ordered();
+		}
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::insert_lpm(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object, std::false_type)
+	{
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::erase_lpm(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object, std::true_type)
+	{
+		if (soft_tcam_bits<size>::prefix_length(mask) > size) {
+			if (--m_lpm_misses == 0) {
+				rebuild_lpm(copyable());
+			}
+			return;
+		}
+		if (m_lpm_enabled && (m_lpm_misses == 0)) {
+			m_lpm.erase(data, mask, priority, object);
+			m_lpm_ready = m_lpm.is_ordered();
+		}
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::erase_lpm(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object, std::false_type)
+	{
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::rebuild_lpm(std::true_type)
+	{
+		std::vector<key_type> data, mask;
+		std::vector<std::uint32_t> priority;
+		std::vector<T> object;
+
+		m_lpm.clear();
+		m_lpm_ready = false;
+		if (!m_lpm_enabled || (m_lpm_misses != 0)) {
+			return;
+		}
+
+		get_entries(data, mask, priority, object);
+		for (std::uint32_t i = 0; i < data.size(); ++i) {
+			m_lpm.insert(data[i], mask[i], priority[i], object[i]);
+		}
+		m_lpm_ready = m_lpm.is_ordered();
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::rebuild_lpm(std::false_type)
+	{
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::insert_exact(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object, std::true_type)
+	{
+		if (m_exact.insert(data, mask, priority, object) != 0) {
+			return -1;
+		}
+		insert_lpm(data, mask, priority, object, copyable());
+		m_generation = ++s_generation;
+
+		return 0;
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::insert_exact(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object, std::false_type)
+	{
+		std::cerr << "insert: object can not be copied to the exact tier." << std::endl;
+		return -1;
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::erase_exact(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object, std::true_type)
+	{
+		return m_exact.erase(data, mask, priority, object);
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::erase_exact(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object, std::false_type)
+	{
+		std::cerr << "erase: entry not found." << std::endl;
+		return -1;
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::clear_exact(std::true_type)
+	{
+		m_exact.clear();
+	}
+
+	/*
+	 * the exact tier never holds a rule when T can not be copied into it.
+	 */
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::clear_exact(std::false_type)
+	{
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::take_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+			std::vector<std::uint32_t> &priority, std::vector<T> &object)
+	{
+		soft_tcam_entry<T, size, counter> *entry;
+
+		for (std::uint32_t i = 1; i < m_nodes.size(); ++i) {
+			if (m_nodes[i].is_free() || (m_nodes[i].get_position() != size)) {
+				continue;
+			}
+			entry = m_colds[i].get_entry_head();
+			while (entry != nullptr) {
+				data.push_back(m_order.restore(m_nodes[i].get_data()));
+				mask.push_back(m_order.restore(m_masks[m_nodes[i].get_mask()]));
+				priority.push_back(entry->get_priority());
+				object.push_back(entry->take_object());
+				entry = entry->get_next();
 			}
-			prev = curr;
-			curr = curr->m_list_next;
 		}
+		take_exact_entries(data, mask, priority, object, copyable());
 	}
 
-	template<class T, size_t size>
-	void *
-	soft_tcam<T, size>::operator new(size_t s)
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::take_exact_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+			std::vector<std::uint32_t> &priority, std::vector<T> &object, std::true_type)
 	{
-		++s_alloc_counter;
-		return malloc(s);
+		m_exact.get_entries(data, mask, priority, object);
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam<T, size>::operator delete(void *p)
+	soft_tcam<T, size, counter>::take_exact_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+			std::vector<std::uint32_t> &priority, std::vector<T> &object, std::false_type)
 	{
-		--s_alloc_counter;
-		free(p);
 	}
 
-	template<class T, size_t size>
-	int
-	soft_tcam<T, size>::insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
-			const T &object)
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam<T, size, counter>::new_node(const key_type &data, const key_type &mask, std::uint32_t position)
 	{
-		soft_tcam_entry<T, size> *entry;
-		soft_tcam_node<T, size> *node, *nearest, *temp;
-		std::uint64_t i;
+		std::uint32_t node;
 
-		for (i = 0; i < size; ++i) {
-			if ((mask[i] == 0) && (data[i] == 1)) {
-				std::cerr << "insert: data/mask error." << std::endl;
-				return -1;
-			}
+		if (m_free != 0) {
+			node = m_free;
+			m_free = m_nodes[node].get_n0();
+			m_nodes[node] = soft_tcam_node<T, size, counter>(data, acquire_mask(mask), position);
+			m_colds[node] = soft_tcam_node_cold<T, size, counter>();
+		} else {
+			node = m_nodes.size();
+			m_nodes.push_back(soft_tcam_node<T, size, counter>(data, acquire_mask(mask), position));
+			m_colds.push_back(soft_tcam_node_cold<T, size, counter>());
 		}
+		m_node_count.fetch_add(1, std::memory_order_relaxed);
 
-		entry = new soft_tcam_entry<T, size>();
-		entry->set_priority(priority);
-		entry->set_object(object);
+		return node;
+	}
 
-		if (m_root == nullptr) {
-			node = new soft_tcam_node<T, size>(data, mask, size);
-			node->insert_entry(entry);
-			entry->set_node(node);
-			m_root = node;
-			return 0;
-		}
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::delete_node(std::uint32_t node)
+	{
+		/*
+		 * freed slots are chained through n0 and recognized by is_free().
+		 */
+		release_mask(m_nodes[node].get_mask());
+		m_nodes[node] = soft_tcam_node<T, size, counter>();
+		m_nodes[node].set_n0(m_free);
+		m_colds[node] = soft_tcam_node_cold<T, size, counter>();
+		m_free = node;
+		m_node_count.fetch_sub(1, std::memory_order_relaxed);
+	}
 
-		nearest = find_nearest_node(data, mask);
+	template<class T, size_t size, class counter>
+	std::uint16_t
+	soft_tcam<T, size, counter>::acquire_mask(const key_type &mask)
+	{
+		std::uint16_t id;
+		size_t i;
 
-		if (nearest == nullptr) {
-			node = new soft_tcam_node<T, size>(data, mask, size);
-			node->insert_entry(entry);
-			entry->set_node(node);
-			return insert_between(nullptr, m_root, node);
+		if (mask == key_type()) {
+			return 0;
 		}
 
-		if (nearest->get_position() == size) {
-			nearest->insert_entry(entry);
-			entry->set_node(nearest);
-			return 0;
+		i = find_mask_slot(mask);
+		if (m_mask_index[i] != 0) {
+			++m_mask_refs[m_mask_index[i]];
+			return m_mask_index[i];
 		}
 
-		node = new soft_tcam_node<T, size>(data, mask, size);
-		node->insert_entry(entry);
-		entry->set_node(node);
+		if ((get_mask_count() + 1) * 2 > m_mask_index.size()) {
+			rehash_masks(m_mask_index.size() * 2);
+			i = find_mask_slot(mask);
+		}
 
-		if (mask[nearest->get_position()] == 0) {
-			temp = nearest->get_ndc();
-			if (temp == nullptr) {
-				nearest->set_ndc(node);
-				node->set_parent(nearest);
-				return 0;
-			}
-		} else if (data[nearest->get_position()] == 0) {
-			temp = nearest->get_n0();
-			if (temp == nullptr) {
-				nearest->set_n0(node);
-				node->set_parent(nearest);
-				return 0;
-			}
+		if (!m_mask_free.empty()) {
+			id = m_mask_free.back();
+			m_mask_free.pop_back();
+			m_masks[id] = mask;
+			m_mask_refs[id] = 1;
 		} else {
-			temp = nearest->get_n1();
-			if (temp == nullptr) {
-				nearest->set_n1(node);
-				node->set_parent(nearest);
-				return 0;
-			}
+			id = m_masks.size();
+			m_masks.push_back(mask);
+			m_mask_refs.push_back(1);
 		}
+		m_mask_index[i] = id;
 
-		return insert_between(nearest, temp, node);
+		return id;
 	}
 
-	template<class T, size_t size>
-	int
-	soft_tcam<T, size>::erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
-			const T &object)
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::release_mask(std::uint16_t id)
 	{
-		soft_tcam_node<T, size> *node;
-		soft_tcam_entry<T, size> *entry;
-		bool found = false;
+		size_t n, i, j, home;
 
-		node = find_nearest_node(data, mask);
-		if ((node == nullptr)
-		 || (node->get_position() != size)) {
-			std::cerr << "erase: node not found." << std::endl;
-			return -1;
+		if (id == 0) {
+			return;
 		}
 
-		entry = node->get_entry_head();
-		while (entry != nullptr) {
-			if ((entry->get_priority() == priority)
-			 && (entry->get_object() == object)) {
-				found = true;
-				node->erase_entry(entry);
+		if (--m_mask_refs[id] != 0) {
+			return;
+		}
+		m_mask_free.push_back(id);
+
+		/*
+		 * backward shift deletion: the masks after the slot in its probe
+		 * run move up unless their home is between the slot and them, so
+		 * that no tombstones are left.
+		 */
+		n = m_mask_index.size() - 1;
+		i = find_mask_slot(m_masks[id]);
+		j = i;
+		while (true) {
+			j = (j + 1) & n;
+			if (m_mask_index[j] == 0) {
 				break;
 			}
-			entry = entry->get_next();
+			home = soft_tcam_bits<size>::hash(m_masks[m_mask_index[j]]) & n;
+			if (((j - home) & n) >= ((j - i) & n)) {
+				m_mask_index[i] = m_mask_index[j];
+				i = j;
+			}
 		}
+		m_mask_index[i] = 0;
+	}
 
-		if (!found) {
-			std::cerr << "erase: entry not found." << std::endl;
-			return -1;
-		}
+	template<class T, size_t size, class counter>
+	size_t
+	soft_tcam<T, size, counter>::find_mask_slot(const key_type &mask) const
+	{
+		size_t n = m_mask_index.size() - 1;
+		size_t i = soft_tcam_bits<size>::hash(mask) & n;
 
-		if (node->get_entry_head() == nullptr) {
-			erase_node(node);
+		while ((m_mask_index[i] != 0) && !(m_masks[m_mask_index[i]] == mask)) {
+			i = (i + 1) & n;
 		}
 
-		return 0;
+		return i;
 	}
 
-	template<class T, size_t size>
-	const T *
-	soft_tcam<T, size>::find(const std::bitset<size> &key)
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::rehash_masks(size_t slots)
 	{
-		const T *p = nullptr;
-		soft_tcam_entry<T, size> *entry;
+		size_t n = slots - 1, i;
 
-		entry = find_entry(key);
-		if (entry != nullptr) {
-			p = &entry->get_object();
+		m_mask_index.assign(slots, 0);
+		for (size_t id = 1; id < m_masks.size(); ++id) {
+			if (m_mask_refs[id] == 0) {
+				continue;
+			}
+			i = soft_tcam_bits<size>::hash(m_masks[id]) & n;
+			while (m_mask_index[i] != 0) {
+				i = (i + 1) & n;
+			}
+			m_mask_index[i] = id;
 		}
+	}
 
-		return p;
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::insert_entry(std::uint32_t node, soft_tcam_entry<T, size, counter> *entry)
+	{
+		if (m_colds[node].insert_entry(entry) != 0) {
+			return -1;
+		}
+		entry->set_node(node);
+		update_best(node);
+
+		return 0;
 	}
 
-	template<class T, size_t size>
-	void
-	soft_tcam<T, size>::dump()
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam<T, size, counter>::erase_entry(std::uint32_t node, soft_tcam_entry<T, size, counter> *entry)
 	{
-		std::cout << " depth            data ";
-		for (int i = 5; i < size; ++i) { std::cout << " "; }
-		std::cout << " parent           node             node->n0         node->n1         node->ndc"
-			  << std::endl;
-		std::cout << " node->position   mask ";
-		for (int i = 5; i < size; ++i) { std::cout << " "; }
-		std::cout << " entry->priority  entry->node      entry            ..."
-			  << std::endl;
-		if (m_root != nullptr)
-			dump_node(m_root, 0);
+		if (m_colds[node].erase_entry(entry) != 0) {
+			return -1;
+		}
+		m_entries.free(entry);
+		update_best(node);
+
+		return 0;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam<T, size>::destroy_node(soft_tcam_node<T, size> *node)
+	soft_tcam<T, size, counter>::update_best(std::uint32_t node)
 	{
-		soft_tcam_entry<T, size> *entry;
+		soft_tcam_entry<T, size, counter> *entry;
 
-		entry = node->get_entry_head();
-		while (entry != nullptr) {
-			soft_tcam_entry<T, size> *temp = entry->get_next();
-			node->erase_entry(entry);
-			entry = temp;
+		entry = m_colds[node].get_entry_head();
+		if (entry == nullptr) {
+			m_nodes[node].set_priority(0);
+			m_nodes[node].set_object(nullptr);
+			update_bound(m_colds[node].get_parent());
+			return;
 		}
+		m_nodes[node].set_priority(entry->get_priority());
+		m_nodes[node].set_object(&entry->get_object());
+		update_bound(m_colds[node].get_parent());
+	}
 
-		if (node->get_n0() != nullptr) {
-			destroy_node(node->get_n0());
-		}
-		if (node->get_n1() != nullptr) {
-			destroy_node(node->get_n1());
-		}
-		if (node->get_ndc() != nullptr) {
-			destroy_node(node->get_ndc());
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::update_bound(std::uint32_t node)
+	{
+		std::uint32_t bound;
+
+		/*
+		 * m_nodes[0] is never used and keeps priority 0, so a missing child
+		 * needs no special case.
+		 */
+		while (node != 0) {
+			bound = std::max(m_nodes[m_nodes[node].get_n0()].get_priority(),
+					std::max(m_nodes[m_nodes[node].get_n1()].get_priority(),
+						m_nodes[m_nodes[node].get_ndc()].get_priority()));
+			if (bound == m_nodes[node].get_priority()) {
+				break;
+			}
+			m_nodes[node].set_priority(bound);
+			node = m_colds[node].get_parent();
 		}
+	}
 
-		node->set_n0(nullptr);
-		node->set_n1(nullptr);
-		node->set_ndc(nullptr);
-		node->set_parent(nullptr);
-		delete node;
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::destroy_all()
+	{
+		/*
+		 * nodes and entries only point at each other, so they go all at
+		 * once and the memory is kept for the next rules.
+		 */
+		m_root = 0;
+		m_nodes.resize(1);
+		m_colds.resize(1);
+		m_free = 0;
+		m_node_count.store(0, std::memory_order_relaxed);
+		m_entries.clear();
+		m_masks.resize(1);
+		m_mask_refs.resize(1);
+		m_mask_free.clear();
+		std::fill(m_mask_index.begin(), m_mask_index.end(), 0);
+		m_generation = ++s_generation;
+		clear_exact(copyable());
+		m_lpm.clear();
+		m_lpm_ready = false;
+		m_lpm_misses = 0;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	int
-	soft_tcam<T, size>::insert_between(soft_tcam_node<T, size> *less, soft_tcam_node<T, size> *more,
-			soft_tcam_node<T, size> *node)
+	soft_tcam<T, size, counter>::insert_between(std::uint32_t less, std::uint32_t more, std::uint32_t node)
 	{
-		soft_tcam_node<T, size> *temp;
-		std::bitset<size> data, mask;
+		std::uint32_t temp;
+		key_type data, mask;
 		std::uint32_t position;
 
-		data.reset();
-		mask.reset();
-		position = 0;
-
-		for (std::uint32_t i = 0; i < size; ++i) {
-			if ((more->get_data()[i] != node->get_data()[i])
-			 || (more->get_mask()[i] != node->get_mask()[i])) {
-				break;
-			}
-			data.set(i, node->get_data()[i]);
-			mask.set(i, node->get_mask()[i]);
-			position = i + 1;
-		}
+		position = soft_tcam_bits<size>::find_difference(m_nodes[more].get_data(), m_masks[m_nodes[more].get_mask()],
+				m_nodes[node].get_data(), m_masks[m_nodes[node].get_mask()], 0, size);
+		data = m_nodes[node].get_data();
+		mask = m_masks[m_nodes[node].get_mask()];
+		soft_tcam_bits<size>::clear_from(data, position);
+		soft_tcam_bits<size>::clear_from(mask, position);
 
-		temp = new soft_tcam_node<T, size>(data, mask, position);
+		temp = new_node(data, mask, position);
 
-		if (less == nullptr) {
+		if (less == 0) {
 			m_root = temp;
 		} else {
-			if (temp->get_mask()[less->get_position()] == 0) {
-				less->set_ndc(temp);
-			} else if (temp->get_data()[less->get_position()] == 0) {
-				less->set_n0(temp);
+			if (!soft_tcam_bits<size>::test(m_masks[m_nodes[temp].get_mask()], m_nodes[less].get_position())) {
+				m_nodes[less].set_ndc(temp);
+			} else if (!soft_tcam_bits<size>::test(m_nodes[temp].get_data(), m_nodes[less].get_position())) {
+				m_nodes[less].set_n0(temp);
 			} else {
-				less->set_n1(temp);
+				m_nodes[less].set_n1(temp);
 			}
-			temp->set_parent(less);
+			m_colds[temp].set_parent(less);
 		}
 
-		if (more->get_mask()[temp->get_position()] == 0) {
-			temp->set_ndc(more);
-		} else if (more->get_data()[temp->get_position()] == 0) {
-			temp->set_n0(more);
+		if (!soft_tcam_bits<size>::test(m_masks[m_nodes[more].get_mask()], position)) {
+			m_nodes[temp].set_ndc(more);
+		} else if (!soft_tcam_bits<size>::test(m_nodes[more].get_data(), position)) {
+			m_nodes[temp].set_n0(more);
 		} else {
-			temp->set_n1(more);
+			m_nodes[temp].set_n1(more);
 		}
-		more->set_parent(temp);
+		m_colds[more].set_parent(temp);
 
-		if (node->get_mask()[temp->get_position()] == 0) {
-			temp->set_ndc(node);
-		} else if (node->get_data()[temp->get_position()] == 0) {
-			temp->set_n0(node);
+		if (!soft_tcam_bits<size>::test(m_masks[m_nodes[node].get_mask()], position)) {
+			m_nodes[temp].set_ndc(node);
+		} else if (!soft_tcam_bits<size>::test(m_nodes[node].get_data(), position)) {
+			m_nodes[temp].set_n0(node);
 		} else {
-			temp->set_n1(node);
+			m_nodes[temp].set_n1(node);
 		}
-		node->set_parent(temp);
+		m_colds[node].set_parent(temp);
+
+		update_bound(temp);
 
 		return 0;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	int
-	soft_tcam<T, size>::erase_node(soft_tcam_node<T, size> *node)
+	soft_tcam<T, size, counter>::erase_node(std::uint32_t node)
 	{
-		soft_tcam_node<T, size> *parent;
+		std::uint32_t parent;
 		bool has_child;
 
-		if ((node->get_n1() != nullptr)
-		 || (node->get_n0() != nullptr)
-		 || (node->get_ndc() != nullptr)
-		 || (node->get_entry_head() != nullptr)) {
+		if ((m_nodes[node].get_n1() != 0)
+		 || (m_nodes[node].get_n0() != 0)
+		 || (m_nodes[node].get_ndc() != 0)
+		 || (m_colds[node].get_entry_head() != nullptr)) {
 			std::cerr << "erase_node: node in use." << std::endl;
 			return -1;
 		}
 
-		parent = node->get_parent();
-		if (parent == nullptr) {
-			m_root = nullptr;
-			node->set_n0(nullptr);
-			node->set_n1(nullptr);
-			node->set_ndc(nullptr);
-			node->set_parent(nullptr);
-			delete node;
+		parent = m_colds[node].get_parent();
+		if (parent == 0) {
+			m_root = 0;
+			delete_node(node);
 			return 0;
 		}
 
 		has_child = false;
-		if (parent->get_n0() != nullptr) {
-			if (parent->get_n0() == node) {
-				parent->set_n0(nullptr);
+		if (m_nodes[parent].get_n0() != 0) {
+			if (m_nodes[parent].get_n0() == node) {
+				m_nodes[parent].set_n0(0);
 			} else {
 				has_child = true;
 			}
 		}
-		if (parent->get_n1() != nullptr) {
-			if (parent->get_n1() == node) {
-				parent->set_n1(nullptr);
+		if (m_nodes[parent].get_n1() != 0) {
+			if (m_nodes[parent].get_n1() == node) {
+				m_nodes[parent].set_n1(0);
 			} else {
 				has_child = true;
 			}
 		}
-		if (parent->get_ndc() != nullptr) {
-			if (parent->get_ndc() == node) {
-				parent->set_ndc(nullptr);
+		if (m_nodes[parent].get_ndc() != 0) {
+			if (m_nodes[parent].get_ndc() == node) {
+				m_nodes[parent].set_ndc(0);
 			} else {
 				has_child = true;
 			}
 		}
 
-		node->set_n0(nullptr);
-		node->set_n1(nullptr);
-		node->set_ndc(nullptr);
-		node->set_parent(nullptr);
-		delete node;
+		delete_node(node);
 
 		if (!has_child) {
 			erase_node(parent);
+		} else {
+			merge_node(parent);
 		}
 
 		return 0;
 	}
 
-	template<class T, size_t size>
-	soft_tcam_node<T, size> *
-	soft_tcam<T, size>::find_nearest_node(const std::bitset<size> &data, const std::bitset<size> &mask)
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::merge_node(std::uint32_t node)
+	{
+		std::uint32_t parent, child;
+
+		/*
+		 * an inner node is made by insert_between() with two children.
+		 * left with one, it tests a bit its subtree no longer branches
+		 * on, so the child takes its place, as if it had never been made.
+		 * the child agrees with it on every bit above it, so it goes
+		 * where the node was.
+		 */
+		child = m_nodes[node].get_n0();
+		if (m_nodes[node].get_n1() != 0) {
+			if (child != 0) {
+				update_bound(node);
+				return;
+			}
+			child = m_nodes[node].get_n1();
+		}
+		if (m_nodes[node].get_ndc() != 0) {
+			if (child != 0) {
+				update_bound(node);
+				return;
+			}
+			child = m_nodes[node].get_ndc();
+		}
+
+		parent = m_colds[node].get_parent();
+		if (parent == 0) {
+			m_root = child;
+		} else if (m_nodes[parent].get_n0() == node) {
+			m_nodes[parent].set_n0(child);
+		} else if (m_nodes[parent].get_n1() == node) {
+			m_nodes[parent].set_n1(child);
+		} else {
+			m_nodes[parent].set_ndc(child);
+		}
+		m_colds[child].set_parent(parent);
+
+		delete_node(node);
+		update_bound(parent);
+	}
+
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam<T, size, counter>::find_nearest_node(const key_type &data, const key_type &mask)
 	{
-		soft_tcam_node<T, size> *node, *temp;
+		soft_tcam_node<T, size, counter> *node;
+		std::uint32_t index, temp;
 		std::uint32_t position;
 
-		if (m_root == nullptr) {
-			return nullptr;
+		if (m_root == 0) {
+			return 0;
 		}
 
 		position = 0;
-		node = m_root;
-		while (node != nullptr) {
-			for (std::uint32_t i = position; i < node->get_position(); ++i) {
-				if ((node->get_data()[i] != data[i])
-				 || (node->get_mask()[i] != mask[i])) {
-					return node->get_parent();
-				}
+		index = m_root;
+		while (index != 0) {
+			node = &m_nodes[index];
+			if (soft_tcam_bits<size>::find_difference(node->get_data(), m_masks[node->get_mask()],
+						data, mask, position, node->get_position()) != node->get_position()) {
+				return m_colds[index].get_parent();
 			}
 			if (node->get_position() == size) {
-				return node;
+				return index;
 			}
 			position = node->get_position();
-			if (mask[position] == 0) {
+			if (!soft_tcam_bits<size>::test(mask, position)) {
 				temp = node->get_ndc();
-			} else if (data[position] == 0) {
+			} else if (!soft_tcam_bits<size>::test(data, position)) {
 				temp = node->get_n0();
 			} else {
 				temp = node->get_n1();
 			}
-			if (temp == nullptr) {
-				return node;
+			if (temp == 0) {
+				return index;
 			}
-			node = temp;
+			index = temp;
 		}
 
-		return nullptr;
+		return 0;
 	}
 
-	template<class T, size_t size>
-	soft_tcam_entry<T, size> *
-	soft_tcam<T, size>::find_entry(const std::bitset<size> &key)
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam<T, size, counter>::find_entry(const key_type &key)
 	{
-		soft_tcam_entry<T, size> *entry = nullptr;
-		soft_tcam_node<T, size> *node, *temp_node;
-		soft_tcam_node<T, size> *stack_node[size], **stack_node_ptr = &stack_node[0];
+		soft_tcam_node<T, size, counter> *nodes = m_nodes.data();
+		const key_type *masks = m_masks.data();
+		std::uint32_t best = 0, priority = 0, index, temp, ndc;
+		std::uint32_t stack_node[size], *stack_node_ptr = &stack_node[0];
 		size_t stack_size[size], *stack_size_ptr = &stack_size[0];
 		size_t prev, curr;
 
 		prev = 0;
-		node = m_root;
+		index = m_root;
 retry:
-		while (node != nullptr) {
-			bool match = true;
-			const std::bitset<size> &data = node->get_data();
-			const std::bitset<size> &mask = node->get_mask();
-			curr = node->get_position();
-			for (size_t i = prev; i < curr; ++i) {
-				if ((mask[i] == 1) && (key[i] != data[i])) {
-					match = false;
-					break;
-				}
+		while (index != 0) {
+			soft_tcam_node<T, size, counter> *node = &nodes[index];
+			m_visit_counter.count_access();
+			if ((best != 0) && (node->get_priority() <= priority)) {
+				break;
 			}
-			if (match == false) {
+			curr = node->get_position();
+			if (!soft_tcam_bits<size>::is_match(key, node->get_data(), masks[node->get_mask()], prev, curr)) {
 				break;
 			}
 			if (curr == size) {
-				soft_tcam_entry<T, size> *temp_entry = node->get_entry_head();
-				if ((entry == nullptr)
-				 || (temp_entry->get_priority() > entry->get_priority())) {
-					entry = temp_entry;
-				}
-			}
-			temp_node = nullptr;
-			if (key[curr] == 0) {
-				temp_node = node->get_n0();
+				best = index;
+				priority = node->get_priority();
+				break;
 			}
-			if (key[curr] == 1) {
-				temp_node = node->get_n1();
+			if (!soft_tcam_bits<size>::test(key, curr)) {
+				temp = node->get_n0();
+			} else {
+				temp = node->get_n1();
 			}
-			if (node->get_ndc() != nullptr) {
-				if (temp_node != nullptr) {
-					*stack_node_ptr = node->get_ndc();
+			ndc = node->get_ndc();
+			if (ndc != 0) {
+				if (temp != 0) {
+					if (nodes[ndc].get_priority() > nodes[temp].get_priority()) {
+						std::swap(temp, ndc);
+					}
+					*stack_node_ptr = ndc;
 					*stack_size_ptr = curr;
 					++stack_node_ptr;
 					++stack_size_ptr;
 				} else {
-					temp_node = node->get_ndc();
+					temp = ndc;
 				}
 			}
 			prev = curr;
-			node = temp_node;
+			index = temp;
 		}
 		if (stack_node_ptr != &stack_node[0]) {
 			--stack_node_ptr;
 			--stack_size_ptr;
 			prev = *stack_size_ptr;
-			node = *stack_node_ptr;
+			index = *stack_node_ptr;
 			goto retry;
 		}
 
-		return entry;
+		return best;
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::find_bulk_node(std::uint32_t index, std::uint32_t prev, const key_type *keys,
+			std::uint32_t *first, std::uint32_t *last, std::uint32_t *best, std::uint32_t *priority)
+	{
+		soft_tcam_node<T, size, counter> *node = &m_nodes[index];
+		std::uint32_t *match, *split;
+		std::uint32_t curr, bound;
+
+		m_visit_counter.count_access();
+		curr = node->get_position();
+		bound = node->get_priority();
+
+		/*
+		 * [first, match) are the keys that match this node and could still
+		 * find something better below it. the rest of [first, last) stays
+		 * where it is for the caller's other branches.
+		 */
+		match = std::partition(first, last,
+				[&](std::uint32_t s) {
+					return ((best[s] == 0) || (bound > priority[s]))
+					    && soft_tcam_bits<size>::is_match(keys[s], node->get_data(), m_masks[node->get_mask()], prev, curr);
+				});
+		if (match == first) {
+			return;
+		}
+
+		if (curr == size) {
+			for (std::uint32_t *s = first; s != match; ++s) {
+				best[*s] = index;
+				priority[*s] = bound;
+			}
+			return;
+		}
+
+		split = std::partition(first, match,
+				[&](std::uint32_t s) {
+					return !soft_tcam_bits<size>::test(keys[s], curr);
+				});
+		if ((node->get_n0() != 0) && (split != first)) {
+			find_bulk_node(node->get_n0(), curr, keys, first, split, best, priority);
+		}
+		if ((node->get_n1() != 0) && (split != match)) {
+			find_bulk_node(node->get_n1(), curr, keys, split, match, best, priority);
+		}
+		if (node->get_ndc() != 0) {
+			find_bulk_node(node->get_ndc(), curr, keys, first, match, best, priority);
+		}
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam<T, size>::dump_node(soft_tcam_node<T, size> *node, int depth)
+	soft_tcam<T, size, counter>::dump_node(std::uint32_t node, int depth)
 	{
 		char buf1[19];
 		char buf2[19];
 		char buf3[256];
 		char buf4[256];
-		soft_tcam_entry<T, size> *entry;
+		soft_tcam_entry<T, size, counter> *entry;
 
-		if (node == nullptr) {
+		if (node == 0) {
 			return;
 		}
 
@@ -494,26 +2037,26 @@ retry:
 		}
 		buf1[18] = '\0';
 
-		snprintf(buf2, 19, " %16d ", node->get_position());
+		snprintf(buf2, 19, " %16d ", m_nodes[node].get_position());
 
 		snprintf(buf3, 256, " %016lx %016lx %016lx %016lx %016lx",
-			       	(unsigned long)node->get_parent(),
+			       	(unsigned long)m_colds[node].get_parent(),
 				(unsigned long)node,
-				(unsigned long)node->get_n0(),
-				(unsigned long)node->get_n1(),
-				(unsigned long)node->get_ndc());
+				(unsigned long)m_nodes[node].get_n0(),
+				(unsigned long)m_nodes[node].get_n1(),
+				(unsigned long)m_nodes[node].get_ndc());
 
 		std::cout << " ----------------------";
 		for (int i = 5; i < size; ++i) { std::cout << "-"; }
 		std::cout << " ------------------------------------------------------------------------------------ "
 			  << std::endl;
 		std::cout << buf1
-			  << node->get_data().to_string()
+			  << soft_tcam_bits<size>::to_bitset(m_order.restore(m_nodes[node].get_data())).to_string()
 			  << buf3
 			  << std::endl;
 		std::cout << buf2
-			  << node->get_mask().to_string();
-		entry = node->get_entry_head();
+			  << soft_tcam_bits<size>::to_bitset(m_order.restore(m_masks[m_nodes[node].get_mask()])).to_string();
+		entry = m_colds[node].get_entry_head();
 		while (entry != nullptr) {
 			snprintf(buf4, 256, " %016lx %016lx %016lx",
 					(unsigned long)entry->get_priority(),
@@ -524,107 +2067,48 @@ retry:
 		}
 		std::cout << std::endl;
 
-		if (node->get_n0() != nullptr) {
-			dump_node(node->get_n0(), depth + 1);
+		if (m_nodes[node].get_n0() != 0) {
+			dump_node(m_nodes[node].get_n0(), depth + 1);
 		}
-		if (node->get_n1() != nullptr) {
-			dump_node(node->get_n1(), depth + 1);
+		if (m_nodes[node].get_n1() != 0) {
+			dump_node(m_nodes[node].get_n1(), depth + 1);
 		}
-		if (node->get_ndc() != nullptr) {
-			dump_node(node->get_ndc(), depth + 1);
+		if (m_nodes[node].get_ndc() != 0) {
+			dump_node(m_nodes[node].get_ndc(), depth + 1);
 		}
 	}
 
-	template<class T, size_t size>
-	static bool comp_node_by_memory_address(soft_tcam_node<T, size> * &l, soft_tcam_node<T, size> * &r)
-	{
-		return (l < r);
-	}
-
-	template<class T, size_t size>
-	static bool comp_node_by_access_counter(soft_tcam_node<T, size> * &l, soft_tcam_node<T, size> * &r)
-	{
-		return (l->get_access_counter() > r->get_access_counter());
-	}
-
-	template<class T, size_t size>
-	static bool comp_entry_by_memory_address(soft_tcam_entry<T, size> * &l, soft_tcam_entry<T, size> * &r)
+	template<class T, size_t size, class counter>
+	static bool comp_entry_by_memory_address(soft_tcam_entry<T, size, counter> * &l, soft_tcam_entry<T, size, counter> * &r)
 	{
 		return (l < r);
 	}
 
-	template<class T, size_t size>
-	static bool comp_entry_by_access_counter(soft_tcam_entry<T, size> * &l, soft_tcam_entry<T, size> * &r)
+	template<class T, size_t size, class counter>
+	static bool comp_entry_by_access_counter(soft_tcam_entry<T, size, counter> * &l, soft_tcam_entry<T, size, counter> * &r)
 	{
 		return (l->get_access_counter() > r->get_access_counter());
 	}
 
-	template<class T, size_t size>
-	static void
-	sort_nodes(std::vector<soft_tcam_node<T, size> *> &nv1, std::vector<soft_tcam_node<T, size> *> &nv2,
-			std::map<soft_tcam_node<T, size> *, soft_tcam_node<T, size> *> &nm,
-			std::map<soft_tcam_entry<T, size> *, soft_tcam_entry<T, size> *> &em)
-	{
-		std::cerr << "Sorting nodes...";
-		std::bitset<size> *data = new std::bitset<size>[nv1.size()];
-		std::bitset<size> *mask = new std::bitset<size>[nv1.size()];
-		std::uint32_t *position = new std::uint32_t[nv1.size()];
-		soft_tcam_node<T, size> **n0 = new soft_tcam_node<T, size> *[nv1.size()];
-		soft_tcam_node<T, size> **n1 = new soft_tcam_node<T, size> *[nv1.size()];
-		soft_tcam_node<T, size> **ndc = new soft_tcam_node<T, size> *[nv1.size()];
-		soft_tcam_node<T, size> **parent = new soft_tcam_node<T, size> *[nv1.size()];
-		soft_tcam_entry<T, size> **entries = new soft_tcam_entry<T, size> *[nv1.size()];
-		std::uint64_t *access_counter = new std::uint64_t[nv1.size()];
-		for (std::uint32_t i = 0; i < nv1.size(); ++i) {
-			data[i] = nv1[i]->get_data();
-			mask[i] = nv1[i]->get_mask();
-			position[i] = nv1[i]->get_position();
-			n0[i] = nv1[i]->get_n0();
-			n1[i] = nv1[i]->get_n1();
-			ndc[i] = nv1[i]->get_ndc();
-			parent[i] = nv1[i]->get_parent();
-			entries[i] = nv1[i]->get_entry_head();
-			access_counter[i] = nv1[i]->get_access_counter();
-		}
-		for (std::uint32_t i = 0; i < nv1.size(); ++i) {
-			nv2[i]->set_data(data[i]);
-			nv2[i]->set_mask(mask[i]);
-			nv2[i]->set_position(position[i]);
-			nv2[i]->set_n0(nm.at(n0[i]));
-			nv2[i]->set_n1(nm.at(n1[i]));
-			nv2[i]->set_ndc(nm.at(ndc[i]));
-			nv2[i]->set_parent(nm.at(parent[i]));
-			nv2[i]->set_entry_head(em.at(entries[i]));
-			nv2[i]->set_access_counter(access_counter[i]);
-		}
-		delete[] data;
-		delete[] mask;
-		delete[] position;
-		delete[] n0;
-		delete[] n1;
-		delete[] ndc;
-		delete[] parent;
-		delete[] entries;
-		delete[] access_counter;
-		std::cerr << "done." << std::endl;
-	}
-
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	static void
-	sort_entries(std::vector<soft_tcam_entry<T, size> *> &ev1, std::vector<soft_tcam_entry<T, size> *> &ev2,
-			std::map<soft_tcam_node<T, size> *, soft_tcam_node<T, size> *> &nm,
-			std::map<soft_tcam_entry<T, size> *, soft_tcam_entry<T, size> *> &em)
+	sort_entries(std::vector<soft_tcam_entry<T, size, counter> *> &ev1, std::vector<soft_tcam_entry<T, size, counter> *> &ev2,
+			std::map<soft_tcam_entry<T, size, counter> *, soft_tcam_entry<T, size, counter> *> &em)
 	{
 		std::cerr << "Sorting entries...";
 		std::uint32_t *priority = new std::uint32_t[ev1.size()];
-		T *object = new T[ev1.size()];
-		soft_tcam_entry<T, size> **next = new soft_tcam_entry<T, size> *[ev1.size()];
-		soft_tcam_entry<T, size> **prev = new soft_tcam_entry<T, size> *[ev1.size()];
-		soft_tcam_node<T, size> **node = new soft_tcam_node<T, size> *[ev1.size()];
+		std::vector<T> object;
+		soft_tcam_entry<T, size, counter> **next = new soft_tcam_entry<T, size, counter> *[ev1.size()];
+		soft_tcam_entry<T, size, counter> **prev = new soft_tcam_entry<T, size, counter> *[ev1.size()];
+		std::uint32_t *node = new std::uint32_t[ev1.size()];
 		std::uint64_t *access_counter = new std::uint64_t[ev1.size()];
+		/*
+		 * objects are moved, not copied, and need no default constructor.
+		 */
+		object.reserve(ev1.size());
 		for (std::uint32_t i = 0; i < ev1.size(); ++i) {
 			priority[i] = ev1[i]->get_priority();
-			object[i] = ev1[i]->get_object();
+			object.push_back(ev1[i]->take_object());
 			next[i] = ev1[i]->get_next();
 			prev[i] = ev1[i]->get_prev();
 			node[i] = ev1[i]->get_node();
@@ -632,14 +2116,13 @@ retry:
 		}
 		for (std::uint32_t i = 0; i < ev1.size(); ++i) {
 			ev2[i]->set_priority(priority[i]);
-			ev2[i]->set_object(object[i]);
+			ev2[i]->set_object(std::move(object[i]));
 			ev2[i]->set_next(em.at(next[i]));
 			ev2[i]->set_prev(em.at(prev[i]));
-			ev2[i]->set_node(nm.at(node[i]));
+			ev2[i]->set_node(node[i]);
 			ev2[i]->set_access_counter(access_counter[i]);
 		}
 		delete[] priority;
-		delete[] object;
 		delete[] next;
 		delete[] prev;
 		delete[] node;
@@ -647,144 +2130,132 @@ retry:
 		std::cerr << "done." << std::endl;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam<T, size>::sort_best()
+	soft_tcam<T, size, counter>::sort_nodes(bool worst)
 	{
-		std::vector<soft_tcam_node<T, size> *> nv1, nv2;
-		std::vector<soft_tcam_entry<T, size> *> ev1, ev2;
-		std::map<soft_tcam_node<T, size> *, soft_tcam_node<T, size> *> nm;
-		std::map<soft_tcam_entry<T, size> *, soft_tcam_entry<T, size> *> em;
-		soft_tcam_node<T, size> *node;
-		soft_tcam_entry<T, size> *entry;
-		soft_tcam<T, size> *tcam;
+		std::vector<std::uint32_t> nv1, nv2, nm;
+		std::map<std::uint64_t, std::queue<std::uint32_t>> nvm;
+		std::vector<soft_tcam_node<T, size, counter>, soft_tcam_allocator<soft_tcam_node<T, size, counter>>>
+			nodes(m_nodes.get_allocator());
+		std::vector<soft_tcam_node_cold<T, size, counter>> colds;
+		soft_tcam_entry<T, size, counter> *entry;
 
-		std::cerr << "Making sorted node index...";
-		node = soft_tcam_node<T, size>::get_list_head();
-		while (node != nullptr) {
-			nv1.push_back(node);
-			node = node->get_list_next();
-		}
-		nv2 = nv1;
-		std::sort(nv1.begin(), nv1.end(), comp_node_by_access_counter<T, size>);
-		std::sort(nv2.begin(), nv2.end(), comp_node_by_memory_address<T, size>);
-		for (std::uint32_t i = 0; i < nv1.size(); ++i) {
-			nm.insert(std::make_pair(nv1[i], nv2[i]));
-		}
-		nm.insert(std::make_pair(nullptr, nullptr));
-		std::cerr << "done." << std::endl;
+		std::cerr << "Sorting nodes...";
 
-		std::cerr << "Making sorted entry index...";
-		entry = soft_tcam_entry<T, size>::get_list_head();
-		while (entry != nullptr) {
-			ev1.push_back(entry);
-			entry = entry->get_list_next();
-		}
-		ev2 = ev1;
-		std::sort(ev1.begin(), ev1.end(), comp_entry_by_access_counter<T, size>);
-		std::sort(ev2.begin(), ev2.end(), comp_entry_by_memory_address<T, size>);
-		for (std::uint32_t i = 0; i < ev1.size(); ++i) {
-			em.insert(std::make_pair(ev1[i], ev2[i]));
+		for (std::uint32_t i = 1; i < m_nodes.size(); ++i) {
+			if (!m_nodes[i].is_free()) {
+				nv1.push_back(i);
+			}
 		}
-		em.insert(std::make_pair(nullptr, nullptr));
-		std::cerr << "done." << std::endl;
+		std::stable_sort(nv1.begin(), nv1.end(),
+				[this](std::uint32_t l, std::uint32_t r) {
+					return m_nodes[l].get_access_counter() > m_nodes[r].get_access_counter();
+				});
 
 		/*
-		for (std::uint32_t i = 0; i < nv1.size(); ++i) {
-			std::cerr << "nv1[" << i << "]:" << nv1[i]
-				  << " <=> "
-				  << "nv2[" << i << "]:" << nv2[i]
-				  << " " << nv1[i]->get_access_counter()
-				  << std::endl;
-		}
-		*/
-
-		tcam = s_list_head;
-		while (tcam != nullptr) {
-			tcam->m_root = nm.at(tcam->m_root);
-			tcam = tcam->m_list_next;
+		 * the hottest node gets the first free slot. for worst, slots are
+		 * handed out round robin over the 4 KiB pages the array spans.
+		 */
+		for (std::uint32_t i = 1; i <= nv1.size(); ++i) {
+			nv2.push_back(i);
 		}
-		sort_nodes(nv1, nv2, nm, em);
-		sort_entries(ev1, ev2, nm, em);
-	}
-
-	template<class T, size_t size>
-	void
-	soft_tcam<T, size>::sort_worst()
-	{
-		std::vector<soft_tcam_node<T, size> *> nv1, nv2;
-		std::vector<soft_tcam_entry<T, size> *> ev1, ev2;
-		std::map<soft_tcam_node<T, size> *, soft_tcam_node<T, size> *> nm;
-		std::map<soft_tcam_entry<T, size> *, soft_tcam_entry<T, size> *> em;
-		std::map<std::uint64_t, std::queue<soft_tcam_node<T, size> *>> nvm;
-		std::map<std::uint64_t, std::queue<soft_tcam_entry<T, size> *>> evm;
-		soft_tcam_node<T, size> *node;
-		soft_tcam_entry<T, size> *entry;
-		soft_tcam<T, size> *tcam;
-
-		std::cerr << "Making sorted node index...";
-		node = soft_tcam_node<T, size>::get_list_head();
-		while (node != nullptr) {
-			nv1.push_back(node);
-			node = node->get_list_next();
-		}
-		nv2 = nv1;
-		std::sort(nv1.begin(), nv1.end(), comp_node_by_access_counter<T, size>);
-		std::sort(nv2.begin(), nv2.end(), comp_node_by_memory_address<T, size>);
-		for (std::uint32_t i = 0; i < nv2.size(); ++i) {
-			std::uint64_t k = reinterpret_cast<std::uint64_t>(nv2[i]) / 4096;
-			if (nvm.count(k) > 0) {
-				nvm.at(k).push(nv2[i]);
-			} else {
-				std::queue<soft_tcam_node<T, size> *> q;
-				q.push(nv2[i]);
-				nvm.insert(std::make_pair(k, q));
-			}
-		}
-		std::uint32_t nremain = nv2.size();
-		nv2.clear();
-		while (nremain > 0) {
-			for (auto it = nvm.begin(); it != nvm.end(); ++it) {
-				if (!it->second.empty()) {
-					nv2.push_back(it->second.front());
-					it->second.pop();
-					--nremain;
+		if (worst) {
+			for (std::uint32_t i = 0; i < nv2.size(); ++i) {
+				std::uint64_t k = nv2[i] * sizeof(soft_tcam_node<T, size, counter>) / 4096;
+				nvm[k].push(nv2[i]);
+			}
+			std::uint32_t nremain = nv2.size();
+			nv2.clear();
+			while (nremain > 0) {
+				for (auto it = nvm.begin(); it != nvm.end(); ++it) {
+					if (!it->second.empty()) {
+						nv2.push_back(it->second.front());
+						it->second.pop();
+						--nremain;
+					}
 				}
 			}
 		}
+
+		nm.assign(m_nodes.size(), 0);
+		for (std::uint32_t i = 0; i < nv1.size(); ++i) {
+			nm[nv1[i]] = nv2[i];
+		}
+
+		nodes.resize(nv1.size() + 1);
+		colds.resize(nv1.size() + 1);
 		for (std::uint32_t i = 0; i < nv1.size(); ++i) {
-			nm.insert(std::make_pair(nv1[i], nv2[i]));
+			soft_tcam_node<T, size, counter> &n = nodes[nv2[i]];
+			soft_tcam_node_cold<T, size, counter> &c = colds[nv2[i]];
+			n = m_nodes[nv1[i]];
+			n.set_n0(nm[n.get_n0()]);
+			n.set_n1(nm[n.get_n1()]);
+			n.set_ndc(nm[n.get_ndc()]);
+			c = m_colds[nv1[i]];
+			c.set_parent(nm[c.get_parent()]);
+			entry = c.get_entry_head();
+			while (entry != nullptr) {
+				entry->set_node(nv2[i]);
+				entry = entry->get_next();
+			}
 		}
-		nm.insert(std::make_pair(nullptr, nullptr));
+
+		m_nodes.swap(nodes);
+		m_colds.swap(colds);
+		m_root = nm[m_root];
+		m_free = 0;
+		m_generation = ++s_generation;
+
 		std::cerr << "done." << std::endl;
+	}
 
-		std::cerr << "Making sorted entry index...";
-		entry = soft_tcam_entry<T, size>::get_list_head();
-		while (entry != nullptr) {
-			ev1.push_back(entry);
-			entry = entry->get_list_next();
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::sort_entry_heads(std::map<soft_tcam_entry<T, size, counter> *,
+			soft_tcam_entry<T, size, counter> *> &em)
+	{
+		for (std::uint32_t i = 1; i < m_colds.size(); ++i) {
+			if (!m_nodes[i].is_free()) {
+				m_colds[i].set_entry_head(em.at(m_colds[i].get_entry_head()));
+			}
 		}
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::sort_entry_arena(bool worst)
+	{
+		std::vector<soft_tcam_entry<T, size, counter> *> ev1, ev2;
+		std::map<soft_tcam_entry<T, size, counter> *, soft_tcam_entry<T, size, counter> *> em;
+		std::map<std::uint64_t, std::queue<soft_tcam_entry<T, size, counter> *>> evm;
+
+		std::cerr << "Making sorted entry index...";
+		m_entries.for_each([&ev1](soft_tcam_entry<T, size, counter> *entry) {
+					ev1.push_back(entry);
+				});
 		ev2 = ev1;
-		std::sort(ev1.begin(), ev1.end(), comp_entry_by_access_counter<T, size>);
-		std::sort(ev2.begin(), ev2.end(), comp_entry_by_memory_address<T, size>);
-		for (std::uint32_t i = 0; i < ev2.size(); ++i) {
-			std::uint64_t k = reinterpret_cast<std::uint64_t>(ev2[i]) / 4096;
-			if (evm.count(k) > 0) {
-				evm.at(k).push(ev2[i]);
-			} else {
-				std::queue<soft_tcam_entry<T, size> *> q;
-				q.push(ev2[i]);
-				evm.insert(std::make_pair(k, q));
-			}
-		}
-		std::uint32_t eremain = ev2.size();
-		ev2.clear();
-		while (eremain > 0) {
-			for (auto it = evm.begin(); it != evm.end(); ++it) {
-				if (!it->second.empty()) {
-					ev2.push_back(it->second.front());
-					it->second.pop();
-					--eremain;
+		std::sort(ev1.begin(), ev1.end(), comp_entry_by_access_counter<T, size, counter>);
+		std::sort(ev2.begin(), ev2.end(), comp_entry_by_memory_address<T, size, counter>);
+
+		/*
+		 * for worst, slots are handed out round robin over the 4 KiB
+		 * pages the arena spans.
+		 */
+		if (worst) {
+			for (std::uint32_t i = 0; i < ev2.size(); ++i) {
+				std::uint64_t k = reinterpret_cast<std::uint64_t>(ev2[i]) / 4096;
+				evm[k].push(ev2[i]);
+			}
+			std::uint32_t eremain = ev2.size();
+			ev2.clear();
+			while (eremain > 0) {
+				for (auto it = evm.begin(); it != evm.end(); ++it) {
+					if (!it->second.empty()) {
+						ev2.push_back(it->second.front());
+						it->second.pop();
+						--eremain;
+					}
 				}
 			}
 		}
@@ -794,82 +2265,103 @@ retry:
 		em.insert(std::make_pair(nullptr, nullptr));
 		std::cerr << "done." << std::endl;
 
+		sort_entry_heads(em);
+		sort_entries(ev1, ev2, em);
+
 		/*
-		for (std::uint32_t i = 0; i < nv1.size(); ++i) {
-			std::cerr << "nv1[" << i << "]:" << nv1[i]
-				  << " <=> "
-				  << "nv2[" << i << "]:" << nv2[i]
-				  << " " << nv1[i]->get_access_counter()
-				  << std::endl;
-		}
-		for (std::uint32_t i = 0; i < ev1.size(); ++i) {
-			std::cerr << "ev1[" << i << "]:" << ev1[i]
-				  << " <=> "
-				  << "ev2[" << i << "]:" << ev2[i]
-				  << " " << ev1[i]->get_access_counter()
-				  << std::endl;
+		 * a leaf may point to the object of its best entry, which has
+		 * moved.
+		 */
+		for (std::uint32_t i = 1; i < m_nodes.size(); ++i) {
+			if (!m_nodes[i].is_free() && (m_colds[i].get_entry_head() != nullptr)) {
+				m_nodes[i].set_object(&m_colds[i].get_entry_head()->get_object());
+			}
 		}
-		*/
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::sort_best()
+	{
+		soft_tcam<T, size, counter> *tcam;
 
 		tcam = s_list_head;
 		while (tcam != nullptr) {
-			tcam->m_root = nm.at(tcam->m_root);
+			tcam->sort_entry_arena(false);
+			tcam->sort_nodes(false);
 			tcam = tcam->m_list_next;
 		}
-		sort_nodes(nv1, nv2, nm, em);
-		sort_entries(ev1, ev2, nm, em);
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam<T, size>::clear_access_counter()
+	soft_tcam<T, size, counter>::sort_worst()
 	{
-		soft_tcam_node<T, size> *node;
-		soft_tcam_entry<T, size> *entry;
+		soft_tcam<T, size, counter> *tcam;
 
-		node = soft_tcam_node<T, size>::get_list_head();
-		while (node != nullptr) {
-			node->set_access_counter(0);
-			node = node->get_list_next();
+		tcam = s_list_head;
+		while (tcam != nullptr) {
+			tcam->sort_entry_arena(true);
+			tcam->sort_nodes(true);
+			tcam = tcam->m_list_next;
 		}
+	}
 
-		entry = soft_tcam_entry<T, size>::get_list_head();
-		while (entry != nullptr) {
-			entry->set_access_counter(0);
-			entry = entry->get_list_next();
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam<T, size, counter>::clear_access_counter()
+	{
+		soft_tcam<T, size, counter> *tcam;
+
+		tcam = s_list_head;
+		while (tcam != nullptr) {
+			for (std::uint32_t i = 1; i < tcam->m_nodes.size(); ++i) {
+				tcam->m_nodes[i].set_access_counter(0);
+			}
+			tcam->m_entries.for_each([](soft_tcam_entry<T, size, counter> *entry) {
+						entry->set_access_counter(0);
+					});
+			tcam = tcam->m_list_next;
 		}
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam<T, size>::dump_access_counter()
+	soft_tcam<T, size, counter>::dump_access_counter()
 	{
-		soft_tcam_node<T, size> *node;
-		soft_tcam_entry<T, size> *entry;
+		soft_tcam<T, size, counter> *tcam;
 		std::uint64_t n = 0, e = 0;
 
-		node = soft_tcam_node<T, size>::get_list_head();
-		while (node != nullptr) {
-			std::cout << "N\t" << node << "\t" << node->get_access_counter() << std::endl;
-			n += node->get_access_counter();
-			node = node->get_list_next();
+		tcam = s_list_head;
+		while (tcam != nullptr) {
+			for (std::uint32_t i = 1; i < tcam->m_nodes.size(); ++i) {
+				if (tcam->m_nodes[i].is_free()) {
+					continue;
+				}
+				std::cout << "N\t" << &tcam->m_nodes[i] << "\t" << tcam->m_nodes[i].get_access_counter() << std::endl;
+				n += tcam->m_nodes[i].get_access_counter();
+			}
+			tcam = tcam->m_list_next;
 		}
 
-		entry = soft_tcam_entry<T, size>::get_list_head();
-		while (entry != nullptr) {
-			std::cout << "E\t" << entry << "\t" << entry->get_access_counter() << std::endl;
-			e += entry->get_access_counter();
-			entry = entry->get_list_next();
+		tcam = s_list_head;
+		while (tcam != nullptr) {
+			tcam->m_entries.for_each([&e](soft_tcam_entry<T, size, counter> *entry) {
+						std::cout << "E\t" << entry << "\t" << entry->get_access_counter() << std::endl;
+						e += entry->get_access_counter();
+					});
+			tcam = tcam->m_list_next;
 		}
 
 		std::cout << " node total access  : " << n << std::endl;
 		std::cout << " entry total access : " << e << std::endl;
 	}
 
-	template<class T, size_t size>
-		soft_tcam<T, size> *soft_tcam<T, size>::s_list_head = nullptr;
-	template<class T, size_t size>
-		std::uint64_t soft_tcam<T, size>::s_alloc_counter = 0;
+	template<class T, size_t size, class counter>
+		soft_tcam<T, size, counter> *soft_tcam<T, size, counter>::s_list_head = nullptr;
+	template<class T, size_t size, class counter>
+		std::uint64_t soft_tcam<T, size, counter>::s_alloc_counter = 0;
+	template<class T, size_t size, class counter>
+		std::atomic<std::uint64_t> soft_tcam<T, size, counter>::s_generation(0);
 
 }
-
@@ -7,19 +7,35 @@
 #define SOFT_TCAM_H
 
 #include <cstdint>
+#include <atomic>
 #include <bitset>
 #include <stack>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <type_traits>
 
+#include "soft_tcam_bits.h"
+#include "soft_tcam_counter.h"
+#include "soft_tcam_order.h"
+#include "soft_tcam_snapshot.h"
+#include "soft_tcam_lpm.h"
+#include "soft_tcam_exact.h"
+#include "soft_tcam_cache.h"
+#include "soft_tcam_allocator.h"
+#include "soft_tcam_arena.h"
 #include "soft_tcam_node.h"
 #include "soft_tcam_entry.h"
 
 namespace soft_tcam {
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter = soft_tcam_counter_disabled>
 	class soft_tcam {
 
 	public:
 
+		typedef typename soft_tcam_bits<size>::key_type key_type;
+
 		/*
 		 * ctor
 		 */
@@ -45,23 +61,251 @@ namespace soft_tcam {
 		 */
 		int insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
 				const T &object);
+		int insert(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * emplace
+		 *
+		 * insert() with the object constructed in place from args, so
+		 * that T need not be copyable nor default constructible. a rule
+		 * that goes to the exact tier is constructed once and copied
+		 * there.
+		 */
+		template<class... Args>
+		int emplace(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+				Args &&...args);
+		template<class... Args>
+		int emplace(const key_type &data, const key_type &mask, std::uint32_t priority,
+				Args &&...args);
 
 		/*
 		 * erase
 		 */
 		int erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
 				const T &object);
+		int erase(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * erase without object
+		 *
+		 * erases a rule with data, mask and priority whatever its object,
+		 * the one inserted first if there are several, so that a T without
+		 * operator== can be erased. a T that can be copied still needs it,
+		 * since the copies in the exact and lpm tiers go by an equal object.
+		 */
+		int erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority);
+		int erase(const key_type &data, const key_type &mask, std::uint32_t priority);
 
 		/*
 		 * find
+		 *
+		 * with priority, also returns the priority of the rule found.
+		 *
+		 * a rule in the tree is found as a pointer to the object in its
+		 * entry, valid until the rule is erased, the table is destroyed or
+		 * the entries are moved (sort_best(), sort_worst(), set_order()).
+		 * every rule is in the tree unless set_exact(true) or
+		 * set_lpm(true) is called. those tiers hold copies in tables that
+		 * are rebuilt as they change, so a rule found there is valid only
+		 * until the next insert or erase.
 		 */
 		const T *find(const std::bitset<size> &key);
+		const T *find(const key_type &key);
+		const T *find(const key_type &key, std::uint32_t &priority);
+
+		/*
+		 * find with cache
+		 *
+		 * find() that first looks in the calling thread's cache and
+		 * remembers the result there. insert and erase bump the generation
+		 * of the table, which makes what the cache holds stale.
+		 */
+		const T *find(const std::bitset<size> &key, soft_tcam_cache<T, size> &cache);
+		const T *find(const key_type &key, soft_tcam_cache<T, size> &cache);
+
+		/*
+		 * find batch
+		 *
+		 * out[i] = find(keys[i]) for i in [0, n). several lookups advance
+		 * together one node at a time, prefetching the next node of each,
+		 * so that their cache misses overlap.
+		 */
+		void find_batch(const std::bitset<size> *keys, size_t n, const T **out);
+		void find_batch(const key_type *keys, size_t n, const T **out);
+
+		/*
+		 * find bulk
+		 *
+		 * out[i] = find(keys[i]) for i in [0, n), for large offline batches.
+		 * the keys are radix partitioned down the tree, so a node is read
+		 * once for all the keys that reach it instead of once per key.
+		 */
+		void find_bulk(const std::bitset<size> *keys, size_t n, const T **out);
+		void find_bulk(const key_type *keys, size_t n, const T **out);
+
+		/*
+		 * compile
+		 *
+		 * read only snapshot of the current rules for fast lookups. subtrees
+		 * with bucket_size rules or less are kept as buckets that are
+		 * scanned instead of walked. with max_stride, nodes without
+		 * wildcard branches close below them read up to max_stride bits
+		 * at once (at most 16).
+		 */
+		soft_tcam_snapshot<T, size> compile(std::uint32_t bucket_size = 0, std::uint32_t max_stride = 0);
+
+		/*
+		 * compile dag
+		 *
+		 * read only snapshot in which the rules under a wildcard branch are
+		 * copied into both the 0 and the 1 side, so that find follows one
+		 * path and never backtracks. identical subtrees are shared, which
+		 * makes it a DAG. once max_nodes nodes are made, the subtrees still
+		 * to be built keep their wildcard branches, as in compile().
+		 */
+		soft_tcam_snapshot<T, size> compile_dag(size_t max_nodes = 1 << 20);
+
+		/*
+		 * get entries
+		 *
+		 * appends every entry in the table, as passed to insert(), so that
+		 * other engines can be built from the same rules.
+		 */
+		void get_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+				std::vector<std::uint32_t> &priority, std::vector<T> &object);
+
+		/*
+		 * set lpm
+		 *
+		 * while every mask in the table is a prefix and longer prefixes
+		 * have higher priorities, the rules are also kept in a
+		 * soft_tcam_lpm and find() looks them up there instead of walking
+		 * the tree. off by default, since what find() returns from it is
+		 * only valid until the next insert or erase. only turns on when T
+		 * can be copied and default constructed.
+		 */
+		void set_lpm(bool enable);
+
+		/*
+		 * is lpm
+		 *
+		 * true if find() goes to the soft_tcam_lpm at the moment.
+		 */
+		bool is_lpm();
+
+		/*
+		 * set exact
+		 *
+		 * rules whose mask has every bit set are kept in a soft_tcam_exact
+		 * instead of the tree. find() probes it once first and only walks
+		 * the tree when the tree has a rule with a higher priority than the
+		 * exact match. off by default, since what find() returns from it is
+		 * only valid until the next insert or erase. only turns on when T
+		 * can be copied and default constructed.
+		 */
+		void set_exact(bool enable);
+
+		/*
+		 * get exact count
+		 *
+		 * number of rules held by the soft_tcam_exact.
+		 */
+		size_t get_exact_count();
+
+		/*
+		 * reserve
+		 *
+		 * makes room for rules rules, so that inserting them does not
+		 * allocate memory for the nodes, the entries, the mask dictionary
+		 * or, if set_exact(true) was called before, the exact match tier.
+		 * it also turns the lpm tier off (set_lpm(false)), which can not
+		 * be sized ahead of time.
+		 */
+		void reserve(size_t rules);
+
+		/*
+		 * set huge pages
+		 *
+		 * with enable, the nodes of the tree, and of the snapshots compiled
+		 * from it, are placed in 2 MiB pages and prefaulted (see
+		 * soft_tcam_allocator). with lock, they are also mlock()ed. the
+		 * nodes move to the new memory right away. off by default.
+		 */
+		void set_huge_pages(bool enable, bool lock = false);
+
+		/*
+		 * is huge pages
+		 */
+		bool is_huge_pages();
+
+		/*
+		 * get node count
+		 *
+		 * nodes in the tree. may be read from any thread.
+		 */
+		size_t get_node_count() const;
+
+		/*
+		 * get entry count
+		 *
+		 * rules in the tree, not counting the soft_tcam_exact. may be read
+		 * from any thread.
+		 */
+		size_t get_entry_count() const;
+
+		/*
+		 * get mask count
+		 *
+		 * masks in the dictionary of the tree, not counting mask 0. nodes
+		 * refer to their mask by a 16-bit id, so that wide keys do not
+		 * carry a second key in every node. a table holds at most 65535
+		 * masks, counting the masks of inner nodes, which are the rule
+		 * masks cut short at the bit they test. insert fails when fewer
+		 * than 2 are left.
+		 */
+		size_t get_mask_count() const;
+
+		/*
+		 * set order
+		 *
+		 * changes the bit test order. rules already in the table are
+		 * reinserted in the new order, their objects moved.
+		 */
+		int set_order(const soft_tcam_order<size> &order);
+
+		/*
+		 * get order
+		 */
+		const soft_tcam_order<size> &get_order();
+
+		/*
+		 * learn order
+		 *
+		 * set_order() with soft_tcam_order<size>::learn() of the rules in the
+		 * table.
+		 */
+		int learn_order();
 
 		/*
 		 * dump
 		 */
 		void dump();
 
+		/*
+		 * clear visit counter
+		 */
+		void clear_visit_counter();
+
+		/*
+		 * get visit counter
+		 *
+		 * nodes visited by find() since the last clear. always 0 unless the
+		 * counter policy is soft_tcam_counter_enabled.
+		 */
+		std::uint64_t get_visit_counter();
+
 		/*
 		 * sort best
 		 */
@@ -84,21 +328,159 @@ namespace soft_tcam {
 
 	private:
 
-		soft_tcam_node<T, size> *m_root;
-		soft_tcam<T, size> *m_list_next;
+		static const size_t batch_width = 16;
+		static const std::uint32_t lpm_first_bits = 16;
+		static const std::uint32_t lpm_group_bits = (size <= 32) ? 8 : 4;
+		static const std::uint32_t max_compile_stride = 16;
+		static const std::uint32_t dag_none = ~0u;
+		static const size_t max_masks = 1 << 16;
+		static const size_t min_mask_slots = 16;
+
+		struct dag_rule {
+			key_type data;
+			key_type mask;
+			std::uint32_t priority;
+			T object;
+		};
+
+		/*
+		 * children are dag node ids, dag_none for none. a leaf has the id
+		 * of its rule in rule.
+		 */
+		struct dag_node {
+			key_type data;
+			key_type mask;
+			std::uint32_t position;
+			std::uint32_t n0;
+			std::uint32_t n1;
+			std::uint32_t ndc;
+			std::uint32_t rule;
+			std::uint32_t priority;
+		};
+
+		/*
+		 * built maps the rule set of a subtree, with the mode and the first
+		 * bit in front, to the node made for it. shared maps the hash of a
+		 * node to the nodes with that hash.
+		 */
+		struct dag_state {
+			std::vector<dag_rule> rules;
+			std::vector<dag_node> nodes;
+			std::map<std::vector<std::uint32_t>, std::uint32_t> built;
+			std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> shared;
+			size_t max_nodes;
+		};
 
-		void destroy_node(soft_tcam_node<T, size> *node);
-		int insert_between(soft_tcam_node<T, size> *less, soft_tcam_node<T, size> *more,
-				soft_tcam_node<T, size> *node);
-		int erase_node(soft_tcam_node<T, size> *node);
-		soft_tcam_node<T, size> *find_nearest_node(const std::bitset<size> &data,
-				const std::bitset<size> &mask);
-		soft_tcam_entry<T, size> *find_entry(const std::bitset<size> &key);
-		void dump_node(soft_tcam_node<T, size> *node, int depth);
+		std::uint32_t m_root;
+		std::uint32_t m_free;
+		std::vector<soft_tcam_node<T, size, counter>, soft_tcam_allocator<soft_tcam_node<T, size, counter>>> m_nodes;
+		std::vector<soft_tcam_node_cold<T, size, counter>> m_colds;
+		std::atomic<size_t> m_node_count;
+		soft_tcam_arena<soft_tcam_entry<T, size, counter>> m_entries;
+		std::vector<key_type> m_masks;
+		std::vector<std::uint32_t> m_mask_refs;
+		std::vector<std::uint16_t> m_mask_free;
+		/*
+		 * open addressed index from mask to id, 0 for an empty slot. a
+		 * power of two of slots, at most half full, so never more than
+		 * 2 * max_masks.
+		 */
+		std::vector<std::uint16_t> m_mask_index;
+		soft_tcam<T, size, counter> *m_list_next;
+		counter m_visit_counter;
+		soft_tcam_order<size> m_order;
+		soft_tcam_lpm<T, size> m_lpm;
+		soft_tcam_exact<T, size> m_exact;
+		bool m_exact_enabled;
+		bool m_lpm_enabled;
+		bool m_lpm_ready;
+		std::uint32_t m_lpm_misses;
+		std::uint64_t m_generation;
 
-		static soft_tcam<T, size> *s_list_head;
+		/*
+		 * the exact and lpm tiers keep copies of the objects in default
+		 * constructed slots, so they are only used for such a T.
+		 */
+		typedef std::integral_constant<bool, std::is_copy_constructible<T>::value
+			&& std::is_default_constructible<T>::value> copyable;
+
+		template<class... Args>
+		soft_tcam_entry<T, size, counter> *insert_trie(const key_type &key_data, const key_type &key_mask,
+				std::uint32_t priority, Args &&...args);
+		template<class Match>
+		soft_tcam_entry<T, size, counter> *find_entry(const key_type &data, const key_type &mask,
+				std::uint32_t priority, Match match, std::uint32_t &node);
+		template<class Match>
+		int erase_trie(const key_type &data, const key_type &mask, std::uint32_t priority, Match match);
+		int erase_any(const key_type &data, const key_type &mask, std::uint32_t priority, std::true_type);
+		int erase_any(const key_type &data, const key_type &mask, std::uint32_t priority, std::false_type);
+		int insert_exact(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object, std::true_type);
+		int insert_exact(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object, std::false_type);
+		int erase_exact(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object, std::true_type);
+		int erase_exact(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object, std::false_type);
+		void clear_exact(std::true_type);
+		void clear_exact(std::false_type);
+		void insert_lpm(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object, std::true_type);
+		void insert_lpm(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object, std::false_type);
+		void erase_lpm(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object, std::true_type);
+		void erase_lpm(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object, std::false_type);
+		void rebuild_lpm(std::true_type);
+		void rebuild_lpm(std::false_type);
+		void take_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+				std::vector<std::uint32_t> &priority, std::vector<T> &object);
+		void take_exact_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+				std::vector<std::uint32_t> &priority, std::vector<T> &object, std::true_type);
+		void take_exact_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+				std::vector<std::uint32_t> &priority, std::vector<T> &object, std::false_type);
+		std::uint32_t new_node(const key_type &data, const key_type &mask, std::uint32_t position);
+		void delete_node(std::uint32_t node);
+		std::uint16_t acquire_mask(const key_type &mask);
+		void release_mask(std::uint16_t id);
+		size_t find_mask_slot(const key_type &mask) const;
+		void rehash_masks(size_t slots);
+		int insert_entry(std::uint32_t node, soft_tcam_entry<T, size, counter> *entry);
+		int erase_entry(std::uint32_t node, soft_tcam_entry<T, size, counter> *entry);
+		void update_best(std::uint32_t node);
+		void update_bound(std::uint32_t node);
+		void destroy_all();
+		int insert_between(std::uint32_t less, std::uint32_t more, std::uint32_t node);
+		int erase_node(std::uint32_t node);
+		void merge_node(std::uint32_t node);
+		std::uint32_t find_nearest_node(const key_type &data, const key_type &mask);
+		std::uint32_t find_entry(const key_type &key);
+		std::uint32_t choose_stride(std::uint32_t node, std::uint32_t max_stride,
+				const std::vector<std::uint32_t> &rules, std::uint32_t bucket_size);
+		bool count_stride(std::uint32_t node, std::uint32_t from, std::uint32_t to, std::uint32_t wild,
+				const std::vector<std::uint32_t> &rules, std::uint32_t bucket_size, std::uint64_t &filled);
+		std::uint32_t stride_target(std::uint32_t node, std::uint32_t stride, std::uint32_t value);
+		std::uint32_t build_dag(dag_state &state, const std::vector<std::uint32_t> &rules, std::uint32_t from,
+				bool replicate);
+		std::uint32_t share_dag_node(dag_state &state, const dag_node &node);
+		void find_bulk_node(std::uint32_t index, std::uint32_t prev, const key_type *keys,
+				std::uint32_t *first, std::uint32_t *last, std::uint32_t *best, std::uint32_t *priority);
+		void dump_node(std::uint32_t node, int depth);
+		void sort_nodes(bool worst);
+		void sort_entry_arena(bool worst);
+		void sort_entry_heads(std::map<soft_tcam_entry<T, size, counter> *,
+				soft_tcam_entry<T, size, counter> *> &em);
+
+		static soft_tcam<T, size, counter> *s_list_head;
 		static std::uint64_t s_alloc_counter;
 
+		/*
+		 * generations are handed out from here, so that no two tables
+		 * or points in time share one, even at the same address.
+		 */
+		static std::atomic<std::uint64_t> s_generation;
+
 	};
 
 }
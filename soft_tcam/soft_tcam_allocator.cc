@@ -0,0 +1,160 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+
+#include "soft_tcam_allocator.h"
+
+namespace soft_tcam {
+
+	template<class U>
+	const size_t soft_tcam_allocator<U>::page_size;
+
+	template<class U>
+	const size_t soft_tcam_allocator<U>::huge_page_size;
+
+	template<class U>
+	soft_tcam_allocator<U>::soft_tcam_allocator(bool huge, bool lock)
+	{
+		m_huge = huge;
+		m_lock = lock;
+	}
+
+	template<class U>
+	template<class V>
+	soft_tcam_allocator<U>::soft_tcam_allocator(const soft_tcam_allocator<V> &other)
+	{
+		m_huge = other.is_huge();
+		m_lock = other.is_lock();
+	}
+
+	template<class U>
+	U *
+	soft_tcam_allocator<U>::allocate(size_t n)
+	{
+		void *p;
+
+		if (!m_huge && !m_lock) {
+			return static_cast<U *>(::operator new(n * sizeof(U)));
+		}
+
+		p = map(get_length(n));
+		if (p == nullptr) {
+			throw std::bad_alloc();
+		}
+
+		return static_cast<U *>(p);
+	}
+
+	template<class U>
+	void
+	soft_tcam_allocator<U>::deallocate(U *p, size_t n)
+	{
+		if (!m_huge && !m_lock) {
+			::operator delete(p);
+			return;
+		}
+
+		munmap(p, get_length(n));
+	}
+
+	template<class U>
+	bool
+	soft_tcam_allocator<U>::is_huge() const
+	{
+		return m_huge;
+	}
+
+	template<class U>
+	bool
+	soft_tcam_allocator<U>::is_lock() const
+	{
+		return m_lock;
+	}
+
+	template<class U>
+	size_t
+	soft_tcam_allocator<U>::get_length(size_t n) const
+	{
+		size_t bytes = n * sizeof(U);
+
+		/*
+		 * below 1 MiB, rounding up to a huge page would waste more than
+		 * the array.
+		 */
+		if (m_huge && (bytes >= huge_page_size / 2)) {
+			return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+		}
+
+		return (bytes + page_size - 1) / page_size * page_size;
+	}
+
+	template<class U>
+	void *
+	soft_tcam_allocator<U>::map(size_t length) const
+	{
+		char *p = static_cast<char *>(MAP_FAILED);
+
+		if (m_huge && (length % huge_page_size == 0)) {
+			p = static_cast<char *>(mmap(nullptr, length, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0));
+		}
+		if ((p == MAP_FAILED) && m_huge && (length % huge_page_size == 0)) {
+			/*
+			 * no reserved huge pages. map one page more, trim it down to
+			 * a 2 MiB aligned range and let transparent huge pages back
+			 * it.
+			 */
+			char *q = static_cast<char *>(mmap(nullptr, length + huge_page_size, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+			if (q == MAP_FAILED) {
+				return nullptr;
+			}
+			p = reinterpret_cast<char *>((reinterpret_cast<std::uintptr_t>(q) + huge_page_size - 1)
+					& ~std::uintptr_t(huge_page_size - 1));
+			if (p > q) {
+				munmap(q, p - q);
+			}
+			munmap(p + length, q + huge_page_size - p);
+			madvise(p, length, MADV_HUGEPAGE);
+		}
+		if (p == MAP_FAILED) {
+			p = static_cast<char *>(mmap(nullptr, length, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+			if (p == MAP_FAILED) {
+				return nullptr;
+			}
+		}
+
+		/*
+		 * prefault. a write makes the kernel back the page now.
+		 */
+		for (size_t i = 0; i < length; i += page_size) {
+			static_cast<volatile char *>(p)[i] = 0;
+		}
+		if (m_lock && (mlock(p, length) != 0)) {
+			std::cerr << "soft_tcam_allocator: mlock error." << std::endl;
+		}
+
+		return p;
+	}
+
+	template<class U, class V>
+	bool
+	operator==(const soft_tcam_allocator<U> &l, const soft_tcam_allocator<V> &r)
+	{
+		return (l.is_huge() == r.is_huge()) && (l.is_lock() == r.is_lock());
+	}
+
+	template<class U, class V>
+	bool
+	operator!=(const soft_tcam_allocator<U> &l, const soft_tcam_allocator<V> &r)
+	{
+		return !(l == r);
+	}
+
+}
@@ -0,0 +1,95 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_ALLOCATOR_H
+#define SOFT_TCAM_ALLOCATOR_H
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_allocator
+	 *
+	 * allocator for the arrays a lookup walks. by default it is the same
+	 * as std::allocator. with huge, an array of 1 MiB or more is mapped
+	 * in 2 MiB pages, so that a random lookup takes fewer TLB misses. it
+	 * asks for MAP_HUGETLB first and, when no such pages are reserved,
+	 * maps 2 MiB aligned memory with madvise(MADV_HUGEPAGE). smaller
+	 * arrays are mapped in 4 KiB pages. mapped memory is touched before
+	 * it is handed out, so that it is not page faulted later, and with
+	 * lock it is also mlock()ed.
+	 *
+	 * the allocator goes with the array when it is moved, swapped or
+	 * copied.
+	 */
+	template<class U>
+	class soft_tcam_allocator {
+
+	public:
+
+		typedef U value_type;
+		typedef std::true_type propagate_on_container_copy_assignment;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		template<class V>
+		struct rebind {
+			typedef soft_tcam_allocator<V> other;
+		};
+
+		/*
+		 * ctor
+		 */
+		soft_tcam_allocator(bool huge = false, bool lock = false);
+		template<class V>
+		soft_tcam_allocator(const soft_tcam_allocator<V> &other);
+
+		/*
+		 * allocate
+		 */
+		U *allocate(size_t n);
+
+		/*
+		 * deallocate
+		 */
+		void deallocate(U *p, size_t n);
+
+		/*
+		 * is huge
+		 */
+		bool is_huge() const;
+
+		/*
+		 * is lock
+		 */
+		bool is_lock() const;
+
+		static const size_t page_size = 4096;
+		static const size_t huge_page_size = 2 * 1024 * 1024;
+
+	private:
+
+		size_t get_length(size_t n) const;
+		void *map(size_t length) const;
+
+		bool m_huge;
+		bool m_lock;
+
+	};
+
+	template<class U, class V>
+	bool operator==(const soft_tcam_allocator<U> &l, const soft_tcam_allocator<V> &r);
+
+	template<class U, class V>
+	bool operator!=(const soft_tcam_allocator<U> &l, const soft_tcam_allocator<V> &r);
+
+}
+
+#include "soft_tcam_allocator.cc"
+
+#endif // SOFT_TCAM_ALLOCATOR_H
@@ -0,0 +1,145 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <new>
+#include <utility>
+
+#include "soft_tcam_arena.h"
+
+namespace soft_tcam {
+
+	template<class U>
+	soft_tcam_arena<U>::soft_tcam_arena(size_t chunk_size)
+		: m_count(0)
+	{
+		m_free = nullptr;
+		m_chunk = 0;
+		m_fresh = 0;
+		m_capacity = 0;
+		m_chunk_size = (chunk_size > 0) ? chunk_size : 1;
+	}
+
+	template<class U>
+	soft_tcam_arena<U>::~soft_tcam_arena()
+	{
+		clear();
+	}
+
+	template<class U>
+	template<class... Args>
+	U *
+	soft_tcam_arena<U>::alloc(Args &&...args)
+	{
+		slot *s;
+
+		/*
+		 * the slot is taken only once the object is constructed.
+		 */
+		if (m_free != nullptr) {
+			s = m_free;
+			new (&s->storage) U(std::forward<Args>(args)...);
+			m_free = s->next;
+		} else {
+			while ((m_chunk < m_chunks.size()) && (m_fresh == m_chunks[m_chunk].size)) {
+				++m_chunk;
+				m_fresh = 0;
+			}
+			if (m_chunk == m_chunks.size()) {
+				add_chunk(m_chunk_size);
+			}
+			s = &m_chunks[m_chunk].slots[m_fresh];
+			new (&s->storage) U(std::forward<Args>(args)...);
+			++m_fresh;
+		}
+		s->live = true;
+		m_count.fetch_add(1, std::memory_order_relaxed);
+
+		return reinterpret_cast<U *>(&s->storage);
+	}
+
+	template<class U>
+	void
+	soft_tcam_arena<U>::free(U *object)
+	{
+		slot *s = reinterpret_cast<slot *>(object);
+
+		object->~U();
+		s->live = false;
+		s->next = m_free;
+		m_free = s;
+		m_count.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	template<class U>
+	void
+	soft_tcam_arena<U>::reserve(size_t n)
+	{
+		if (n > m_capacity) {
+			add_chunk(n - m_capacity);
+		}
+	}
+
+	template<class U>
+	void
+	soft_tcam_arena<U>::clear()
+	{
+		if (!std::is_trivially_destructible<U>::value) {
+			for_each([](U *object) {
+				object->~U();
+			});
+		}
+		m_free = nullptr;
+		m_chunk = 0;
+		m_fresh = 0;
+		m_count.store(0, std::memory_order_relaxed);
+	}
+
+	template<class U>
+	size_t
+	soft_tcam_arena<U>::get_count() const
+	{
+		return m_count.load(std::memory_order_relaxed);
+	}
+
+	template<class U>
+	size_t
+	soft_tcam_arena<U>::get_capacity() const
+	{
+		return m_capacity;
+	}
+
+	template<class U>
+	template<class F>
+	void
+	soft_tcam_arena<U>::for_each(F f)
+	{
+		/*
+		 * every slot before the fresh one has been handed out once, so
+		 * its live flag is set.
+		 */
+		for (size_t c = 0; (c <= m_chunk) && (c < m_chunks.size()); ++c) {
+			size_t n = (c == m_chunk) ? m_fresh : m_chunks[c].size;
+			for (size_t i = 0; i < n; ++i) {
+				slot &s = m_chunks[c].slots[i];
+				if (s.live) {
+					f(reinterpret_cast<U *>(&s.storage));
+				}
+			}
+		}
+	}
+
+	template<class U>
+	void
+	soft_tcam_arena<U>::add_chunk(size_t n)
+	{
+		chunk c;
+
+		c.slots.reset(new slot[n]);
+		c.size = n;
+		m_chunks.push_back(std::move(c));
+		m_capacity += n;
+	}
+
+}
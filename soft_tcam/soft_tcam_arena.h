@@ -0,0 +1,129 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_ARENA_H
+#define SOFT_TCAM_ARENA_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_arena
+	 *
+	 * pool of objects of one type, owned by one table. the objects live in
+	 * chunks that are never moved, so pointers to them stay valid until
+	 * they are freed. alloc and free are O(1): freed slots are kept in a
+	 * list and handed out first, and slots that were never used are taken
+	 * from the chunks in order. memory only comes from malloc when every
+	 * chunk is in use, so after reserve(n) the first n allocations do not
+	 * call it.
+	 */
+	template<class U>
+	class soft_tcam_arena {
+
+	public:
+
+		/*
+		 * ctor
+		 *
+		 * chunk_size is the number of objects in a chunk added by alloc().
+		 */
+		soft_tcam_arena(size_t chunk_size = 1024);
+
+		/*
+		 * dtor
+		 */
+		~soft_tcam_arena();
+
+		/*
+		 * alloc
+		 *
+		 * an object constructed in place from args. if the constructor
+		 * throws, the slot stays free.
+		 */
+		template<class... Args>
+		U *alloc(Args &&...args);
+
+		/*
+		 * free
+		 */
+		void free(U *object);
+
+		/*
+		 * reserve
+		 *
+		 * makes room for n objects in all.
+		 */
+		void reserve(size_t n);
+
+		/*
+		 * clear
+		 *
+		 * frees every object and keeps the memory. O(1) when U has a
+		 * trivial destructor.
+		 */
+		void clear();
+
+		/*
+		 * get count
+		 *
+		 * objects allocated and not freed. may be read from any thread.
+		 */
+		size_t get_count() const;
+
+		/*
+		 * get capacity
+		 */
+		size_t get_capacity() const;
+
+		/*
+		 * for each
+		 *
+		 * calls f(U *) for every object allocated and not freed, in the
+		 * order of their slots.
+		 */
+		template<class F>
+		void for_each(F f);
+
+	private:
+
+		/*
+		 * the object comes first, so that a pointer to it is a pointer to
+		 * its slot.
+		 */
+		struct slot {
+			typename std::aligned_storage<sizeof(U), alignof(U)>::type storage;
+			slot *next;
+			bool live;
+		};
+
+		struct chunk {
+			std::unique_ptr<slot[]> slots;
+			size_t size;
+		};
+
+		void add_chunk(size_t n);
+
+		std::vector<chunk> m_chunks;
+		slot *m_free;
+		size_t m_chunk;
+		size_t m_fresh;
+		size_t m_capacity;
+		size_t m_chunk_size;
+		std::atomic<size_t> m_count;
+
+	};
+
+}
+
+#include "soft_tcam_arena.cc"
+
+#endif // SOFT_TCAM_ARENA_H
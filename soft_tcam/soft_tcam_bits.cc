@@ -0,0 +1,479 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <cstring>
+
+#include "soft_tcam_bits.h"
+
+namespace soft_tcam {
+
+	/*
+	 * std::bitset is an array of unsigned long with bit i in word i / word_bits
+	 * at position i % word_bits and the unused tail bits kept zero, both in
+	 * libstdc++ and libc++. When the sizes agree the conversions below copy the
+	 * words directly, otherwise they fall back to one bit at a time.
+	 */
+
+	template<size_t size, class I>
+	typename soft_tcam_bits_integer<size, I>::key_type
+	soft_tcam_bits_integer<size, I>::from_bitset(const std::bitset<size> &bits)
+	{
+		key_type key = 0;
+
+		if (size <= 64) {
+			return key_type(bits.to_ullong());
+		}
+		if (sizeof(bits) == sizeof(key)) {
+			std::memcpy(&key, &bits, sizeof(key));
+			return key;
+		}
+		for (std::uint32_t i = 0; i < size; ++i) {
+			if (bits[i]) {
+				key |= key_type(1) << i;
+			}
+		}
+
+		return key;
+	}
+
+	template<size_t size, class I>
+	std::bitset<size>
+	soft_tcam_bits_integer<size, I>::to_bitset(const key_type &key)
+	{
+		std::bitset<size> bits;
+
+		if (size <= 64) {
+			return std::bitset<size>((unsigned long long)key);
+		}
+		if (sizeof(bits) == sizeof(key)) {
+			std::memcpy(&bits, &key, sizeof(key));
+			return bits;
+		}
+		for (std::uint32_t i = 0; i < size; ++i) {
+			bits[i] = test(key, i);
+		}
+
+		return bits;
+	}
+
+	template<size_t size, class I>
+	bool
+	soft_tcam_bits_integer<size, I>::test(const key_type &key, std::uint32_t position)
+	{
+		return ((key >> position) & 1) != 0;
+	}
+
+	template<size_t size, class I>
+	void
+	soft_tcam_bits_integer<size, I>::set(key_type &key, std::uint32_t position)
+	{
+		key |= key_type(1) << position;
+	}
+
+	template<size_t size, class I>
+	std::uint32_t
+	soft_tcam_bits_integer<size, I>::get_byte(const key_type &key, std::uint32_t n)
+	{
+		return std::uint32_t(key >> (n * 8)) & 0xff;
+	}
+
+	template<size_t size, class I>
+	std::uint32_t
+	soft_tcam_bits_integer<size, I>::get_bits(const key_type &key, std::uint32_t position, std::uint32_t count)
+	{
+		return std::uint32_t(key >> position) & ((std::uint32_t(1) << count) - 1);
+	}
+
+	template<size_t size, class I>
+	void
+	soft_tcam_bits_integer<size, I>::merge(key_type &key, const key_type &other)
+	{
+		key |= other;
+	}
+
+	template<size_t size, class I>
+	void
+	soft_tcam_bits_integer<size, I>::intersect(key_type &key, const key_type &other)
+	{
+		key &= other;
+	}
+
+	template<size_t size, class I>
+	std::uint64_t
+	soft_tcam_bits_integer<size, I>::hash(const key_type &key)
+	{
+		std::uint64_t h = 0;
+
+		for (std::uint32_t w = 0; w < digits; w += 64) {
+			h = (h ^ std::uint64_t(key >> w)) * 0x9e3779b97f4a7c15ULL;
+		}
+
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+
+		return h ^ (h >> 33);
+	}
+
+	template<size_t size, class I>
+	bool
+	soft_tcam_bits_integer<size, I>::is_valid(const key_type &data, const key_type &mask)
+	{
+		return ((data & ~mask) == 0) && ((mask & ~range_mask(0, size)) == 0);
+	}
+
+	template<size_t size, class I>
+	bool
+	soft_tcam_bits_integer<size, I>::is_match(const key_type &key, const key_type &data, const key_type &mask,
+			std::uint32_t from, std::uint32_t to)
+	{
+		return ((key ^ data) & mask & range_mask(from, to)) == 0;
+	}
+
+	template<size_t size, class I>
+	std::uint32_t
+	soft_tcam_bits_integer<size, I>::find_mismatch(const key_type &key, const key_type &data,
+			const key_type &mask, std::uint32_t from, std::uint32_t to)
+	{
+		key_type x = (key ^ data) & mask & range_mask(from, to);
+
+		return (x != 0) ? ctz(x) : to;
+	}
+
+	template<size_t size, class I>
+	std::uint32_t
+	soft_tcam_bits_integer<size, I>::find_difference(const key_type &data1, const key_type &mask1,
+			const key_type &data2, const key_type &mask2, std::uint32_t from, std::uint32_t to)
+	{
+		key_type x = ((data1 ^ data2) | (mask1 ^ mask2)) & range_mask(from, to);
+
+		return (x != 0) ? ctz(x) : to;
+	}
+
+	template<size_t size, class I>
+	void
+	soft_tcam_bits_integer<size, I>::clear_from(key_type &key, std::uint32_t position)
+	{
+		key &= range_mask(0, position);
+	}
+
+	template<size_t size, class I>
+	void
+	soft_tcam_bits_integer<size, I>::clear_below(key_type &key, std::uint32_t position)
+	{
+		key &= ~range_mask(0, position);
+	}
+
+	template<size_t size, class I>
+	std::uint32_t
+	soft_tcam_bits_integer<size, I>::prefix_length(const key_type &mask)
+	{
+		key_type x = ~mask & range_mask(0, size);
+
+		/*
+		 * the unset bits have to be a run from bit 0.
+		 */
+		if ((x & (x + 1)) != 0) {
+			return size + 1;
+		}
+		if (x == range_mask(0, size)) {
+			return 0;
+		}
+
+		return size - ctz(x + 1);
+	}
+
+	template<size_t size, class I>
+	typename soft_tcam_bits_integer<size, I>::key_type
+	soft_tcam_bits_integer<size, I>::prefix_mask(std::uint32_t length)
+	{
+		return range_mask(size - length, size);
+	}
+
+	template<size_t size, class I>
+	typename soft_tcam_bits_integer<size, I>::key_type
+	soft_tcam_bits_integer<size, I>::range_mask(std::uint32_t from, std::uint32_t to)
+	{
+		key_type m;
+
+		if (from >= to) {
+			return 0;
+		}
+		m = ~key_type(0) << from;
+		if (to < digits) {
+			m &= ~(~key_type(0) << to);
+		}
+
+		return m;
+	}
+
+	template<size_t size, class I>
+	std::uint32_t
+	soft_tcam_bits_integer<size, I>::ctz(key_type x)
+	{
+		std::uint64_t lo = std::uint64_t(x);
+
+		if ((digits <= 64) || (lo != 0)) {
+			return __builtin_ctzll(lo);
+		}
+		return 64 + __builtin_ctzll(std::uint64_t(x >> (digits / 2)));
+	}
+
+	template<size_t size>
+	typename soft_tcam_bits_array<size>::key_type
+	soft_tcam_bits_array<size>::from_bitset(const std::bitset<size> &bits)
+	{
+		key_type key;
+
+		if (sizeof(bits) == sizeof(key)) {
+			std::memcpy(&key, &bits, sizeof(key));
+			return key;
+		}
+		key.fill(0);
+		for (std::uint32_t i = 0; i < size; ++i) {
+			if (bits[i]) {
+				key[i / word_bits] |= word_type(1) << (i % word_bits);
+			}
+		}
+
+		return key;
+	}
+
+	template<size_t size>
+	std::bitset<size>
+	soft_tcam_bits_array<size>::to_bitset(const key_type &key)
+	{
+		std::bitset<size> bits;
+
+		if (sizeof(bits) == sizeof(key)) {
+			std::memcpy(&bits, &key, sizeof(key));
+			return bits;
+		}
+		for (std::uint32_t i = 0; i < size; ++i) {
+			bits[i] = test(key, i);
+		}
+
+		return bits;
+	}
+
+	template<size_t size>
+	bool
+	soft_tcam_bits_array<size>::test(const key_type &key, std::uint32_t position)
+	{
+		return ((key[position / word_bits] >> (position % word_bits)) & 1) != 0;
+	}
+
+	template<size_t size>
+	void
+	soft_tcam_bits_array<size>::set(key_type &key, std::uint32_t position)
+	{
+		key[position / word_bits] |= word_type(1) << (position % word_bits);
+	}
+
+	template<size_t size>
+	std::uint32_t
+	soft_tcam_bits_array<size>::get_byte(const key_type &key, std::uint32_t n)
+	{
+		return std::uint32_t(key[n * 8 / word_bits] >> (n * 8 % word_bits)) & 0xff;
+	}
+
+	template<size_t size>
+	std::uint32_t
+	soft_tcam_bits_array<size>::get_bits(const key_type &key, std::uint32_t position, std::uint32_t count)
+	{
+		std::uint32_t w = position / word_bits, o = position % word_bits;
+		word_type v = key[w] >> o;
+
+		if ((o + count > word_bits) && (w + 1 < words)) {
+			v |= key[w + 1] << (word_bits - o);
+		}
+
+		return std::uint32_t(v) & ((std::uint32_t(1) << count) - 1);
+	}
+
+	template<size_t size>
+	void
+	soft_tcam_bits_array<size>::merge(key_type &key, const key_type &other)
+	{
+		for (std::uint32_t w = 0; w < words; ++w) {
+			key[w] |= other[w];
+		}
+	}
+
+	template<size_t size>
+	void
+	soft_tcam_bits_array<size>::intersect(key_type &key, const key_type &other)
+	{
+		for (std::uint32_t w = 0; w < words; ++w) {
+			key[w] &= other[w];
+		}
+	}
+
+	template<size_t size>
+	std::uint64_t
+	soft_tcam_bits_array<size>::hash(const key_type &key)
+	{
+		std::uint64_t h = 0;
+
+		for (std::uint32_t w = 0; w < words; ++w) {
+			h = (h ^ key[w]) * 0x9e3779b97f4a7c15ULL;
+		}
+
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+
+		return h ^ (h >> 33);
+	}
+
+	template<size_t size>
+	std::uint32_t
+	soft_tcam_bits_array<size>::prefix_length(const key_type &mask)
+	{
+		std::uint32_t low = size, w;
+
+		for (w = 0; w < words; ++w) {
+			if (mask[w] != 0) {
+				low = w * word_bits + __builtin_ctzll(mask[w]);
+				break;
+			}
+		}
+		for (; (low < size) && (w < words); ++w) {
+			if ((mask[w] & range_mask(w, low, size)) != range_mask(w, low, size)) {
+				return size + 1;
+			}
+		}
+
+		return size - low;
+	}
+
+	template<size_t size>
+	typename soft_tcam_bits_array<size>::key_type
+	soft_tcam_bits_array<size>::prefix_mask(std::uint32_t length)
+	{
+		key_type key;
+
+		key.fill(0);
+		for (std::uint32_t w = (size - length) / word_bits; (length > 0) && (w < words); ++w) {
+			key[w] = range_mask(w, size - length, size);
+		}
+
+		return key;
+	}
+
+	template<size_t size>
+	typename soft_tcam_bits_array<size>::word_type
+	soft_tcam_bits_array<size>::range_mask(std::uint32_t w, std::uint32_t from, std::uint32_t to)
+	{
+		word_type m = ~word_type(0);
+
+		if (w == from / word_bits) {
+			m &= ~word_type(0) << (from % word_bits);
+		}
+		if ((w == (to - 1) / word_bits) && ((to % word_bits) != 0)) {
+			m &= ~(~word_type(0) << (to % word_bits));
+		}
+
+		return m;
+	}
+
+	template<size_t size>
+	bool
+	soft_tcam_bits_array<size>::is_valid(const key_type &data, const key_type &mask)
+	{
+		for (std::uint32_t w = 0; w < words; ++w) {
+			if ((data[w] & ~mask[w]) != 0) {
+				return false;
+			}
+		}
+
+		return (mask[words - 1] & ~range_mask(words - 1, 0, size)) == 0;
+	}
+
+	template<size_t size>
+	bool
+	soft_tcam_bits_array<size>::is_match(const key_type &key, const key_type &data, const key_type &mask,
+			std::uint32_t from, std::uint32_t to)
+	{
+		if (from >= to) {
+			return true;
+		}
+
+		for (std::uint32_t w = from / word_bits; w <= (to - 1) / word_bits; ++w) {
+			if (((key[w] ^ data[w]) & mask[w] & range_mask(w, from, to)) != 0) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template<size_t size>
+	std::uint32_t
+	soft_tcam_bits_array<size>::find_mismatch(const key_type &key, const key_type &data,
+			const key_type &mask, std::uint32_t from, std::uint32_t to)
+	{
+		word_type x;
+
+		if (from >= to) {
+			return to;
+		}
+
+		for (std::uint32_t w = from / word_bits; w <= (to - 1) / word_bits; ++w) {
+			x = (key[w] ^ data[w]) & mask[w] & range_mask(w, from, to);
+			if (x != 0) {
+				return w * word_bits + __builtin_ctzll(x);
+			}
+		}
+
+		return to;
+	}
+
+	template<size_t size>
+	std::uint32_t
+	soft_tcam_bits_array<size>::find_difference(const key_type &data1, const key_type &mask1,
+			const key_type &data2, const key_type &mask2, std::uint32_t from, std::uint32_t to)
+	{
+		word_type x;
+
+		if (from >= to) {
+			return to;
+		}
+
+		for (std::uint32_t w = from / word_bits; w <= (to - 1) / word_bits; ++w) {
+			x = ((data1[w] ^ data2[w]) | (mask1[w] ^ mask2[w])) & range_mask(w, from, to);
+			if (x != 0) {
+				return w * word_bits + __builtin_ctzll(x);
+			}
+		}
+
+		return to;
+	}
+
+	template<size_t size>
+	void
+	soft_tcam_bits_array<size>::clear_from(key_type &key, std::uint32_t position)
+	{
+		for (std::uint32_t w = position / word_bits; w < words; ++w) {
+			if (w == position / word_bits) {
+				key[w] &= ~(~word_type(0) << (position % word_bits));
+			} else {
+				key[w] = 0;
+			}
+		}
+	}
+
+	template<size_t size>
+	void
+	soft_tcam_bits_array<size>::clear_below(key_type &key, std::uint32_t position)
+	{
+		for (std::uint32_t w = 0; (w <= position / word_bits) && (w < words); ++w) {
+			if (w == position / word_bits) {
+				key[w] &= ~word_type(0) << (position % word_bits);
+			} else {
+				key[w] = 0;
+			}
+		}
+	}
+
+}
@@ -0,0 +1,297 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_BITS_H
+#define SOFT_TCAM_BITS_H
+
+#include <cstdint>
+#include <climits>
+#include <array>
+#include <bitset>
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_bits_integer
+	 *
+	 * key representation for sizes that fit in a native integer I.
+	 */
+	template<size_t size, class I>
+	class soft_tcam_bits_integer {
+
+	public:
+
+		typedef I key_type;
+
+		static const std::uint32_t digits = sizeof(I) * CHAR_BIT;
+
+		/*
+		 * from_bitset
+		 */
+		static key_type from_bitset(const std::bitset<size> &bits);
+
+		/*
+		 * to_bitset
+		 */
+		static std::bitset<size> to_bitset(const key_type &key);
+
+		/*
+		 * test
+		 */
+		static bool test(const key_type &key, std::uint32_t position);
+
+		/*
+		 * set
+		 */
+		static void set(key_type &key, std::uint32_t position);
+
+		/*
+		 * get_byte
+		 *
+		 * bits [8 * n, 8 * n + 8) of key.
+		 */
+		static std::uint32_t get_byte(const key_type &key, std::uint32_t n);
+
+		/*
+		 * get_bits
+		 *
+		 * bits [position, position + count) of key, count is at most 16.
+		 */
+		static std::uint32_t get_bits(const key_type &key, std::uint32_t position, std::uint32_t count);
+
+		/*
+		 * merge
+		 *
+		 * key |= other.
+		 */
+		static void merge(key_type &key, const key_type &other);
+
+		/*
+		 * intersect
+		 *
+		 * key &= other.
+		 */
+		static void intersect(key_type &key, const key_type &other);
+
+		/*
+		 * hash
+		 */
+		static std::uint64_t hash(const key_type &key);
+
+		/*
+		 * is_valid
+		 *
+		 * true if no bit is set in data where mask is 0 and nothing is set above size.
+		 */
+		static bool is_valid(const key_type &data, const key_type &mask);
+
+		/*
+		 * is_match
+		 *
+		 * true if ((key ^ data) & mask) is zero in [from, to).
+		 */
+		static bool is_match(const key_type &key, const key_type &data, const key_type &mask,
+				std::uint32_t from, std::uint32_t to);
+
+		/*
+		 * find_mismatch
+		 *
+		 * first position in [from, to) where ((key ^ data) & mask) is 1, or to.
+		 */
+		static std::uint32_t find_mismatch(const key_type &key, const key_type &data, const key_type &mask,
+				std::uint32_t from, std::uint32_t to);
+
+		/*
+		 * find_difference
+		 *
+		 * first position in [from, to) where data1/mask1 and data2/mask2 differ, or to.
+		 */
+		static std::uint32_t find_difference(const key_type &data1, const key_type &mask1,
+				const key_type &data2, const key_type &mask2, std::uint32_t from, std::uint32_t to);
+
+		/*
+		 * clear_from
+		 *
+		 * reset all bits at or above position.
+		 */
+		static void clear_from(key_type &key, std::uint32_t position);
+
+		/*
+		 * clear_below
+		 *
+		 * reset all bits below position.
+		 */
+		static void clear_below(key_type &key, std::uint32_t position);
+
+		/*
+		 * prefix_length
+		 *
+		 * n if mask is set exactly in [size - n, size), otherwise size + 1.
+		 */
+		static std::uint32_t prefix_length(const key_type &mask);
+
+		/*
+		 * prefix_mask
+		 *
+		 * mask set exactly in [size - length, size), length is at most size.
+		 */
+		static key_type prefix_mask(std::uint32_t length);
+
+	private:
+
+		static key_type range_mask(std::uint32_t from, std::uint32_t to);
+		static std::uint32_t ctz(key_type x);
+
+	};
+
+	/*
+	 * soft_tcam_bits_array
+	 *
+	 * key representation for sizes wider than any native integer.
+	 */
+	template<size_t size>
+	class soft_tcam_bits_array {
+
+	public:
+
+		typedef std::uint64_t word_type;
+
+		static const std::uint32_t word_bits = sizeof(word_type) * CHAR_BIT;
+		static const std::uint32_t words = (size + word_bits - 1) / word_bits;
+
+		typedef std::array<word_type, words> key_type;
+
+		/*
+		 * from_bitset
+		 */
+		static key_type from_bitset(const std::bitset<size> &bits);
+
+		/*
+		 * to_bitset
+		 */
+		static std::bitset<size> to_bitset(const key_type &key);
+
+		/*
+		 * test
+		 */
+		static bool test(const key_type &key, std::uint32_t position);
+
+		/*
+		 * set
+		 */
+		static void set(key_type &key, std::uint32_t position);
+
+		/*
+		 * get_byte
+		 */
+		static std::uint32_t get_byte(const key_type &key, std::uint32_t n);
+
+		/*
+		 * get_bits
+		 */
+		static std::uint32_t get_bits(const key_type &key, std::uint32_t position, std::uint32_t count);
+
+		/*
+		 * merge
+		 */
+		static void merge(key_type &key, const key_type &other);
+
+		/*
+		 * intersect
+		 */
+		static void intersect(key_type &key, const key_type &other);
+
+		/*
+		 * hash
+		 */
+		static std::uint64_t hash(const key_type &key);
+
+		/*
+		 * is_valid
+		 */
+		static bool is_valid(const key_type &data, const key_type &mask);
+
+		/*
+		 * is_match
+		 */
+		static bool is_match(const key_type &key, const key_type &data, const key_type &mask,
+				std::uint32_t from, std::uint32_t to);
+
+		/*
+		 * find_mismatch
+		 */
+		static std::uint32_t find_mismatch(const key_type &key, const key_type &data, const key_type &mask,
+				std::uint32_t from, std::uint32_t to);
+
+		/*
+		 * find_difference
+		 */
+		static std::uint32_t find_difference(const key_type &data1, const key_type &mask1,
+				const key_type &data2, const key_type &mask2, std::uint32_t from, std::uint32_t to);
+
+		/*
+		 * clear_from
+		 */
+		static void clear_from(key_type &key, std::uint32_t position);
+
+		/*
+		 * clear_below
+		 */
+		static void clear_below(key_type &key, std::uint32_t position);
+
+		/*
+		 * prefix_length
+		 */
+		static std::uint32_t prefix_length(const key_type &mask);
+
+		/*
+		 * prefix_mask
+		 */
+		static key_type prefix_mask(std::uint32_t length);
+
+	private:
+
+		static word_type range_mask(std::uint32_t w, std::uint32_t from, std::uint32_t to);
+
+	};
+
+	/*
+	 * soft_tcam_bits_width
+	 *
+	 * width of the native integer used for size, or 0 for a word array.
+	 */
+	template<size_t size>
+	struct soft_tcam_bits_width {
+		static const size_t value = (size <= 32) ? 32
+					  : (size <= 64) ? 64
+#ifdef __SIZEOF_INT128__
+					  : (size <= 128) ? 128
+#endif
+					  : 0;
+	};
+
+	template<size_t size, size_t width = soft_tcam_bits_width<size>::value>
+	class soft_tcam_bits : public soft_tcam_bits_array<size> {
+	};
+
+	template<size_t size>
+	class soft_tcam_bits<size, 32> : public soft_tcam_bits_integer<size, std::uint32_t> {
+	};
+
+	template<size_t size>
+	class soft_tcam_bits<size, 64> : public soft_tcam_bits_integer<size, std::uint64_t> {
+	};
+
+#ifdef __SIZEOF_INT128__
+	template<size_t size>
+	class soft_tcam_bits<size, 128> : public soft_tcam_bits_integer<size, unsigned __int128> {
+	};
+#endif
+
+}
+
+#include "soft_tcam_bits.cc"
+
+#endif // SOFT_TCAM_BITS_H
@@ -0,0 +1,133 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include "soft_tcam_cache.h"
+
+namespace soft_tcam {
+
+	template<class T, size_t size>
+	const std::uint32_t soft_tcam_cache<T, size>::ways;
+
+	template<class T, size_t size>
+	soft_tcam_cache<T, size>::soft_tcam_cache(size_t sets)
+	{
+		size_t count = 1;
+
+		while (count < sets) {
+			count *= 2;
+		}
+		m_sets.resize(count);
+		m_last = nullptr;
+		m_last_owner = nullptr;
+		m_last_generation = 0;
+		m_stale = ways;
+		m_hits = 0;
+		m_misses = 0;
+		clear();
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_cache<T, size>::clear()
+	{
+		for (auto it = m_sets.begin(); it != m_sets.end(); ++it) {
+			it->count = 0;
+		}
+	}
+
+	template<class T, size_t size>
+	std::uint64_t
+	soft_tcam_cache<T, size>::get_hit_counter() const
+	{
+		return m_hits;
+	}
+
+	template<class T, size_t size>
+	std::uint64_t
+	soft_tcam_cache<T, size>::get_miss_counter() const
+	{
+		return m_misses;
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_cache<T, size>::clear_counter()
+	{
+		m_hits = 0;
+		m_misses = 0;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_cache<T, size>::get_memory_size() const
+	{
+		return m_sets.size() * sizeof(set);
+	}
+
+	template<class T, size_t size>
+	bool
+	soft_tcam_cache<T, size>::lookup(const void *owner, std::uint64_t generation, const key_type &key,
+			const T *&result)
+	{
+		set *s;
+
+		s = &m_sets[soft_tcam_bits<size>::hash(key) & (m_sets.size() - 1)];
+		m_last = s;
+		m_last_owner = owner;
+		m_last_generation = generation;
+		m_stale = ways;
+
+		for (std::uint32_t i = 0; i < s->count; ++i) {
+			way &w = s->entries[i];
+			if ((w.owner != owner) || !(w.key == key)) {
+				continue;
+			}
+			if (w.generation != generation) {
+				m_stale = i;
+				break;
+			}
+			result = w.result;
+			if (i > 0) {
+				std::swap(s->entries[i], s->entries[i - 1]);
+			}
+			++m_hits;
+			return true;
+		}
+		++m_misses;
+
+		return false;
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_cache<T, size>::store(const key_type &key, const T *result)
+	{
+		set *s = m_last;
+		std::uint32_t i;
+
+		/*
+		 * the stale way of the key, or else the last way, falls out.
+		 */
+		if (m_stale < ways) {
+			i = m_stale;
+		} else {
+			i = std::min(s->count, ways - 1);
+			if (s->count < ways) {
+				++s->count;
+			}
+		}
+		for (; i > 0; --i) {
+			s->entries[i] = s->entries[i - 1];
+		}
+		s->entries[0].key = key;
+		s->entries[0].owner = m_last_owner;
+		s->entries[0].generation = m_last_generation;
+		s->entries[0].result = result;
+	}
+
+}
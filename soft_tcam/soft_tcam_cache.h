@@ -0,0 +1,111 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_CACHE_H
+#define SOFT_TCAM_CACHE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "soft_tcam_bits.h"
+
+namespace soft_tcam {
+
+	template<class T, size_t size, class counter> class soft_tcam;
+
+	/*
+	 * soft_tcam_cache
+	 *
+	 * set associative cache of find() results by full key, for the case
+	 * where a few flows carry most of the lookups. a cache is not shared,
+	 * every thread keeps its own and passes it to soft_tcam::find(). each
+	 * way remembers the table it was filled from and the generation of
+	 * that table, and insert and erase bump the generation of the table,
+	 * so a stale way is a miss and is replaced by the next store. nothing
+	 * is ever flushed, and tables used in turn share the cache.
+	 */
+	template<class T, size_t size>
+	class soft_tcam_cache {
+
+	public:
+
+		typedef typename soft_tcam_bits<size>::key_type key_type;
+
+		/*
+		 * ctor
+		 *
+		 * sets is rounded up to a power of two, each set has 4 ways.
+		 */
+		soft_tcam_cache(size_t sets = 1024);
+
+		/*
+		 * clear
+		 */
+		void clear();
+
+		/*
+		 * get hit counter
+		 */
+		std::uint64_t get_hit_counter() const;
+
+		/*
+		 * get miss counter
+		 */
+		std::uint64_t get_miss_counter() const;
+
+		/*
+		 * clear counter
+		 */
+		void clear_counter();
+
+		/*
+		 * get_memory_size
+		 */
+		size_t get_memory_size() const;
+
+	private:
+
+		template<class, size_t, class> friend class soft_tcam;
+
+		static const std::uint32_t ways = 4;
+
+		/*
+		 * a new key goes first and a hit moves up one way, so the
+		 * keys that are used most stay in the set.
+		 */
+		struct way {
+			key_type key;
+			const void *owner;
+			std::uint64_t generation;
+			const T *result;
+		};
+
+		struct set {
+			std::uint32_t count;
+			way entries[ways];
+		};
+
+		bool lookup(const void *owner, std::uint64_t generation, const key_type &key, const T *&result);
+		void store(const key_type &key, const T *result);
+
+		/*
+		 * the set, table and generation of the last lookup, and the way
+		 * that held a stale result for its key, or ways.
+		 */
+		std::vector<set> m_sets;
+		set *m_last;
+		const void *m_last_owner;
+		std::uint64_t m_last_generation;
+		std::uint32_t m_stale;
+		std::uint64_t m_hits;
+		std::uint64_t m_misses;
+
+	};
+
+}
+
+#include "soft_tcam_cache.cc"
+
+#endif // SOFT_TCAM_CACHE_H
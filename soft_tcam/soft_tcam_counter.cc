@@ -0,0 +1,50 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include "soft_tcam_counter.h"
+
+namespace soft_tcam {
+
+	inline void
+	soft_tcam_counter_disabled::count_access()
+	{
+	}
+
+	inline void
+	soft_tcam_counter_disabled::set_access_counter(std::uint64_t access_counter)
+	{
+	}
+
+	inline std::uint64_t
+	soft_tcam_counter_disabled::get_access_counter()
+	{
+		return 0;
+	}
+
+	inline
+	soft_tcam_counter_enabled::soft_tcam_counter_enabled()
+	{
+		m_access_counter = 0;
+	}
+
+	inline void
+	soft_tcam_counter_enabled::count_access()
+	{
+		++m_access_counter;
+	}
+
+	inline void
+	soft_tcam_counter_enabled::set_access_counter(std::uint64_t access_counter)
+	{
+		m_access_counter = access_counter;
+	}
+
+	inline std::uint64_t
+	soft_tcam_counter_enabled::get_access_counter()
+	{
+		return m_access_counter;
+	}
+
+}
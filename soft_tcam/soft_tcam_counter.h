@@ -0,0 +1,79 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_COUNTER_H
+#define SOFT_TCAM_COUNTER_H
+
+#include <cstdint>
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_counter_disabled
+	 *
+	 * access counter policy that records nothing. lookups do no stores.
+	 */
+	class soft_tcam_counter_disabled {
+
+	public:
+
+		/*
+		 * count_access
+		 */
+		void count_access();
+
+		/*
+		 * set_access_counter
+		 */
+		void set_access_counter(std::uint64_t access_counter);
+
+		/*
+		 * get_access_counter
+		 */
+		std::uint64_t get_access_counter();
+
+	};
+
+	/*
+	 * soft_tcam_counter_enabled
+	 *
+	 * access counter policy that counts every getter call. needed by sort_best
+	 * and sort_worst.
+	 */
+	class soft_tcam_counter_enabled {
+
+	public:
+
+		/*
+		 * ctor
+		 */
+		soft_tcam_counter_enabled();
+
+		/*
+		 * count_access
+		 */
+		void count_access();
+
+		/*
+		 * set_access_counter
+		 */
+		void set_access_counter(std::uint64_t access_counter);
+
+		/*
+		 * get_access_counter
+		 */
+		std::uint64_t get_access_counter();
+
+	private:
+
+		std::uint64_t m_access_counter;
+
+	};
+
+}
+
+#include "soft_tcam_counter.cc"
+
+#endif // SOFT_TCAM_COUNTER_H
@@ -0,0 +1,297 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <map>
+
+#include "soft_tcam_cuts.h"
+
+namespace soft_tcam {
+
+	template<class T, size_t size>
+	const std::uint32_t soft_tcam_cuts<T, size>::max_cut_bits;
+
+	template<class T, size_t size>
+	const std::uint32_t soft_tcam_cuts<T, size>::none;
+
+	template<class T, size_t size>
+	soft_tcam_cuts<T, size>::soft_tcam_cuts(const std::vector<std::uint32_t> &widths)
+	{
+		std::uint32_t msb = size;
+
+		for (auto it = widths.begin(); (it != widths.end()) && (msb > 0); ++it) {
+			std::uint32_t width = std::min(*it, msb);
+			if (width == 0) {
+				continue;
+			}
+			m_fields.push_back(field{msb - width, msb});
+			msb -= width;
+		}
+		if (msb > 0) {
+			m_fields.push_back(field{0, msb});
+		}
+
+		m_binth = 0;
+		m_spfac = 0;
+		m_depth = 0;
+		m_empty = none;
+	}
+
+	template<class T, size_t size>
+	template<class counter>
+	int
+	soft_tcam_cuts<T, size>::build(soft_tcam<T, size, counter> &tcam, std::uint32_t binth, double spfac)
+	{
+		std::vector<key_type> data, mask;
+		std::vector<std::uint32_t> priority;
+		std::vector<T> object;
+
+		tcam.get_entries(data, mask, priority, object);
+
+		return build(data, mask, priority, object, binth, spfac);
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_cuts<T, size>::build(const std::vector<key_type> &data, const std::vector<key_type> &mask,
+			const std::vector<std::uint32_t> &priority, const std::vector<T> &object,
+			std::uint32_t binth, double spfac)
+	{
+		std::vector<std::uint32_t> ids, fixed(m_fields.size(), 0);
+
+		if ((mask.size() != data.size()) || (priority.size() != data.size()) || (object.size() != data.size())) {
+			std::cerr << "build: rule list error." << std::endl;
+			return -1;
+		}
+		for (std::uint32_t i = 0; i < data.size(); ++i) {
+			if (!soft_tcam_bits<size>::is_valid(data[i], mask[i])) {
+				std::cerr << "build: data/mask error." << std::endl;
+				return -1;
+			}
+			ids.push_back(i);
+		}
+		std::stable_sort(ids.begin(), ids.end(),
+				[&](std::uint32_t l, std::uint32_t r) { return priority[l] > priority[r]; });
+
+		m_nodes.clear();
+		m_children.clear();
+		m_data.clear();
+		m_mask.clear();
+		m_priority.clear();
+		m_object.clear();
+		m_binth = binth;
+		m_spfac = spfac;
+		m_depth = 0;
+		m_empty = none;
+
+		build_node(data, mask, priority, object, ids, fixed, 0);
+
+		return 0;
+	}
+
+	template<class T, size_t size>
+	std::uint32_t
+	soft_tcam_cuts<T, size>::build_node(const std::vector<key_type> &data, const std::vector<key_type> &mask,
+			const std::vector<std::uint32_t> &priority, const std::vector<T> &object,
+			const std::vector<std::uint32_t> &ids, std::vector<std::uint32_t> &fixed,
+			std::uint32_t depth)
+	{
+		std::vector<std::uint32_t> counts, stay, child;
+		std::map<std::vector<std::uint32_t>, std::uint32_t> shared;
+		std::uint32_t index = m_nodes.size();
+		std::uint32_t best_field = none, best_bits = 0, best_max = 0, position;
+		std::uint64_t best_sum = 0;
+
+		m_nodes.push_back(node{0, 0, 0, 0, 0, ids.empty() ? 0 : priority[ids.front()]});
+		m_depth = std::max(m_depth, depth);
+
+		/*
+		 * for each field take the most cuts the space factor allows, then
+		 * pick the field with the fewest rules on the worst path, the rules
+		 * that stay at this node plus the largest child. a cut that leaves
+		 * every rule here separates nothing.
+		 */
+		for (std::uint32_t f = 0; (ids.size() > m_binth) && (f < m_fields.size()); ++f) {
+			std::uint32_t left = m_fields[f].high - m_fields[f].low - fixed[f];
+			std::uint32_t field_bits = 0, field_max = 0;
+			std::uint64_t field_sum = 0;
+			for (std::uint32_t b = 1; b <= std::min(left, max_cut_bits); ++b) {
+				std::uint64_t sum = 0;
+				std::uint32_t pushed = 0;
+				position = m_fields[f].high - fixed[f] - b;
+				counts.assign(std::uint32_t(1) << b, 0);
+				for (auto it = ids.begin(); it != ids.end(); ++it) {
+					std::uint32_t rm = soft_tcam_bits<size>::get_bits(mask[*it], position, b);
+					std::uint32_t rd = soft_tcam_bits<size>::get_bits(data[*it], position, b);
+					std::uint32_t wild = ~rm & ((std::uint32_t(1) << b) - 1);
+					if (rm == 0) {
+						++pushed;
+						continue;
+					}
+					for (std::uint32_t s = wild; ; s = (s - 1) & wild) {
+						++counts[rd | s];
+						++sum;
+						if (s == 0) {
+							break;
+						}
+					}
+				}
+				if ((b > 1) && (double(sum + counts.size()) > m_spfac * ids.size())) {
+					break;
+				}
+				if (sum == 0) {
+					continue;
+				}
+				field_bits = b;
+				field_max = pushed + *std::max_element(counts.begin(), counts.end());
+				field_sum = sum;
+			}
+			if (field_bits == 0) {
+				continue;
+			}
+			if ((best_field == none) || (field_max < best_max)
+			 || ((field_max == best_max) && (field_sum < best_sum))) {
+				best_field = f;
+				best_bits = field_bits;
+				best_max = field_max;
+				best_sum = field_sum;
+			}
+		}
+
+		if (best_field == none) {
+			stay = ids;
+		} else {
+			position = m_fields[best_field].high - fixed[best_field] - best_bits;
+			for (auto it = ids.begin(); it != ids.end(); ++it) {
+				if (soft_tcam_bits<size>::get_bits(mask[*it], position, best_bits) == 0) {
+					stay.push_back(*it);
+				}
+			}
+		}
+
+		m_nodes[index].rules = m_data.size();
+		m_nodes[index].count = stay.size();
+		for (auto it = stay.begin(); it != stay.end(); ++it) {
+			m_data.push_back(data[*it]);
+			m_mask.push_back(mask[*it]);
+			m_priority.push_back(priority[*it]);
+			m_object.push_back(object[*it]);
+		}
+
+		if (best_field == none) {
+			return index;
+		}
+
+		m_nodes[index].position = position;
+		m_nodes[index].bits = best_bits;
+		m_nodes[index].children = m_children.size();
+		m_children.resize(m_children.size() + (std::uint32_t(1) << best_bits), none);
+
+		/*
+		 * children with the same rules share one subtree, empty ones share
+		 * one leaf for the whole tree.
+		 */
+		fixed[best_field] += best_bits;
+		for (std::uint32_t c = 0; c < (std::uint32_t(1) << best_bits); ++c) {
+			std::uint32_t result;
+			child.clear();
+			for (auto it = ids.begin(); it != ids.end(); ++it) {
+				std::uint32_t rm = soft_tcam_bits<size>::get_bits(mask[*it], position, best_bits);
+				std::uint32_t rd = soft_tcam_bits<size>::get_bits(data[*it], position, best_bits);
+				if ((rm != 0) && (((c ^ rd) & rm) == 0)) {
+					child.push_back(*it);
+				}
+			}
+			if (child.empty() && (m_empty != none)) {
+				result = m_empty;
+			} else if (shared.count(child) != 0) {
+				result = shared[child];
+			} else {
+				result = build_node(data, mask, priority, object, child, fixed, depth + 1);
+				if (child.empty()) {
+					m_empty = result;
+				}
+				shared[child] = result;
+			}
+			m_children[m_nodes[index].children + c] = result;
+		}
+		fixed[best_field] -= best_bits;
+
+		return index;
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_cuts<T, size>::find(const std::bitset<size> &key) const
+	{
+		return find(soft_tcam_bits<size>::from_bitset(key));
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_cuts<T, size>::find(const key_type &key) const
+	{
+		const node *nodes = m_nodes.data();
+		const T *best = nullptr;
+		std::uint32_t best_priority = 0;
+		std::uint32_t index = 0, i;
+
+		if (m_nodes.empty()) {
+			return nullptr;
+		}
+
+		for (;;) {
+			const node *n = &nodes[index];
+			if ((best != nullptr) && (n->priority <= best_priority)) {
+				break;
+			}
+			if (n->count != 0) {
+				i = soft_tcam_scan_kernel<size>::find_first(key, &m_data[n->rules], &m_mask[n->rules], n->count);
+				if ((i != n->count) && ((best == nullptr) || (m_priority[n->rules + i] > best_priority))) {
+					best = &m_object[n->rules + i];
+					best_priority = m_priority[n->rules + i];
+				}
+			}
+			if (n->bits == 0) {
+				break;
+			}
+			index = m_children[n->children + soft_tcam_bits<size>::get_bits(key, n->position, n->bits)];
+		}
+
+		return best;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_cuts<T, size>::get_node_count() const
+	{
+		return m_nodes.size();
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_cuts<T, size>::get_rule_count() const
+	{
+		return m_data.size();
+	}
+
+	template<class T, size_t size>
+	std::uint32_t
+	soft_tcam_cuts<T, size>::get_depth() const
+	{
+		return m_depth;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_cuts<T, size>::get_memory_size() const
+	{
+		return m_nodes.size() * sizeof(node)
+			+ m_children.size() * sizeof(std::uint32_t)
+			+ m_data.size() * (sizeof(key_type) * 2 + sizeof(std::uint32_t) + sizeof(T));
+	}
+
+}
@@ -0,0 +1,135 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_CUTS_H
+#define SOFT_TCAM_CUTS_H
+
+#include <cstdint>
+#include <bitset>
+#include <vector>
+
+#include "soft_tcam_bits.h"
+#include "soft_tcam_scan.h"
+#include "soft_tcam.h"
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_cuts
+	 *
+	 * decision tree classifier in the style of HiCuts / HyperCuts, built
+	 * from a fixed rule list. the key is split into fields, and a node cuts
+	 * the next few unused bits (from the top) of one field into 2^bits equal
+	 * regions, one child each. rules that do not care about those bits stay
+	 * at the node instead of being copied into every child, and a node with
+	 * binth rules or less is a leaf. find follows one path from the root and
+	 * scans the rules on it, so it never backtracks.
+	 *
+	 * spfac bounds the number of cuts at a node: the rules copied into the
+	 * children plus the number of children may not exceed spfac times the
+	 * rules at the node. larger values give a shallower tree and more memory.
+	 */
+	template<class T, size_t size>
+	class soft_tcam_cuts {
+
+	public:
+
+		typedef typename soft_tcam_bits<size>::key_type key_type;
+
+		/*
+		 * ctor
+		 *
+		 * widths are the field widths from the most significant bit, as in
+		 * soft_tcam_order<size>::interleave(). the bits below the last field
+		 * form one more field. empty means one field for the whole key.
+		 */
+		soft_tcam_cuts(const std::vector<std::uint32_t> &widths = std::vector<std::uint32_t>());
+
+		/*
+		 * build
+		 */
+		template<class counter>
+		int build(soft_tcam<T, size, counter> &tcam, std::uint32_t binth = 8, double spfac = 2.0);
+		int build(const std::vector<key_type> &data, const std::vector<key_type> &mask,
+				const std::vector<std::uint32_t> &priority, const std::vector<T> &object,
+				std::uint32_t binth = 8, double spfac = 2.0);
+
+		/*
+		 * find
+		 */
+		const T *find(const std::bitset<size> &key) const;
+		const T *find(const key_type &key) const;
+
+		/*
+		 * get_node_count
+		 */
+		size_t get_node_count() const;
+
+		/*
+		 * get_rule_count
+		 *
+		 * rules stored in all nodes, counting copies.
+		 */
+		size_t get_rule_count() const;
+
+		/*
+		 * get_depth
+		 */
+		std::uint32_t get_depth() const;
+
+		/*
+		 * get_memory_size
+		 */
+		size_t get_memory_size() const;
+
+	private:
+
+		/*
+		 * the rules of a node are [rules, rules + count) sorted by
+		 * priority, highest first. its children are
+		 * m_children[children + get_bits(key, position, bits)], none if
+		 * bits is 0. priority is the highest priority in the subtree.
+		 */
+		struct node {
+			std::uint32_t position;
+			std::uint32_t bits;
+			std::uint32_t children;
+			std::uint32_t rules;
+			std::uint32_t count;
+			std::uint32_t priority;
+		};
+
+		struct field {
+			std::uint32_t low;
+			std::uint32_t high;
+		};
+
+		static const std::uint32_t max_cut_bits = 8;
+		static const std::uint32_t none = ~0u;
+
+		std::uint32_t build_node(const std::vector<key_type> &data, const std::vector<key_type> &mask,
+				const std::vector<std::uint32_t> &priority, const std::vector<T> &object,
+				const std::vector<std::uint32_t> &ids, std::vector<std::uint32_t> &fixed,
+				std::uint32_t depth);
+
+		std::vector<field> m_fields;
+		std::vector<node> m_nodes;
+		std::vector<std::uint32_t> m_children;
+		std::vector<key_type> m_data;
+		std::vector<key_type> m_mask;
+		std::vector<std::uint32_t> m_priority;
+		std::vector<T> m_object;
+		std::uint32_t m_binth;
+		double m_spfac;
+		std::uint32_t m_depth;
+		std::uint32_t m_empty;
+
+	};
+
+}
+
+#include "soft_tcam_cuts.cc"
+
+#endif // SOFT_TCAM_CUTS_H
@@ -8,35 +8,31 @@
 
 #include <cstdint>
 #include <bitset>
+#include <utility>
 
-namespace soft_tcam {
+#include "soft_tcam_counter.h"
 
-	template <class T, size_t size> class soft_tcam_node;
+namespace soft_tcam {
 
-	template <class T, size_t size>
-	class soft_tcam_entry {
+	/*
+	 * soft_tcam_entry
+	 *
+	 * a rule in the tree. entries are allocated from the soft_tcam_arena
+	 * of their table and construct their object in place, so T needs
+	 * neither a default constructor nor a copy constructor.
+	 */
+	template <class T, size_t size, class counter = soft_tcam_counter_disabled>
+	class soft_tcam_entry : public counter {
 
 	public:
 
 		/*
 		 * ctor
+		 *
+		 * the object is constructed from args.
 		 */
-		soft_tcam_entry();
-
-		/*
-		 * dtor
-		 */
-		virtual ~soft_tcam_entry();
-
-		/*
-		 * new operator overload
-		 */
-		void *operator new(size_t s);
-
-		/*
-		 * delete operator overload
-		 */
-		void operator delete(void *p);
+		template<class... Args>
+		soft_tcam_entry(std::uint32_t priority, Args &&...args);
 
 		/*
 		 * priority setter
@@ -51,85 +47,57 @@ namespace soft_tcam {
 		/*
 		 * object setter
 		 */
-		void set_object(const T object);
+		void set_object(T &&object);
 
 		/*
 		 * object getter
 		 */
 		const T &get_object();
 
+		/*
+		 * object taker
+		 *
+		 * the object, to be moved out. it is left moved from.
+		 */
+		T &&take_object();
+
 		/*
 		 * next setter
 		 */
-		void set_next(soft_tcam_entry<T, size> *next);
+		void set_next(soft_tcam_entry<T, size, counter> *next);
 
 		/*
 		 * next getter
 		 */
-		soft_tcam_entry<T, size> *get_next();
+		soft_tcam_entry<T, size, counter> *get_next();
 
 		/*
 		 * prev setter
 		 */
-		void set_prev(soft_tcam_entry<T, size> *prev);
+		void set_prev(soft_tcam_entry<T, size, counter> *prev);
 
 		/*
 		 * prev getter
 		 */
-		soft_tcam_entry<T, size> *get_prev();
+		soft_tcam_entry<T, size, counter> *get_prev();
 
 		/*
 		 * node setter
 		 */
-		void set_node(soft_tcam_node<T, size> *node);
+		void set_node(std::uint32_t node);
 
 		/*
 		 * node getter
 		 */
-		soft_tcam_node<T, size> *get_node();
-
-		/*
-		 * set_list_next
-		 */
-		void set_list_next(soft_tcam_entry<T, size> *list_next);
-
-		/*
-		 * get_list_next
-		 */
-		soft_tcam_entry<T, size> *get_list_next();
-
-		/*
-		 * set_access_counter
-		 */
-		void set_access_counter(std::uint64_t access_counter);
-
-		/*
-		 * get_access_counter
-		 */
-		std::uint64_t get_access_counter();
-
-		/*
-		 * get_list_head
-		 */
-		static soft_tcam_entry<T, size> *get_list_head();
-
-		/*
-		 * get_alloc_counter
-		 */
-		static std::uint64_t get_alloc_counter();
+		std::uint32_t get_node();
 
 	private:
 
 		std::uint32_t m_priority;
 		T m_object;
-		soft_tcam_entry<T, size> *m_next;
-		soft_tcam_entry<T, size> *m_prev;
-		soft_tcam_node<T, size> *m_node;
-		soft_tcam_entry<T, size> *m_list_next;
-		std::uint64_t m_access_counter;
-
-		static soft_tcam_entry<T, size> *s_list_head;
-		static std::uint64_t s_alloc_counter;
+		soft_tcam_entry<T, size, counter> *m_next;
+		soft_tcam_entry<T, size, counter> *m_prev;
+		std::uint32_t m_node;
 
 	};
 
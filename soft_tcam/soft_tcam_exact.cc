@@ -0,0 +1,512 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <utility>
+
+#include "soft_tcam_exact.h"
+
+namespace soft_tcam {
+
+	template<class T, size_t size>
+	const std::uint8_t soft_tcam_exact<T, size>::ctrl_empty;
+
+	template<class T, size_t size>
+	const std::uint8_t soft_tcam_exact<T, size>::ctrl_deleted;
+
+	template<class T, size_t size>
+	const size_t soft_tcam_exact<T, size>::group_width;
+
+	template<class T, size_t size>
+	soft_tcam_exact<T, size>::soft_tcam_exact()
+	{
+		m_reserved = 0;
+		m_used = 0;
+		m_deleted = 0;
+		m_entries = 0;
+	}
+
+	template<class T, size_t size>
+	soft_tcam_exact<T, size>::soft_tcam_exact(const soft_tcam_exact &other)
+		: soft_tcam_exact()
+	{
+		*this = other;
+	}
+
+	template<class T, size_t size>
+	soft_tcam_exact<T, size> &
+	soft_tcam_exact<T, size>::operator=(const soft_tcam_exact &other)
+	{
+		rule **tail;
+
+		if (this == &other) {
+			return *this;
+		}
+
+		/*
+		 * the slots are copied as they are and every list is copied into
+		 * the arena of this table. the reservation stays with other.
+		 */
+		m_reserved = 0;
+		clear();
+		m_ctrl = other.m_ctrl;
+		m_slots = other.m_slots;
+		m_used = other.m_used;
+		m_deleted = other.m_deleted;
+		m_entries = other.m_entries;
+		m_rules.reserve(m_entries);
+		for (size_t i = 0; i < m_slots.size(); ++i) {
+			tail = &m_slots[i].rules;
+			for (const rule *r = other.m_slots[i].rules; r != nullptr; r = r->next) {
+				*tail = m_rules.alloc(rule{r->priority, r->object, nullptr});
+				tail = &(*tail)->next;
+			}
+		}
+
+		return *this;
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_exact<T, size>::insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+			const T &object)
+	{
+		return insert(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_exact<T, size>::insert(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object)
+	{
+		std::uint64_t hash;
+		size_t i, cap;
+		rule **link;
+
+		if (!soft_tcam_bits<size>::is_valid(data, mask)
+		 || (soft_tcam_bits<size>::prefix_length(mask) != size)) {
+			std::cerr << "insert: data/mask error." << std::endl;
+			return -1;
+		}
+
+		if (m_ctrl.empty()) {
+			rehash(1);
+		}
+
+		hash = soft_tcam_bits<size>::hash(data);
+		i = find_slot(data, hash);
+		if (i == m_slots.size()) {
+			/*
+			 * at most 7/8 of the slots are used or deleted, so every
+			 * probe sequence meets an empty slot. deleted slots are
+			 * dropped by a rehash of the same size when that is enough.
+			 */
+			cap = m_slots.size();
+			if ((m_used + m_deleted + 1) * 8 > cap * 7) {
+				rehash(((m_used + 1) * 16 > cap * 7) ? m_ctrl.size() * 2 : m_ctrl.size());
+			}
+			i = find_free(hash);
+			if (get_ctrl(i) == ctrl_deleted) {
+				--m_deleted;
+			}
+			set_ctrl(i, hash & 0x7f);
+			m_slots[i].data = data;
+			++m_used;
+		}
+
+		slot &s = m_slots[i];
+		link = &s.rules;
+		while ((*link != nullptr) && ((*link)->priority >= priority)) {
+			link = &(*link)->next;
+		}
+		*link = m_rules.alloc(rule{priority, object, *link});
+		s.priority = s.rules->priority;
+		s.object = s.rules->object;
+		++m_entries;
+
+		return 0;
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_exact<T, size>::erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+			const T &object)
+	{
+		return erase(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_exact<T, size>::erase(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object)
+	{
+		size_t i;
+		rule **link, *r;
+
+		if (m_ctrl.empty() || (soft_tcam_bits<size>::prefix_length(mask) != size)) {
+			std::cerr << "erase: entry not found." << std::endl;
+			return -1;
+		}
+
+		i = find_slot(data, soft_tcam_bits<size>::hash(data));
+		if (i == m_slots.size()) {
+			std::cerr << "erase: entry not found." << std::endl;
+			return -1;
+		}
+
+		slot &s = m_slots[i];
+		link = &s.rules;
+		while ((*link != nullptr) && (((*link)->priority != priority) || !((*link)->object == object))) {
+			link = &(*link)->next;
+		}
+		if (*link == nullptr) {
+			std::cerr << "erase: entry not found." << std::endl;
+			return -1;
+		}
+		r = *link;
+		*link = r->next;
+		m_rules.free(r);
+		--m_entries;
+
+		if (s.rules != nullptr) {
+			s.priority = s.rules->priority;
+			s.object = s.rules->object;
+			return 0;
+		}
+
+		/*
+		 * a group that still has an empty slot has never been full since
+		 * the last rehash, so no probe sequence went past it and the slot
+		 * can be empty again. otherwise it has to stay deleted.
+		 */
+		if (match_empty(m_ctrl[i / group_width]) != 0) {
+			set_ctrl(i, ctrl_empty);
+		} else {
+			set_ctrl(i, ctrl_deleted);
+			++m_deleted;
+		}
+		s = slot();
+		--m_used;
+
+		if (m_used == 0) {
+			clear();
+		} else if ((m_ctrl.size() > 1) && (m_ctrl.size() > m_reserved) && (m_used * 8 < m_slots.size())) {
+			rehash(m_ctrl.size() / 2);
+		}
+
+		return 0;
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_exact<T, size>::find(const std::bitset<size> &key) const
+	{
+		return find(soft_tcam_bits<size>::from_bitset(key));
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_exact<T, size>::find(const key_type &key) const
+	{
+		std::uint32_t priority;
+
+		return find(key, priority);
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_exact<T, size>::find(const key_type &key, std::uint32_t &priority) const
+	{
+		size_t i;
+
+		if (m_used == 0) {
+			return nullptr;
+		}
+
+		i = find_slot(key, soft_tcam_bits<size>::hash(key));
+		if (i == m_slots.size()) {
+			return nullptr;
+		}
+		priority = m_slots[i].priority;
+
+		return &m_slots[i].object;
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_exact<T, size>::find_rule(const key_type &data, std::uint32_t priority) const
+	{
+		size_t i;
+
+		if (m_used == 0) {
+			return nullptr;
+		}
+
+		i = find_slot(data, soft_tcam_bits<size>::hash(data));
+		if (i == m_slots.size()) {
+			return nullptr;
+		}
+		for (const rule *r = m_slots[i].rules; r != nullptr; r = r->next) {
+			if (r->priority == priority) {
+				return &r->object;
+			}
+		}
+
+		return nullptr;
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_exact<T, size>::get_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+			std::vector<std::uint32_t> &priority, std::vector<T> &object) const
+	{
+		for (size_t i = 0; i < m_slots.size(); ++i) {
+			if ((m_ctrl[i / group_width] >> (i % group_width * 8)) & 0x80) {
+				continue;
+			}
+			for (const rule *r = m_slots[i].rules; r != nullptr; r = r->next) {
+				data.push_back(m_slots[i].data);
+				mask.push_back(soft_tcam_bits<size>::prefix_mask(size));
+				priority.push_back(r->priority);
+				object.push_back(r->object);
+			}
+		}
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_exact<T, size>::reserve(size_t keys, size_t rules)
+	{
+		size_t groups = m_ctrl.empty() ? 1 : m_ctrl.size();
+
+		/*
+		 * the table doubles once more than 7/16 of its slots are used.
+		 */
+		while (groups * group_width * 7 < keys * 16) {
+			groups *= 2;
+		}
+		if (groups > m_ctrl.size()) {
+			rehash(groups);
+		}
+		m_reserved = groups;
+		m_rules.reserve(rules);
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_exact<T, size>::clear()
+	{
+		/*
+		 * a reserved table keeps its memory, only smaller than the
+		 * reservation again.
+		 */
+		if (m_reserved == 0) {
+			std::vector<std::uint64_t>().swap(m_ctrl);
+			std::vector<slot>().swap(m_slots);
+		} else {
+			m_ctrl.assign(m_reserved, 0x0101010101010101ULL * ctrl_empty);
+			m_slots.assign(m_reserved * group_width, slot());
+		}
+		m_rules.clear();
+		m_used = 0;
+		m_deleted = 0;
+		m_entries = 0;
+	}
+
+	template<class T, size_t size>
+	bool
+	soft_tcam_exact<T, size>::empty() const
+	{
+		return m_used == 0;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_exact<T, size>::get_key_count() const
+	{
+		return m_used;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_exact<T, size>::get_entry_count() const
+	{
+		return m_entries;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_exact<T, size>::get_memory_size() const
+	{
+		return m_ctrl.size() * sizeof(std::uint64_t) + m_slots.size() * sizeof(slot)
+			+ m_rules.get_capacity() * sizeof(rule);
+	}
+
+	template<class T, size_t size>
+	std::uint64_t
+	soft_tcam_exact<T, size>::match_byte(std::uint64_t ctrl, std::uint8_t byte)
+	{
+		std::uint64_t x = ctrl ^ (0x0101010101010101ULL * byte);
+
+		/*
+		 * top bit of every zero byte of x. a borrow can also mark the
+		 * byte above a zero byte, so a match still has to be compared.
+		 */
+		return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+	}
+
+	template<class T, size_t size>
+	std::uint64_t
+	soft_tcam_exact<T, size>::match_empty(std::uint64_t ctrl)
+	{
+		/*
+		 * empty and deleted both have the top bit, only deleted has bit 1.
+		 */
+		return ctrl & ~(ctrl << 6) & 0x8080808080808080ULL;
+	}
+
+	template<class T, size_t size>
+	std::uint64_t
+	soft_tcam_exact<T, size>::match_free(std::uint64_t ctrl)
+	{
+		return ctrl & 0x8080808080808080ULL;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_exact<T, size>::find_slot(const key_type &data, std::uint64_t hash) const
+	{
+		const std::uint64_t *ctrl = m_ctrl.data();
+		size_t mask = m_ctrl.size() - 1;
+		size_t group = (hash >> 7) & mask;
+		size_t i;
+
+		/*
+		 * triangular probing over the groups visits every group once
+		 * as their number is a power of two.
+		 */
+		for (size_t step = 1; ; ++step) {
+			for (std::uint64_t m = match_byte(ctrl[group], hash & 0x7f); m != 0; m &= m - 1) {
+				i = group * group_width + __builtin_ctzll(m) / 8;
+				if (m_slots[i].data == data) {
+					return i;
+				}
+			}
+			if (match_empty(ctrl[group]) != 0) {
+				return m_slots.size();
+			}
+			group = (group + step) & mask;
+		}
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_exact<T, size>::find_free(std::uint64_t hash) const
+	{
+		size_t mask = m_ctrl.size() - 1;
+		size_t group = (hash >> 7) & mask;
+		std::uint64_t m;
+
+		for (size_t step = 1; ; ++step) {
+			m = match_free(m_ctrl[group]);
+			if (m != 0) {
+				return group * group_width + __builtin_ctzll(m) / 8;
+			}
+			group = (group + step) & mask;
+		}
+	}
+
+	template<class T, size_t size>
+	std::uint8_t
+	soft_tcam_exact<T, size>::get_ctrl(size_t index) const
+	{
+		return m_ctrl[index / group_width] >> (index % group_width * 8) & 0xff;
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_exact<T, size>::set_ctrl(size_t index, std::uint8_t byte)
+	{
+		std::uint64_t &ctrl = m_ctrl[index / group_width];
+		size_t shift = index % group_width * 8;
+
+		ctrl = (ctrl & ~(std::uint64_t(0xff) << shift)) | (std::uint64_t(byte) << shift);
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_exact<T, size>::rehash(size_t groups)
+	{
+		std::vector<std::uint64_t> old_ctrl;
+		std::vector<slot> old_slots;
+		std::uint64_t hash;
+		size_t i;
+
+		if (groups == m_ctrl.size()) {
+			drop_deleted();
+			return;
+		}
+
+		old_ctrl.swap(m_ctrl);
+		old_slots.swap(m_slots);
+		m_ctrl.assign(groups, 0x0101010101010101ULL * ctrl_empty);
+		m_slots.resize(groups * group_width);
+		m_deleted = 0;
+
+		for (size_t j = 0; j < old_slots.size(); ++j) {
+			if ((old_ctrl[j / group_width] >> (j % group_width * 8)) & 0x80) {
+				continue;
+			}
+			hash = soft_tcam_bits<size>::hash(old_slots[j].data);
+			i = find_free(hash);
+			set_ctrl(i, hash & 0x7f);
+			m_slots[i] = std::move(old_slots[j]);
+		}
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_exact<T, size>::drop_deleted()
+	{
+		std::uint64_t hash;
+		size_t i, j;
+
+		/*
+		 * rehash in place, so that a table that only churns never
+		 * allocates. every used slot is marked deleted and every deleted
+		 * one empty, then each marked slot is put where find_free() would
+		 * put it now: left alone if that is in its own group, moved if it
+		 * is empty, and swapped with it if it is another marked slot,
+		 * which is then looked at in turn.
+		 */
+		for (i = 0; i < m_slots.size(); ++i) {
+			set_ctrl(i, (get_ctrl(i) & 0x80) ? ctrl_empty : ctrl_deleted);
+		}
+		for (i = 0; i < m_slots.size(); ++i) {
+			if (get_ctrl(i) != ctrl_deleted) {
+				continue;
+			}
+			hash = soft_tcam_bits<size>::hash(m_slots[i].data);
+			j = find_free(hash);
+			if (j / group_width == i / group_width) {
+				set_ctrl(i, hash & 0x7f);
+			} else if (get_ctrl(j) == ctrl_empty) {
+				set_ctrl(j, hash & 0x7f);
+				m_slots[j] = std::move(m_slots[i]);
+				m_slots[i] = slot();
+				set_ctrl(i, ctrl_empty);
+			} else {
+				set_ctrl(j, hash & 0x7f);
+				std::swap(m_slots[i], m_slots[j]);
+				--i;
+			}
+		}
+		m_deleted = 0;
+	}
+
+}
@@ -0,0 +1,175 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_EXACT_H
+#define SOFT_TCAM_EXACT_H
+
+#include <cstdint>
+#include <bitset>
+#include <vector>
+
+#include "soft_tcam_bits.h"
+#include "soft_tcam_arena.h"
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_exact
+	 *
+	 * exact match with the same interface as soft_tcam, for rules whose
+	 * mask has every bit set. the rules are kept in a swiss table: slots
+	 * come in groups of 8 with one control byte each, 7 bits of the hash
+	 * for a used slot, and the 8 bytes of a group are compared at once as
+	 * one 64 bit word. find is one hash and, at the load factor kept here,
+	 * almost always one group. the rules of a slot are a list in an arena,
+	 * so after reserve() neither the slots nor the rules allocate.
+	 */
+	template<class T, size_t size>
+	class soft_tcam_exact {
+
+	public:
+
+		typedef typename soft_tcam_bits<size>::key_type key_type;
+
+		/*
+		 * ctor
+		 */
+		soft_tcam_exact();
+
+		/*
+		 * copy
+		 */
+		soft_tcam_exact(const soft_tcam_exact &other);
+		soft_tcam_exact &operator=(const soft_tcam_exact &other);
+
+		/*
+		 * insert
+		 */
+		int insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+				const T &object);
+		int insert(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * erase
+		 */
+		int erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+				const T &object);
+		int erase(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * find
+		 *
+		 * with priority, also returns the priority of the rule found.
+		 */
+		const T *find(const std::bitset<size> &key) const;
+		const T *find(const key_type &key) const;
+		const T *find(const key_type &key, std::uint32_t &priority) const;
+
+		/*
+		 * find rule
+		 *
+		 * the object of the first rule with data and priority, nullptr if
+		 * there is none.
+		 */
+		const T *find_rule(const key_type &data, std::uint32_t priority) const;
+
+		/*
+		 * get entries
+		 *
+		 * appends every entry, as passed to insert().
+		 */
+		void get_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+				std::vector<std::uint32_t> &priority, std::vector<T> &object) const;
+
+		/*
+		 * reserve
+		 *
+		 * makes room for keys keys and rules rules, so that inserting them
+		 * does not allocate memory. the table does not shrink below this
+		 * until clear().
+		 */
+		void reserve(size_t keys, size_t rules);
+
+		/*
+		 * clear
+		 */
+		void clear();
+
+		/*
+		 * empty
+		 */
+		bool empty() const;
+
+		/*
+		 * get_key_count
+		 */
+		size_t get_key_count() const;
+
+		/*
+		 * get_entry_count
+		 */
+		size_t get_entry_count() const;
+
+		/*
+		 * get_memory_size
+		 */
+		size_t get_memory_size() const;
+
+	private:
+
+		struct rule {
+			std::uint32_t priority;
+			T object;
+			rule *next;
+		};
+
+		/*
+		 * rules is the list of the rules with this data, best first.
+		 * priority and object are those of its head, so find does not
+		 * look at rules.
+		 */
+		struct slot {
+			key_type data;
+			std::uint32_t priority;
+			T object;
+			rule *rules;
+		};
+
+		/*
+		 * control bytes. a used slot has the low 7 bits of its hash,
+		 * so the top bit tells free slots from used ones.
+		 */
+		static const std::uint8_t ctrl_empty = 0x80;
+		static const std::uint8_t ctrl_deleted = 0xfe;
+		static const size_t group_width = 8;
+
+		static std::uint64_t match_byte(std::uint64_t ctrl, std::uint8_t byte);
+		static std::uint64_t match_empty(std::uint64_t ctrl);
+		static std::uint64_t match_free(std::uint64_t ctrl);
+
+		size_t find_slot(const key_type &data, std::uint64_t hash) const;
+		size_t find_free(std::uint64_t hash) const;
+		std::uint8_t get_ctrl(size_t index) const;
+		void set_ctrl(size_t index, std::uint8_t byte);
+		void rehash(size_t groups);
+		void drop_deleted();
+
+		std::vector<std::uint64_t> m_ctrl;
+		std::vector<slot> m_slots;
+		soft_tcam_arena<rule> m_rules;
+		size_t m_reserved;
+		size_t m_used;
+		size_t m_deleted;
+		size_t m_entries;
+
+	};
+
+}
+
+#include "soft_tcam_exact.cc"
+
+#endif // SOFT_TCAM_EXACT_H
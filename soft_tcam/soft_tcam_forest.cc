@@ -0,0 +1,408 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <utility>
+
+#include "soft_tcam_forest.h"
+
+namespace soft_tcam {
+
+	template<class T, size_t size, class counter>
+	const std::uint32_t soft_tcam_forest<T, size, counter>::class_wildcard;
+
+	template<class T, size_t size, class counter>
+	const std::uint32_t soft_tcam_forest<T, size, counter>::class_prefix;
+
+	template<class T, size_t size, class counter>
+	const std::uint32_t soft_tcam_forest<T, size, counter>::class_exact;
+
+	template<class T, size_t size, class counter>
+	const std::uint32_t soft_tcam_forest<T, size, counter>::class_other;
+
+	template<class T, size_t size, class counter>
+	const std::uint32_t soft_tcam_forest<T, size, counter>::max_fields;
+
+	template<class T, size_t size, class counter>
+	soft_tcam_forest<T, size, counter>::soft_tcam_forest(const std::vector<std::uint32_t> &widths,
+			std::uint32_t max_partitions)
+	{
+		std::uint32_t msb = size;
+
+		for (auto it = widths.begin(); (it != widths.end()) && (msb > 0); ++it) {
+			std::uint32_t width = std::min(*it, msb);
+			if (width == 0) {
+				continue;
+			}
+			if (m_fields.size() == max_fields - 1) {
+				break;
+			}
+			m_fields.push_back(field{msb - width, msb});
+			msb -= width;
+		}
+		if (msb > 0) {
+			m_fields.push_back(field{0, msb});
+		}
+
+		m_max_partitions = std::max<std::uint32_t>(max_partitions, 1);
+		m_entries = 0;
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam_forest<T, size, counter>::insert(const std::bitset<size> &data, const std::bitset<size> &mask,
+			std::uint32_t priority, const T &object)
+	{
+		return insert(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam_forest<T, size, counter>::insert(const key_type &data, const key_type &mask,
+			std::uint32_t priority, const T &object)
+	{
+		std::uint64_t signature;
+		size_t i;
+
+		if (!soft_tcam_bits<size>::is_valid(data, mask)) {
+			std::cerr << "insert: data/mask error." << std::endl;
+			return -1;
+		}
+
+		signature = get_signature(mask);
+		auto it = m_signatures.find(signature);
+		if (it != m_signatures.end()) {
+			i = find_partition(it->second);
+		} else {
+			i = add_signature(signature);
+		}
+
+		partition &p = m_partitions[i];
+		if (p.tcam->insert(data, mask, priority, object) != 0) {
+			if (p.entries == 0) {
+				m_signatures.erase(signature);
+				m_partitions.erase(m_partitions.begin() + i);
+			}
+			return -1;
+		}
+		++p.priorities[priority];
+		p.max_priority = p.priorities.rbegin()->first;
+		++p.entries;
+		++m_entries;
+		sort_partitions();
+
+		return 0;
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam_forest<T, size, counter>::erase(const std::bitset<size> &data, const std::bitset<size> &mask,
+			std::uint32_t priority, const T &object)
+	{
+		return erase(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam_forest<T, size, counter>::erase(const key_type &data, const key_type &mask,
+			std::uint32_t priority, const T &object)
+	{
+		size_t i;
+
+		auto it = m_signatures.find(get_signature(mask));
+		if (it == m_signatures.end()) {
+			std::cerr << "erase: entry not found." << std::endl;
+			return -1;
+		}
+
+		i = find_partition(it->second);
+		partition &p = m_partitions[i];
+		if (p.tcam->erase(data, mask, priority, object) != 0) {
+			return -1;
+		}
+		--p.entries;
+		--m_entries;
+
+		/*
+		 * an empty partition goes away with its signatures.
+		 */
+		if (p.entries == 0) {
+			for (auto s = m_signatures.begin(); s != m_signatures.end(); ) {
+				if (s->second == p.tcam.get()) {
+					s = m_signatures.erase(s);
+				} else {
+					++s;
+				}
+			}
+			m_partitions.erase(m_partitions.begin() + i);
+			return 0;
+		}
+
+		auto c = p.priorities.find(priority);
+		if (--c->second == 0) {
+			p.priorities.erase(c);
+			if (priority > p.priorities.rbegin()->first) {
+				p.max_priority = p.priorities.rbegin()->first;
+				sort_partitions();
+			}
+		}
+
+		return 0;
+	}
+
+	template<class T, size_t size, class counter>
+	const T *
+	soft_tcam_forest<T, size, counter>::find(const std::bitset<size> &key)
+	{
+		return find(soft_tcam_bits<size>::from_bitset(key));
+	}
+
+	template<class T, size_t size, class counter>
+	const T *
+	soft_tcam_forest<T, size, counter>::find(const key_type &key)
+	{
+		std::uint32_t priority;
+
+		return find(key, priority);
+	}
+
+	template<class T, size_t size, class counter>
+	const T *
+	soft_tcam_forest<T, size, counter>::find(const key_type &key, std::uint32_t &priority)
+	{
+		const T *best = nullptr, *p;
+		std::uint32_t best_priority = 0, q;
+
+		for (auto it = m_partitions.begin(); it != m_partitions.end(); ++it) {
+			if ((best != nullptr) && (it->max_priority <= best_priority)) {
+				break;
+			}
+			p = it->tcam->find(key, q);
+			if ((p != nullptr) && ((best == nullptr) || (q > best_priority))) {
+				best = p;
+				best_priority = q;
+			}
+		}
+		if (best != nullptr) {
+			priority = best_priority;
+		}
+
+		return best;
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam_forest<T, size, counter>::get_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+			std::vector<std::uint32_t> &priority, std::vector<T> &object)
+	{
+		for (auto it = m_partitions.begin(); it != m_partitions.end(); ++it) {
+			it->tcam->get_entries(data, mask, priority, object);
+		}
+	}
+
+	template<class T, size_t size, class counter>
+	size_t
+	soft_tcam_forest<T, size, counter>::get_partition_count() const
+	{
+		return m_partitions.size();
+	}
+
+	template<class T, size_t size, class counter>
+	size_t
+	soft_tcam_forest<T, size, counter>::get_entry_count() const
+	{
+		return m_entries;
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam_forest<T, size, counter>::dump() const
+	{
+		static const char names[] = "wpeo";
+
+		/*
+		 * one column per field, the classes of the rules in it.
+		 */
+		for (auto it = m_partitions.begin(); it != m_partitions.end(); ++it) {
+			for (std::uint32_t f = 0; f < m_fields.size(); ++f) {
+				std::cout << ((f == 0) ? "" : " ");
+				for (std::uint32_t c = 0; c < 4; ++c) {
+					if ((it->classes >> (f * 4 + c)) & 1) {
+						std::cout << names[c];
+					}
+				}
+			}
+			std::cout << " : rules = " << it->entries
+				  << ", max priority = " << it->max_priority << std::endl;
+		}
+	}
+
+	template<class T, size_t size, class counter>
+	std::uint64_t
+	soft_tcam_forest<T, size, counter>::get_signature(const key_type &mask) const
+	{
+		std::uint64_t signature = 0;
+		std::uint32_t c, b;
+
+		for (std::uint32_t f = 0; f < m_fields.size(); ++f) {
+			const field &fl = m_fields[f];
+			b = fl.high;
+			while ((b > fl.low) && soft_tcam_bits<size>::test(mask, b - 1)) {
+				--b;
+			}
+			if (b == fl.low) {
+				c = class_exact;
+			} else if (!soft_tcam_bits<size>::is_match(mask, key_type(), mask, fl.low, b)) {
+				c = class_other;
+			} else if (b == fl.high) {
+				c = class_wildcard;
+			} else {
+				c = class_prefix;
+			}
+			signature |= std::uint64_t(1) << (f * 4 + c);
+		}
+
+		return signature;
+	}
+
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam_forest<T, size, counter>::get_spread(std::uint64_t classes) const
+	{
+		std::uint32_t spread = 0, bits;
+
+		/*
+		 * fields where the rules do not all have the same class.
+		 */
+		for (std::uint32_t f = 0; f < m_fields.size(); ++f) {
+			bits = (classes >> (f * 4)) & 0xf;
+			if ((bits & (bits - 1)) != 0) {
+				++spread;
+			}
+		}
+
+		return spread;
+	}
+
+	template<class T, size_t size, class counter>
+	size_t
+	soft_tcam_forest<T, size, counter>::find_partition(const soft_tcam<T, size, counter> *tcam) const
+	{
+		size_t i = 0;
+
+		while (m_partitions[i].tcam.get() != tcam) {
+			++i;
+		}
+
+		return i;
+	}
+
+	template<class T, size_t size, class counter>
+	size_t
+	soft_tcam_forest<T, size, counter>::add_signature(std::uint64_t signature)
+	{
+		std::uint32_t join = 0, join_spread = ~0u, pair_spread = ~0u, spread;
+		size_t into = 0, from = 0;
+
+		if (m_partitions.size() >= m_max_partitions) {
+			/*
+			 * the partition the signature would mix least with, and the
+			 * two partitions that would mix least with each other. ties
+			 * go to the smaller partitions, which are cheaper to merge.
+			 */
+			for (size_t i = 0; i < m_partitions.size(); ++i) {
+				spread = get_spread(m_partitions[i].classes | signature);
+				if ((spread < join_spread)
+				 || ((spread == join_spread) && (m_partitions[i].entries < m_partitions[join].entries))) {
+					join = i;
+					join_spread = spread;
+				}
+				for (size_t j = i + 1; j < m_partitions.size(); ++j) {
+					spread = get_spread(m_partitions[i].classes | m_partitions[j].classes);
+					if ((spread < pair_spread)
+					 || ((spread == pair_spread)
+					  && (m_partitions[i].entries + m_partitions[j].entries
+						  < m_partitions[into].entries + m_partitions[from].entries))) {
+						into = i;
+						from = j;
+						pair_spread = spread;
+					}
+				}
+			}
+			if (m_partitions[into].entries < m_partitions[from].entries) {
+				std::swap(into, from);
+			}
+			/*
+			 * a merge that does not fit, e.g. runs out of masks, leaves
+			 * both partitions alone and the signature joins one of them.
+			 */
+			if ((join_spread <= pair_spread) || (merge(into, from) != 0)) {
+				m_partitions[join].classes |= signature;
+				m_signatures[signature] = m_partitions[join].tcam.get();
+				return join;
+			}
+		}
+
+		partition p;
+		p.max_priority = 0;
+		p.classes = signature;
+		p.entries = 0;
+		p.tcam.reset(new soft_tcam<T, size, counter>());
+		m_signatures[signature] = p.tcam.get();
+		m_partitions.push_back(std::move(p));
+
+		return m_partitions.size() - 1;
+	}
+
+	template<class T, size_t size, class counter>
+	int
+	soft_tcam_forest<T, size, counter>::merge(size_t into, size_t from)
+	{
+		std::vector<key_type> data, mask;
+		std::vector<std::uint32_t> priority;
+		std::vector<T> object;
+		partition &p = m_partitions[into];
+		partition &q = m_partitions[from];
+
+		q.tcam->get_entries(data, mask, priority, object);
+		for (size_t i = 0; i < data.size(); ++i) {
+			if (p.tcam->insert(data[i], mask[i], priority[i], object[i]) != 0) {
+				while (i-- > 0) {
+					p.tcam->erase(data[i], mask[i], priority[i], object[i]);
+				}
+				return -1;
+			}
+		}
+		for (auto it = m_signatures.begin(); it != m_signatures.end(); ++it) {
+			if (it->second == q.tcam.get()) {
+				it->second = p.tcam.get();
+			}
+		}
+		p.classes |= q.classes;
+		for (auto it = q.priorities.begin(); it != q.priorities.end(); ++it) {
+			p.priorities[it->first] += it->second;
+		}
+		p.max_priority = p.priorities.rbegin()->first;
+		p.entries += q.entries;
+		m_partitions.erase(m_partitions.begin() + from);
+		sort_partitions();
+
+		return 0;
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam_forest<T, size, counter>::sort_partitions()
+	{
+		std::stable_sort(m_partitions.begin(), m_partitions.end(),
+				[](const partition &l, const partition &r) {
+					return l.max_priority > r.max_priority;
+				});
+	}
+
+}
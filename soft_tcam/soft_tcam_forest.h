@@ -0,0 +1,153 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_FOREST_H
+#define SOFT_TCAM_FOREST_H
+
+#include <cstdint>
+#include <bitset>
+#include <vector>
+#include <map>
+#include <memory>
+
+#include "soft_tcam_bits.h"
+#include "soft_tcam.h"
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_forest
+	 *
+	 * several soft_tcams with the same interface as one. the key is split
+	 * into fields, and each field of a mask is wildcard, prefix, exact or
+	 * other. the rules are partitioned by these classes (the signature of
+	 * the rule), so that rules that leave a field open and rules that
+	 * specify it are in different tries and a walk does not backtrack
+	 * between them. a partition that only has prefix rules can also use
+	 * the soft_tcam_lpm of its soft_tcam.
+	 *
+	 * find looks in the partitions, the one with the highest priority
+	 * first, and stops when no partition left can beat the best match.
+	 * a new signature gets a partition of its own while there are less
+	 * than max_partitions. after that, it joins the partition that mixes
+	 * the fewest fields with it, unless two partitions are closer to each
+	 * other, in which case those two are merged. a merge whose rules do
+	 * not all fit in one soft_tcam is undone and the signature joins.
+	 */
+	template<class T, size_t size, class counter = soft_tcam_counter_disabled>
+	class soft_tcam_forest {
+
+	public:
+
+		typedef typename soft_tcam_bits<size>::key_type key_type;
+
+		/*
+		 * ctor
+		 *
+		 * widths are the field widths from the most significant bit, as in
+		 * soft_tcam_cuts. the bits below the last field form one more
+		 * field, and there are at most 16 fields. empty means one field
+		 * for the whole key.
+		 */
+		soft_tcam_forest(const std::vector<std::uint32_t> &widths = std::vector<std::uint32_t>(),
+				std::uint32_t max_partitions = 8);
+
+		/*
+		 * insert
+		 */
+		int insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+				const T &object);
+		int insert(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * erase
+		 */
+		int erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+				const T &object);
+		int erase(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * find
+		 *
+		 * with priority, also returns the priority of the rule found.
+		 */
+		const T *find(const std::bitset<size> &key);
+		const T *find(const key_type &key);
+		const T *find(const key_type &key, std::uint32_t &priority);
+
+		/*
+		 * get entries
+		 *
+		 * appends every entry, as passed to insert().
+		 */
+		void get_entries(std::vector<key_type> &data, std::vector<key_type> &mask,
+				std::vector<std::uint32_t> &priority, std::vector<T> &object);
+
+		/*
+		 * get_partition_count
+		 */
+		size_t get_partition_count() const;
+
+		/*
+		 * get_entry_count
+		 */
+		size_t get_entry_count() const;
+
+		/*
+		 * dump
+		 *
+		 * signature, rules and max priority of each partition.
+		 */
+		void dump() const;
+
+	private:
+
+		/*
+		 * classes has 4 bits per field, one for each class that a rule in
+		 * the partition has in that field. priorities counts the rules of
+		 * each priority, so that max_priority, the best of them, goes down
+		 * when the last rule with it is erased.
+		 */
+		struct partition {
+			std::uint32_t max_priority;
+			std::uint64_t classes;
+			size_t entries;
+			std::map<std::uint32_t, size_t> priorities;
+			std::unique_ptr<soft_tcam<T, size, counter>> tcam;
+		};
+
+		struct field {
+			std::uint32_t low;
+			std::uint32_t high;
+		};
+
+		static const std::uint32_t class_wildcard = 0;
+		static const std::uint32_t class_prefix = 1;
+		static const std::uint32_t class_exact = 2;
+		static const std::uint32_t class_other = 3;
+		static const std::uint32_t max_fields = 16;
+
+		std::uint64_t get_signature(const key_type &mask) const;
+		std::uint32_t get_spread(std::uint64_t classes) const;
+		size_t find_partition(const soft_tcam<T, size, counter> *tcam) const;
+		size_t add_signature(std::uint64_t signature);
+		int merge(size_t into, size_t from);
+		void sort_partitions();
+
+		std::vector<field> m_fields;
+		std::vector<partition> m_partitions;
+		std::map<std::uint64_t, soft_tcam<T, size, counter> *> m_signatures;
+		std::uint32_t m_max_partitions;
+		size_t m_entries;
+
+	};
+
+}
+
+#include "soft_tcam_forest.cc"
+
+#endif // SOFT_TCAM_FOREST_H
@@ -0,0 +1,466 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <iostream>
+#include <algorithm>
+
+#include "soft_tcam_lpm.h"
+
+namespace soft_tcam {
+
+	template<class T, size_t size>
+	const std::uint32_t soft_tcam_lpm<T, size>::group_flag;
+
+	template<class T, size_t size>
+	const std::uint32_t soft_tcam_lpm<T, size>::max_first_bits;
+
+	template<class T, size_t size>
+	const std::uint32_t soft_tcam_lpm<T, size>::max_group_bits;
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_lpm<T, size>::prefix_hash::operator()(const prefix &p) const
+	{
+		return soft_tcam_bits<size>::hash(p.first) ^ p.second;
+	}
+
+	template<class T, size_t size>
+	soft_tcam_lpm<T, size>::soft_tcam_lpm(std::uint32_t first_bits, std::uint32_t group_bits)
+	{
+		std::uint32_t shift;
+
+		first_bits = std::min(std::max<std::uint32_t>(first_bits, 1), std::min<std::uint32_t>(max_first_bits, size));
+		group_bits = std::min(std::max<std::uint32_t>(group_bits, 1), max_group_bits);
+		m_group_size = std::uint32_t(1) << group_bits;
+
+		/*
+		 * level 0 takes the top first_bits, every level below the next
+		 * group_bits or what is left.
+		 */
+		shift = size - first_bits;
+		m_shift.push_back(shift);
+		m_bits.push_back(first_bits);
+		while (shift > 0) {
+			m_bits.push_back(std::min(group_bits, shift));
+			shift -= m_bits.back();
+			m_shift.push_back(shift);
+		}
+
+		clear();
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_lpm<T, size>::insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+			const T &object)
+	{
+		return insert(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_lpm<T, size>::insert(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object)
+	{
+		std::uint32_t length, id;
+
+		if (!soft_tcam_bits<size>::is_valid(data, mask)) {
+			std::cerr << "insert: data/mask error." << std::endl;
+			return -1;
+		}
+		length = soft_tcam_bits<size>::prefix_length(mask);
+		if (length > size) {
+			std::cerr << "insert: mask is not a prefix." << std::endl;
+			return -1;
+		}
+
+		/*
+		 * route 0 means none. it is only made here, so that an empty
+		 * table does not construct a T.
+		 */
+		if (m_table.empty()) {
+			m_table.assign(std::uint32_t(1) << m_bits[0], 0);
+			m_routes.push_back(route());
+		}
+
+		auto found = m_index.find(prefix(data, length));
+		if (found == m_index.end()) {
+			if (m_free_routes.empty()) {
+				id = m_routes.size();
+				m_routes.push_back(route());
+			} else {
+				id = m_free_routes.back();
+				m_free_routes.pop_back();
+			}
+			m_routes[id].data = data;
+			m_routes[id].length = length;
+			m_index[prefix(data, length)] = id;
+		} else {
+			id = found->second;
+		}
+
+		route &r = m_routes[id];
+		auto it = std::upper_bound(r.rules.begin(), r.rules.end(), priority,
+				[](std::uint32_t p, const rule &x) { return p > x.priority; });
+		r.rules.insert(it, rule{priority, object});
+		r.priority = r.rules.front().priority;
+		r.object = r.rules.front().object;
+
+		if (found == m_index.end()) {
+			insert_route(id);
+		}
+		++m_lengths[length][priority];
+		++m_entries;
+
+		return 0;
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_lpm<T, size>::erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+			const T &object)
+	{
+		return erase(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_lpm<T, size>::erase(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object)
+	{
+		std::uint32_t length, id, cover = 0;
+		key_type temp;
+
+		length = soft_tcam_bits<size>::prefix_length(mask);
+
+		auto found = m_index.find(prefix(data, length));
+		if ((length > size) || (found == m_index.end())) {
+			std::cerr << "erase: entry not found." << std::endl;
+			return -1;
+		}
+		id = found->second;
+
+		route &r = m_routes[id];
+		auto it = r.rules.begin();
+		while ((it != r.rules.end()) && ((it->priority != priority) || !(it->object == object))) {
+			++it;
+		}
+		if (it == r.rules.end()) {
+			std::cerr << "erase: entry not found." << std::endl;
+			return -1;
+		}
+		r.rules.erase(it);
+		if (--m_lengths[length][priority] == 0) {
+			m_lengths[length].erase(priority);
+		}
+		--m_entries;
+
+		if (!r.rules.empty()) {
+			r.priority = r.rules.front().priority;
+			r.object = r.rules.front().object;
+			return 0;
+		}
+
+		/*
+		 * the entries of the route fall back to the longest route that
+		 * covers it.
+		 */
+		for (std::uint32_t l = length; l-- > 0; ) {
+			temp = data;
+			soft_tcam_bits<size>::intersect(temp, soft_tcam_bits<size>::prefix_mask(l));
+			auto c = m_index.find(prefix(temp, l));
+			if (c != m_index.end()) {
+				cover = c->second;
+				break;
+			}
+		}
+		erase_route(id, cover);
+		m_index.erase(found);
+		m_routes[id] = route();
+		m_free_routes.push_back(id);
+
+		if (m_entries == 0) {
+			clear();
+		}
+
+		return 0;
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_lpm<T, size>::find(const std::bitset<size> &key) const
+	{
+		return find(soft_tcam_bits<size>::from_bitset(key));
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_lpm<T, size>::find(const key_type &key) const
+	{
+		std::uint32_t e = find_route(key);
+
+		return (e != 0) ? &m_routes[e].object : nullptr;
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_lpm<T, size>::find(const key_type &key, std::uint32_t &priority) const
+	{
+		std::uint32_t e = find_route(key);
+
+		if (e == 0) {
+			return nullptr;
+		}
+		priority = m_routes[e].priority;
+
+		return &m_routes[e].object;
+	}
+
+	template<class T, size_t size>
+	std::uint32_t
+	soft_tcam_lpm<T, size>::find_route(const key_type &key) const
+	{
+		std::uint32_t e;
+
+		if (m_table.empty()) {
+			return 0;
+		}
+
+		e = m_table[get_index(key, m_shift[0], m_bits[0])];
+		for (std::uint32_t level = 1; (e & group_flag) != 0; ++level) {
+			e = m_groups[(e & ~group_flag) * m_group_size
+				+ soft_tcam_bits<size>::get_bits(key, m_shift[level], m_bits[level])];
+		}
+
+		return e;
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_lpm<T, size>::clear()
+	{
+		std::vector<std::uint32_t>().swap(m_table);
+		std::vector<std::uint32_t>().swap(m_groups);
+		m_free_groups.clear();
+		m_routes.clear();
+		m_free_routes.clear();
+		m_index.clear();
+		m_lengths.assign(size + 1, std::map<std::uint32_t, std::uint32_t>());
+		m_entries = 0;
+	}
+
+	template<class T, size_t size>
+	bool
+	soft_tcam_lpm<T, size>::is_ordered() const
+	{
+		bool first = true;
+		std::uint32_t highest = 0;
+
+		for (auto it = m_lengths.begin(); it != m_lengths.end(); ++it) {
+			if (it->empty()) {
+				continue;
+			}
+			if (!first && (it->begin()->first <= highest)) {
+				return false;
+			}
+			first = false;
+			highest = it->rbegin()->first;
+		}
+
+		return true;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_lpm<T, size>::get_route_count() const
+	{
+		return m_index.size();
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_lpm<T, size>::get_entry_count() const
+	{
+		return m_entries;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_lpm<T, size>::get_group_count() const
+	{
+		return m_groups.size() / m_group_size - m_free_groups.size();
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_lpm<T, size>::get_memory_size() const
+	{
+		size_t bytes = (m_table.size() + m_groups.size()) * sizeof(std::uint32_t)
+			+ m_routes.size() * sizeof(route)
+			+ m_index.bucket_count() * sizeof(void *)
+			+ m_index.size() * (sizeof(std::pair<const prefix, std::uint32_t>) + sizeof(void *));
+
+		for (auto it = m_routes.begin(); it != m_routes.end(); ++it) {
+			bytes += it->rules.capacity() * sizeof(rule);
+		}
+
+		return bytes;
+	}
+
+	template<class T, size_t size>
+	std::uint32_t
+	soft_tcam_lpm<T, size>::get_index(const key_type &key, std::uint32_t position, std::uint32_t count)
+	{
+		if (count <= 16) {
+			return soft_tcam_bits<size>::get_bits(key, position, count);
+		}
+
+		return (soft_tcam_bits<size>::get_bits(key, position + 16, count - 16) << 16)
+			| soft_tcam_bits<size>::get_bits(key, position, 16);
+	}
+
+	template<class T, size_t size>
+	std::uint32_t &
+	soft_tcam_lpm<T, size>::get_slot(std::uint32_t level, std::uint32_t index)
+	{
+		return (level == 0) ? m_table[index] : m_groups[index];
+	}
+
+	template<class T, size_t size>
+	std::uint32_t
+	soft_tcam_lpm<T, size>::new_group(std::uint32_t fill)
+	{
+		std::uint32_t group;
+
+		if (m_free_groups.empty()) {
+			group = m_groups.size() / m_group_size;
+			m_groups.resize(m_groups.size() + m_group_size);
+		} else {
+			group = m_free_groups.back();
+			m_free_groups.pop_back();
+		}
+		std::fill(&m_groups[group * m_group_size], &m_groups[group * m_group_size] + m_group_size, fill);
+
+		return group;
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_lpm<T, size>::collapse_group(std::uint32_t level, std::uint32_t index)
+	{
+		std::uint32_t e = get_slot(level, index), group, first, count;
+
+		/*
+		 * a group whose entries are all the same route is put back into
+		 * its parent entry.
+		 */
+		if ((e & group_flag) == 0) {
+			return;
+		}
+		group = e & ~group_flag;
+		first = m_groups[group * m_group_size];
+		count = std::uint32_t(1) << m_bits[level + 1];
+		if ((first & group_flag) != 0) {
+			return;
+		}
+		for (std::uint32_t i = 1; i < count; ++i) {
+			if (m_groups[group * m_group_size + i] != first) {
+				return;
+			}
+		}
+		get_slot(level, index) = first;
+		m_free_groups.push_back(group);
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_lpm<T, size>::insert_range(std::uint32_t level, std::uint32_t index, std::uint32_t count,
+			std::uint32_t length, std::uint32_t id)
+	{
+		std::uint32_t e;
+
+		for (std::uint32_t i = index; i < index + count; ++i) {
+			e = get_slot(level, i);
+			if ((e & group_flag) != 0) {
+				insert_range(level + 1, (e & ~group_flag) * m_group_size,
+						std::uint32_t(1) << m_bits[level + 1], length, id);
+			} else if ((e == 0) || (m_routes[e].length < length)) {
+				get_slot(level, i) = id;
+			}
+		}
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_lpm<T, size>::erase_range(std::uint32_t level, std::uint32_t index, std::uint32_t count,
+			std::uint32_t id, std::uint32_t cover)
+	{
+		std::uint32_t e;
+
+		for (std::uint32_t i = index; i < index + count; ++i) {
+			e = get_slot(level, i);
+			if ((e & group_flag) != 0) {
+				erase_range(level + 1, (e & ~group_flag) * m_group_size,
+						std::uint32_t(1) << m_bits[level + 1], id, cover);
+				collapse_group(level, i);
+			} else if (e == id) {
+				get_slot(level, i) = cover;
+			}
+		}
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_lpm<T, size>::insert_route(std::uint32_t id)
+	{
+		std::uint32_t length = m_routes[id].length;
+		std::uint32_t level = 0, base = 0, i, e;
+
+		/*
+		 * walk down, adding groups, to the level where the prefix ends
+		 * and fill its range there.
+		 */
+		for (;;) {
+			i = base + get_index(m_routes[id].data, m_shift[level], m_bits[level]);
+			if (length <= size - m_shift[level]) {
+				insert_range(level, i, std::uint32_t(1) << (size - m_shift[level] - length), length, id);
+				return;
+			}
+			e = get_slot(level, i);
+			if ((e & group_flag) == 0) {
+				e = new_group(e) | group_flag;
+				get_slot(level, i) = e;
+			}
+			base = (e & ~group_flag) * m_group_size;
+			++level;
+		}
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_lpm<T, size>::erase_route(std::uint32_t id, std::uint32_t cover)
+	{
+		std::uint32_t length = m_routes[id].length;
+		std::uint32_t level = 0, base = 0, i;
+		std::vector<std::uint32_t> path;
+
+		for (;;) {
+			i = base + get_index(m_routes[id].data, m_shift[level], m_bits[level]);
+			if (length <= size - m_shift[level]) {
+				erase_range(level, i, std::uint32_t(1) << (size - m_shift[level] - length), id, cover);
+				break;
+			}
+			path.push_back(i);
+			base = (get_slot(level, i) & ~group_flag) * m_group_size;
+			++level;
+		}
+		while (level-- > 0) {
+			collapse_group(level, path[level]);
+		}
+	}
+
+}
@@ -0,0 +1,176 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_LPM_H
+#define SOFT_TCAM_LPM_H
+
+#include <cstdint>
+#include <bitset>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+#include "soft_tcam_bits.h"
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_lpm
+	 *
+	 * longest prefix match in the style of DIR-24-8, with the same interface
+	 * as soft_tcam, for masks that are prefixes. the top first_bits of the
+	 * key index a table, and each entry there is either the longest route
+	 * covering it or a group of 2^group_bits entries for the next bits, and
+	 * so on down to the last bit. find is one table read per level, one for
+	 * most IPv4 routes with the default of 24. insert and erase only rewrite
+	 * the entries of the prefix they change.
+	 *
+	 * a group is only made where a longer route ends inside it, so for IPv6
+	 * the levels below /64 are only read under the few routes longer than
+	 * /64. the upper half is sparse and is better served by smaller groups,
+	 * e.g. 16 and 4.
+	 *
+	 * among the routes that match, the longest one wins, and priority only
+	 * orders rules with the same prefix. is_ordered() tells if that agrees
+	 * with plain priorities.
+	 */
+	template<class T, size_t size>
+	class soft_tcam_lpm {
+
+	public:
+
+		typedef typename soft_tcam_bits<size>::key_type key_type;
+
+		/*
+		 * ctor
+		 *
+		 * first_bits is between 1 and 24, group_bits between 1 and 16.
+		 */
+		soft_tcam_lpm(std::uint32_t first_bits = 24, std::uint32_t group_bits = 8);
+
+		/*
+		 * insert
+		 */
+		int insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+				const T &object);
+		int insert(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * erase
+		 */
+		int erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+				const T &object);
+		int erase(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * find
+		 *
+		 * with priority, also returns the priority of the rule found.
+		 */
+		const T *find(const std::bitset<size> &key) const;
+		const T *find(const key_type &key) const;
+		const T *find(const key_type &key, std::uint32_t &priority) const;
+
+		/*
+		 * clear
+		 */
+		void clear();
+
+		/*
+		 * is_ordered
+		 *
+		 * true if every route has higher priorities than all shorter
+		 * routes, so the longest match is also the one a soft_tcam with
+		 * the same rules finds.
+		 */
+		bool is_ordered() const;
+
+		/*
+		 * get_route_count
+		 */
+		size_t get_route_count() const;
+
+		/*
+		 * get_entry_count
+		 */
+		size_t get_entry_count() const;
+
+		/*
+		 * get_group_count
+		 */
+		size_t get_group_count() const;
+
+		/*
+		 * get_memory_size
+		 */
+		size_t get_memory_size() const;
+
+	private:
+
+		struct rule {
+			std::uint32_t priority;
+			T object;
+		};
+
+		/*
+		 * priority and object are those of rules[0], the best rule with
+		 * this prefix, so find does not look at rules.
+		 */
+		struct route {
+			key_type data;
+			std::uint32_t length;
+			std::uint32_t priority;
+			T object;
+			std::vector<rule> rules;
+		};
+
+		/*
+		 * a table entry is a route index, 0 for none, or a group index
+		 * with group_flag set.
+		 */
+		static const std::uint32_t group_flag = 0x80000000;
+		static const std::uint32_t max_first_bits = 24;
+		static const std::uint32_t max_group_bits = 16;
+
+		typedef std::pair<key_type, std::uint32_t> prefix;
+
+		struct prefix_hash {
+			size_t operator()(const prefix &p) const;
+		};
+
+		static std::uint32_t get_index(const key_type &key, std::uint32_t position, std::uint32_t count);
+		std::uint32_t find_route(const key_type &key) const;
+
+		std::uint32_t &get_slot(std::uint32_t level, std::uint32_t index);
+		std::uint32_t new_group(std::uint32_t fill);
+		void collapse_group(std::uint32_t level, std::uint32_t index);
+		void insert_range(std::uint32_t level, std::uint32_t index, std::uint32_t count,
+				std::uint32_t length, std::uint32_t id);
+		void erase_range(std::uint32_t level, std::uint32_t index, std::uint32_t count,
+				std::uint32_t id, std::uint32_t cover);
+		void insert_route(std::uint32_t id);
+		void erase_route(std::uint32_t id, std::uint32_t cover);
+
+		std::uint32_t m_group_size;
+		std::vector<std::uint32_t> m_shift;
+		std::vector<std::uint32_t> m_bits;
+		std::vector<std::uint32_t> m_table;
+		std::vector<std::uint32_t> m_groups;
+		std::vector<std::uint32_t> m_free_groups;
+		std::vector<route> m_routes;
+		std::vector<std::uint32_t> m_free_routes;
+		std::unordered_map<prefix, std::uint32_t, prefix_hash> m_index;
+		std::vector<std::map<std::uint32_t, std::uint32_t>> m_lengths;
+		size_t m_entries;
+
+	};
+
+}
+
+#include "soft_tcam_lpm.cc"
+
+#endif // SOFT_TCAM_LPM_H
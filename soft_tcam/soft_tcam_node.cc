@@ -7,220 +7,205 @@
 
 namespace soft_tcam {
 
-	template<class T, size_t size>
-	soft_tcam_node<T, size>::soft_tcam_node(const std::bitset<size> &data, const std::bitset<size> &mask,
-			const std::uint32_t position) :
-		m_data(data), m_mask(mask), m_position(position)
-
-	{
-		m_n0 = nullptr;
-		m_n1 = nullptr;
-		m_ndc = nullptr;
-		m_parent = nullptr;
-		m_entries = nullptr;
-		m_access_counter = 0;
-
-		m_list_next = s_list_head;
-		s_list_head = this;
-	}
-
-	template<class T, size_t size>
-	soft_tcam_node<T, size>::~soft_tcam_node()
-	{
-		soft_tcam_node<T, size> *curr, *prev;
-
-		if (s_list_head == this) {
-			s_list_head = m_list_next;
-			return;
-		}
-
-		prev = s_list_head;
-		curr = s_list_head->m_list_next;
-		while (curr != nullptr) {
-			if (curr == this) {
-				prev->m_list_next = m_list_next;
-				return;
-			}
-			prev = curr;
-			curr = curr->m_list_next;
-		}
-	}
-
-	template<class T, size_t size>
-	void *
-	soft_tcam_node<T, size>::operator new(size_t s)
+	template<class T, size_t size, class counter>
+	soft_tcam_node<T, size, counter>::soft_tcam_node() :
+		m_data(), m_position(free_position), m_mask(0), m_object()
 	{
-		++s_alloc_counter;
-		return malloc(s);
+		m_n0 = 0;
+		m_n1 = 0;
+		m_ndc = 0;
+		m_priority = 0;
 	}
 
-	template<class T, size_t size>
-	void
-	soft_tcam_node<T, size>::operator delete(void *p)
+	template<class T, size_t size, class counter>
+	soft_tcam_node<T, size, counter>::soft_tcam_node(const key_type &data, std::uint16_t mask,
+			const std::uint32_t position) :
+		m_data(data), m_position(position), m_mask(mask), m_object()
 	{
-		--s_alloc_counter;
-		free(p);
+		m_n0 = 0;
+		m_n1 = 0;
+		m_ndc = 0;
+		m_priority = 0;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam_node<T, size>::set_data(const std::bitset<size> &data)
+	soft_tcam_node<T, size, counter>::set_data(const key_type &data)
 	{
 		m_data = data;
 	}
 
-	template<class T, size_t size>
-	const std::bitset<size> &
-	soft_tcam_node<T, size>::get_data()
+	template<class T, size_t size, class counter>
+	const typename soft_tcam_node<T, size, counter>::key_type &
+	soft_tcam_node<T, size, counter>::get_data()
 	{
-		++m_access_counter;
+		this->count_access();
 		return m_data;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam_node<T, size>::set_mask(const std::bitset<size> &mask)
+	soft_tcam_node<T, size, counter>::set_mask(std::uint16_t mask)
 	{
 		m_mask = mask;
 	}
 
-	template<class T, size_t size>
-	const std::bitset<size> &
-	soft_tcam_node<T, size>::get_mask()
+	template<class T, size_t size, class counter>
+	std::uint16_t
+	soft_tcam_node<T, size, counter>::get_mask()
 	{
-		++m_access_counter;
+		this->count_access();
 		return m_mask;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam_node<T, size>::set_position(std::uint32_t position)
+	soft_tcam_node<T, size, counter>::set_position(std::uint32_t position)
 	{
 		m_position = position;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	std::uint32_t
-	soft_tcam_node<T, size>::get_position()
+	soft_tcam_node<T, size, counter>::get_position()
 	{
-		++m_access_counter;
+		this->count_access();
 		return m_position;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam_node<T, size>::set_n0(soft_tcam_node<T, size> *n0)
+	soft_tcam_node<T, size, counter>::set_n0(std::uint32_t n0)
 	{
 		m_n0 = n0;
 	}
 
-	template<class T, size_t size>
-	soft_tcam_node<T, size> *
-	soft_tcam_node<T, size>::get_n0()
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam_node<T, size, counter>::get_n0()
 	{
-		++m_access_counter;
+		this->count_access();
 		return m_n0;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam_node<T, size>::set_n1(soft_tcam_node<T, size> *n1)
+	soft_tcam_node<T, size, counter>::set_n1(std::uint32_t n1)
 	{
 		m_n1 = n1;
 	}
 
-	template<class T, size_t size>
-	soft_tcam_node<T, size> *
-	soft_tcam_node<T, size>::get_n1()
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam_node<T, size, counter>::get_n1()
 	{
-		++m_access_counter;
+		this->count_access();
 		return m_n1;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam_node<T, size>::set_ndc(soft_tcam_node<T, size> *ndc)
+	soft_tcam_node<T, size, counter>::set_ndc(std::uint32_t ndc)
 	{
 		m_ndc = ndc;
 	}
 
-	template<class T, size_t size>
-	soft_tcam_node<T, size> *
-	soft_tcam_node<T, size>::get_ndc()
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam_node<T, size, counter>::get_ndc()
 	{
-		++m_access_counter;
+		this->count_access();
 		return m_ndc;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam_node<T, size>::set_parent(soft_tcam_node<T, size> *parent)
+	soft_tcam_node<T, size, counter>::set_priority(std::uint32_t priority)
 	{
-		m_parent = parent;
+		m_priority = priority;
 	}
 
-	template<class T, size_t size>
-	soft_tcam_node<T, size> *
-	soft_tcam_node<T, size>::get_parent()
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam_node<T, size, counter>::get_priority()
 	{
-		++m_access_counter;
-		return m_parent;
+		this->count_access();
+		return m_priority;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam_node<T, size>::set_entry_head(soft_tcam_entry<T, size> *entry_head)
+	soft_tcam_node<T, size, counter>::set_object(const T *object)
 	{
-		m_entries = entry_head;
+		m_object = object;
 	}
 
-	template<class T, size_t size>
-	soft_tcam_entry<T, size> *
-	soft_tcam_node<T, size>::get_entry_head()
+	template<class T, size_t size, class counter>
+	const T *
+	soft_tcam_node<T, size, counter>::get_object()
 	{
-		++m_access_counter;
-		return m_entries;
+		this->count_access();
+		return m_object;
+	}
+
+	template<class T, size_t size, class counter>
+	bool
+	soft_tcam_node<T, size, counter>::is_free()
+	{
+		return m_position == free_position;
+	}
+
+	template<class T, size_t size, class counter>
+	soft_tcam_node_cold<T, size, counter>::soft_tcam_node_cold()
+	{
+		m_parent = 0;
+		m_entries = nullptr;
+	}
+
+	template<class T, size_t size, class counter>
+	void
+	soft_tcam_node_cold<T, size, counter>::set_parent(std::uint32_t parent)
+	{
+		m_parent = parent;
 	}
 
-	template<class T, size_t size>
-	soft_tcam_node<T, size> *
-	soft_tcam_node<T, size>::get_list_next()
+	template<class T, size_t size, class counter>
+	std::uint32_t
+	soft_tcam_node_cold<T, size, counter>::get_parent()
 	{
-		return m_list_next;
+		return m_parent;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	void
-	soft_tcam_node<T, size>::set_access_counter(std::uint64_t access_counter)
+	soft_tcam_node_cold<T, size, counter>::set_entry_head(soft_tcam_entry<T, size, counter> *entry_head)
 	{
-		m_access_counter = access_counter;
+		m_entries = entry_head;
 	}
 
-	template<class T, size_t size>
-	std::uint64_t
-	soft_tcam_node<T, size>::get_access_counter()
+	template<class T, size_t size, class counter>
+	soft_tcam_entry<T, size, counter> *
+	soft_tcam_node_cold<T, size, counter>::get_entry_head()
 	{
-		return m_access_counter;
+		return m_entries;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	int
-	soft_tcam_node<T, size>::insert_entry(soft_tcam_entry<T, size> *entry)
+	soft_tcam_node_cold<T, size, counter>::insert_entry(soft_tcam_entry<T, size, counter> *entry)
 	{
-		soft_tcam_entry<T, size> *curr, *prev;
+		soft_tcam_entry<T, size, counter> *curr, *prev;
 
 		if (entry == nullptr) {
 			std::cerr << "insert_entry: entry is nullptr." << std::endl;
 			return -1;
 		}
 
-		if (entry->get_node() != nullptr) {
+		if (entry->get_node() != 0) {
 			std::cerr << "insert_entry: entry has already inserted?" << std::endl;
 			return -1;
 		}
 
-		entry->set_node(this);
-
 		if (m_entries == nullptr) {
 			entry->set_next(nullptr);
 			entry->set_prev(nullptr);
@@ -255,11 +240,11 @@ namespace soft_tcam {
 		return 0;
 	}
 
-	template<class T, size_t size>
+	template<class T, size_t size, class counter>
 	int
-	soft_tcam_node<T, size>::erase_entry(soft_tcam_entry<T, size> *entry)
+	soft_tcam_node_cold<T, size, counter>::erase_entry(soft_tcam_entry<T, size, counter> *entry)
 	{
-		soft_tcam_entry<T, size> *curr, *prev;
+		soft_tcam_entry<T, size, counter> *curr, *prev;
 
 		if ((m_entries == nullptr) || (entry == nullptr)) {
 			std::cerr << "erase_entry: m_entries or entry is nullptr" << std::endl;
@@ -273,8 +258,7 @@ namespace soft_tcam {
 			}
 			entry->set_next(nullptr);
 			entry->set_prev(nullptr);
-			entry->set_node(nullptr);
-			delete entry;
+			entry->set_node(0);
 			return 0;
 		}
 
@@ -288,8 +272,7 @@ namespace soft_tcam {
 				}
 				entry->set_next(nullptr);
 				entry->set_prev(nullptr);
-				entry->set_node(nullptr);
-				delete entry;
+				entry->set_node(0);
 				return 0;
 			}
 			prev = curr;
@@ -300,24 +283,4 @@ namespace soft_tcam {
 		return -1;
 	}
 
-	template<class T, size_t size>
-	soft_tcam_node<T, size> *
-	soft_tcam_node<T, size>::get_list_head()
-	{
-		return s_list_head;
-	}
-
-	template<class T, size_t size>
-	std::uint64_t
-	soft_tcam_node<T, size>::get_alloc_counter()
-	{
-		return s_alloc_counter;
-	}
-
-	template<class T, size_t size>
-		soft_tcam_node<T, size> *soft_tcam_node<T, size>::s_list_head = nullptr;
-	template<class T, size_t size>
-		std::uint64_t soft_tcam_node<T, size>::s_alloc_counter = 0;
-
 }
-
@@ -9,55 +9,60 @@
 #include <cstdint>
 #include <bitset>
 
-namespace soft_tcam {
+#include "soft_tcam_bits.h"
+#include "soft_tcam_counter.h"
 
-	template<class T, size_t size> class soft_tcam_entry;
+namespace soft_tcam {
 
-	template<class T, size_t size>
-	class soft_tcam_node {
+	template<class T, size_t size, class counter> class soft_tcam_entry;
+
+	/*
+	 * soft_tcam_node
+	 *
+	 * the part of a node read by lookups. nodes live in a per-table array and
+	 * refer to each other by 32-bit index, index 0 meaning none. a leaf also
+	 * holds a copy of the priority of its best entry and points to the
+	 * object of that entry, which stays put when the array grows, so that
+	 * what find() returns does not dangle. an inner node holds the highest
+	 * priority of any leaf below it instead, so lookups can skip subtrees
+	 * that cannot beat what they have already found. the mask
+	 * is the 16-bit id of the mask in the dictionary of the table, which
+	 * has mask 0 at id 0.
+	 */
+	template<class T, size_t size, class counter = soft_tcam_counter_disabled>
+	class soft_tcam_node : public counter {
 
 	public:
 
-		/*
-		 * ctor
-		 */
-		soft_tcam_node(const std::bitset<size> &data, const std::bitset<size> &mask,
-				const std::uint32_t position);
-
-		/*
-		 * dtor
-		 */
-		virtual ~soft_tcam_node();
+		typedef typename soft_tcam_bits<size>::key_type key_type;
 
-		/*
-		 * new operator overload
-		 */
-		void *operator new(size_t s);
+		static const std::uint32_t free_position = ~std::uint32_t(0);
 
 		/*
-		 * delete operator overload
+		 * ctor
 		 */
-		void operator delete(void *p);
+		soft_tcam_node();
+		soft_tcam_node(const key_type &data, std::uint16_t mask, const std::uint32_t position);
 
 		/*
 		 * data setter
 		 */
-		void set_data(const std::bitset<size> &data);
+		void set_data(const key_type &data);
 
 		/*
 		 * data getter
 		 */
-		const std::bitset<size> &get_data();
+		const key_type &get_data();
 
 		/*
 		 * mask setter
 		 */
-		void set_mask(const std::bitset<size> &mask);
+		void set_mask(std::uint16_t mask);
 
 		/*
 		 * mask getter
 		 */
-		const std::bitset<size> &get_mask();
+		std::uint16_t get_mask();
 
 		/*
 		 * position setter
@@ -72,103 +77,123 @@ namespace soft_tcam {
 		/*
 		 * n0 setter
 		 */
-		void set_n0(soft_tcam_node<T, size> *n0);
+		void set_n0(std::uint32_t n0);
 
 		/*
 		 * n0 getter
 		 */
-		soft_tcam_node<T, size> *get_n0();
+		std::uint32_t get_n0();
 
 		/*
 		 * n1 setter
 		 */
-		void set_n1(soft_tcam_node<T, size> *n1);
+		void set_n1(std::uint32_t n1);
 
 		/*
 		 * n1 getter
 		 */
-		soft_tcam_node<T, size> *get_n1();
+		std::uint32_t get_n1();
 
 		/*
 		 * ndc setter
 		 */
-		void set_ndc(soft_tcam_node<T, size> *ndc);
+		void set_ndc(std::uint32_t ndc);
 
 		/*
 		 * ndc getter
 		 */
-		soft_tcam_node<T, size> *get_ndc();
+		std::uint32_t get_ndc();
 
 		/*
-		 * parent setter
+		 * priority setter
 		 */
-		void set_parent(soft_tcam_node<T, size> *parent);
+		void set_priority(std::uint32_t priority);
 
 		/*
-		 * parent getter
+		 * priority getter
 		 */
-		soft_tcam_node<T, size> *get_parent();
+		std::uint32_t get_priority();
 
 		/*
-		 * set_entry_head
+		 * object setter
 		 */
-		void set_entry_head(soft_tcam_entry<T, size> *entry_head);
+		void set_object(const T *object);
 
 		/*
-		 * get_entry_head
+		 * object getter
 		 */
-		soft_tcam_entry<T, size> *get_entry_head();
+		const T *get_object();
 
 		/*
-		 * get_list_next
+		 * is_free
 		 */
-		soft_tcam_node<T, size> *get_list_next();
+		bool is_free();
+
+	private:
+
+		key_type m_data;
+		std::uint32_t m_position;
+		std::uint32_t m_n0;
+		std::uint32_t m_n1;
+		std::uint32_t m_ndc;
+		std::uint32_t m_priority;
+		std::uint16_t m_mask;
+		const T *m_object;
+
+	};
+
+	/*
+	 * soft_tcam_node_cold
+	 *
+	 * the part of a node only touched by updates, kept in a side array with
+	 * the same index as its soft_tcam_node.
+	 */
+	template<class T, size_t size, class counter = soft_tcam_counter_disabled>
+	class soft_tcam_node_cold {
+
+	public:
 
 		/*
-		 * set_access_counter
+		 * ctor
 		 */
-		void set_access_counter(std::uint64_t access_counter);
+		soft_tcam_node_cold();
 
 		/*
-		 * get_access_counter
+		 * parent setter
 		 */
-		std::uint64_t get_access_counter();
+		void set_parent(std::uint32_t parent);
 
 		/*
-		 * insert_entry
+		 * parent getter
 		 */
-		int insert_entry(soft_tcam_entry<T, size> *entry);
+		std::uint32_t get_parent();
 
 		/*
-		 * erase_entry
+		 * set_entry_head
 		 */
-		int erase_entry(soft_tcam_entry<T, size> *entry);
+		void set_entry_head(soft_tcam_entry<T, size, counter> *entry_head);
 
 		/*
-		 * get_list_head
+		 * get_entry_head
 		 */
-		static soft_tcam_node<T, size> *get_list_head();
+		soft_tcam_entry<T, size, counter> *get_entry_head();
 
 		/*
-		 * get_alloc_counter
+		 * insert_entry
 		 */
-		static std::uint64_t get_alloc_counter();
+		int insert_entry(soft_tcam_entry<T, size, counter> *entry);
 
-	private:
+		/*
+		 * erase_entry
+		 *
+		 * unlinks the entry. the table it came from frees it.
+		 */
+		int erase_entry(soft_tcam_entry<T, size, counter> *entry);
 
-		std::bitset<size> m_data;
-		std::bitset<size> m_mask;
-		std::uint32_t m_position;
-		soft_tcam_node<T, size> *m_n0;
-		soft_tcam_node<T, size> *m_n1;
-		soft_tcam_node<T, size> *m_ndc;
-		soft_tcam_node<T, size> *m_parent;
-		soft_tcam_entry<T, size> *m_entries;
-		soft_tcam_node<T, size> *m_list_next;
-		std::uint64_t m_access_counter;
+	private:
 
-		static soft_tcam_node<T, size> *s_list_head;
-		static std::uint64_t s_alloc_counter;
+		std::uint32_t m_parent;
+		soft_tcam_entry<T, size, counter> *m_entries;
 
 	};
 
@@ -177,4 +202,3 @@ namespace soft_tcam {
 #include "soft_tcam_node.cc"
 
 #endif // SOFT_TCAM_NODE_H
-
@@ -0,0 +1,208 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <algorithm>
+
+#include "soft_tcam_order.h"
+
+namespace soft_tcam {
+
+	template<size_t size>
+	soft_tcam_order<size>::soft_tcam_order()
+	{
+		m_identity = true;
+		for (std::uint32_t i = 0; i < size; ++i) {
+			m_bits.push_back(i);
+		}
+	}
+
+	template<size_t size>
+	soft_tcam_order<size>::soft_tcam_order(const std::vector<std::uint32_t> &bits)
+	{
+		std::vector<std::uint32_t> position(size, size);
+
+		m_identity = true;
+		m_bits.clear();
+		for (std::uint32_t i = 0; i < size; ++i) {
+			m_bits.push_back(i);
+		}
+
+		if (bits.size() != size) {
+			return;
+		}
+		for (std::uint32_t i = 0; i < size; ++i) {
+			if ((bits[i] >= size) || (position[bits[i]] != size)) {
+				return;
+			}
+			position[bits[i]] = i;
+		}
+
+		m_bits = bits;
+		for (std::uint32_t i = 0; i < size; ++i) {
+			if (m_bits[i] != i) {
+				m_identity = false;
+			}
+		}
+		if (m_identity) {
+			return;
+		}
+
+		/*
+		 * m_table[n * 256 + v] is byte n of a key with value v, moved to
+		 * trie order.
+		 */
+		m_table.assign(bytes * 256, key_type());
+		for (std::uint32_t n = 0; n < bytes; ++n) {
+			for (std::uint32_t v = 0; v < 256; ++v) {
+				for (std::uint32_t j = 0; j < 8; ++j) {
+					if (((v >> j) & 1) && (n * 8 + j < size)) {
+						soft_tcam_bits<size>::set(m_table[n * 256 + v], position[n * 8 + j]);
+					}
+				}
+			}
+		}
+	}
+
+	template<size_t size>
+	soft_tcam_order<size>
+	soft_tcam_order<size>::lsb_first()
+	{
+		return soft_tcam_order<size>();
+	}
+
+	template<size_t size>
+	soft_tcam_order<size>
+	soft_tcam_order<size>::msb_first()
+	{
+		std::vector<std::uint32_t> bits;
+
+		for (std::uint32_t i = 0; i < size; ++i) {
+			bits.push_back(size - 1 - i);
+		}
+
+		return soft_tcam_order<size>(bits);
+	}
+
+	template<size_t size>
+	soft_tcam_order<size>
+	soft_tcam_order<size>::interleave(const std::vector<std::uint32_t> &widths)
+	{
+		std::vector<std::uint32_t> bits, top, left;
+		std::uint32_t msb = size;
+
+		for (auto it = widths.begin(); it != widths.end(); ++it) {
+			std::uint32_t width = std::min(*it, msb);
+			top.push_back(msb);
+			left.push_back(width);
+			msb -= width;
+		}
+
+		for (bool more = true; more; ) {
+			more = false;
+			for (std::uint32_t f = 0; f < top.size(); ++f) {
+				if (left[f] == 0) {
+					continue;
+				}
+				--top[f];
+				--left[f];
+				bits.push_back(top[f]);
+				more = true;
+			}
+		}
+		while (msb > 0) {
+			bits.push_back(--msb);
+		}
+
+		return soft_tcam_order<size>(bits);
+	}
+
+	template<size_t size>
+	soft_tcam_order<size>
+	soft_tcam_order<size>::learn(const std::vector<key_type> &data, const std::vector<key_type> &mask)
+	{
+		std::vector<std::uint64_t> wildcard(size, 0), ones(size, 0), zeros(size, 0);
+		std::vector<std::uint32_t> bits;
+
+		for (std::uint32_t r = 0; r < mask.size(); ++r) {
+			for (std::uint32_t i = 0; i < size; ++i) {
+				if (!soft_tcam_bits<size>::test(mask[r], i)) {
+					++wildcard[i];
+				} else if (soft_tcam_bits<size>::test(data[r], i)) {
+					++ones[i];
+				} else {
+					++zeros[i];
+				}
+			}
+		}
+
+		for (std::uint32_t i = 0; i < size; ++i) {
+			bits.push_back(size - 1 - i);
+		}
+		std::stable_sort(bits.begin(), bits.end(),
+				[&](std::uint32_t l, std::uint32_t r) {
+					std::uint64_t lskew, rskew;
+					if (wildcard[l] != wildcard[r]) {
+						return wildcard[l] < wildcard[r];
+					}
+					lskew = std::max(ones[l], zeros[l]) - std::min(ones[l], zeros[l]);
+					rskew = std::max(ones[r], zeros[r]) - std::min(ones[r], zeros[r]);
+					return lskew < rskew;
+				});
+
+		return soft_tcam_order<size>(bits);
+	}
+
+	template<size_t size>
+	bool
+	soft_tcam_order<size>::is_identity() const
+	{
+		return m_identity;
+	}
+
+	template<size_t size>
+	std::uint32_t
+	soft_tcam_order<size>::get_bit(std::uint32_t position) const
+	{
+		return m_bits[position];
+	}
+
+	template<size_t size>
+	typename soft_tcam_order<size>::key_type
+	soft_tcam_order<size>::apply(const key_type &key) const
+	{
+		key_type result = key_type();
+		const key_type *table = m_table.data();
+
+		if (m_identity) {
+			return key;
+		}
+
+		for (std::uint32_t n = 0; n < bytes; ++n) {
+			soft_tcam_bits<size>::merge(result, table[n * 256 + soft_tcam_bits<size>::get_byte(key, n)]);
+		}
+
+		return result;
+	}
+
+	template<size_t size>
+	typename soft_tcam_order<size>::key_type
+	soft_tcam_order<size>::restore(const key_type &key) const
+	{
+		key_type result = key_type();
+
+		if (m_identity) {
+			return key;
+		}
+
+		for (std::uint32_t i = 0; i < size; ++i) {
+			if (soft_tcam_bits<size>::test(key, i)) {
+				soft_tcam_bits<size>::set(result, m_bits[i]);
+			}
+		}
+
+		return result;
+	}
+
+}
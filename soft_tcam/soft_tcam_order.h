@@ -0,0 +1,114 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_ORDER_H
+#define SOFT_TCAM_ORDER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "soft_tcam_bits.h"
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_order
+	 *
+	 * the order in which the trie tests key bits. trie position i holds key
+	 * bit get_bit(i). keys are moved into trie order once per insert, erase
+	 * or find with one table lookup per key byte, so the trie itself always
+	 * tests position 0 upward.
+	 */
+	template<size_t size>
+	class soft_tcam_order {
+
+	public:
+
+		typedef typename soft_tcam_bits<size>::key_type key_type;
+
+		/*
+		 * ctor
+		 *
+		 * lsb first, the identity order.
+		 */
+		soft_tcam_order();
+
+		/*
+		 * ctor
+		 *
+		 * bits[i] is the key bit tested at trie position i. returns the
+		 * identity order if bits is not a permutation of [0, size).
+		 */
+		explicit soft_tcam_order(const std::vector<std::uint32_t> &bits);
+
+		/*
+		 * lsb_first
+		 */
+		static soft_tcam_order<size> lsb_first();
+
+		/*
+		 * msb_first
+		 *
+		 * the order for prefix rules, where the low bits are the wildcards.
+		 */
+		static soft_tcam_order<size> msb_first();
+
+		/*
+		 * interleave
+		 *
+		 * widths are the field widths from the most significant end of the
+		 * key. takes the next bit, msb first, of each field in turn. bits not
+		 * covered by widths follow msb first.
+		 */
+		static soft_tcam_order<size> interleave(const std::vector<std::uint32_t> &widths);
+
+		/*
+		 * learn
+		 *
+		 * picks an order for the given rules: bits that fewer rules leave as
+		 * wildcard come first, ties go to the bit that splits the remaining
+		 * rules more evenly between 0 and 1.
+		 */
+		static soft_tcam_order<size> learn(const std::vector<key_type> &data, const std::vector<key_type> &mask);
+
+		/*
+		 * is_identity
+		 */
+		bool is_identity() const;
+
+		/*
+		 * get_bit
+		 */
+		std::uint32_t get_bit(std::uint32_t position) const;
+
+		/*
+		 * apply
+		 *
+		 * key in key order to key in trie order.
+		 */
+		key_type apply(const key_type &key) const;
+
+		/*
+		 * restore
+		 *
+		 * key in trie order to key in key order. not for the lookup path.
+		 */
+		key_type restore(const key_type &key) const;
+
+	private:
+
+		static const std::uint32_t bytes = (size + 7) / 8;
+
+		bool m_identity;
+		std::vector<std::uint32_t> m_bits;
+		std::vector<key_type> m_table;
+
+	};
+
+}
+
+#include "soft_tcam_order.cc"
+
+#endif // SOFT_TCAM_ORDER_H
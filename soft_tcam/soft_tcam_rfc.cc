@@ -0,0 +1,308 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+#include "soft_tcam_rfc.h"
+
+namespace soft_tcam {
+
+	template<class T, size_t size>
+	const size_t soft_tcam_rfc<T, size>::max_table;
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_rfc<T, size>::bitmap_hash::operator()(const bitmap &b) const
+	{
+		std::uint64_t h = 0;
+
+		for (auto it = b.begin(); it != b.end(); ++it) {
+			h = (h ^ *it) * 0x9e3779b97f4a7c15ULL;
+		}
+
+		return h ^ (h >> 32);
+	}
+
+	template<class T, size_t size>
+	soft_tcam_rfc<T, size>::soft_tcam_rfc(std::uint32_t chunk_bits)
+	{
+		m_chunk_bits = std::min<std::uint32_t>(std::max<std::uint32_t>(chunk_bits, 1), 16);
+		m_chunk_count = (size + m_chunk_bits - 1) / m_chunk_bits;
+	}
+
+	template<class T, size_t size>
+	template<class counter>
+	int
+	soft_tcam_rfc<T, size>::build(soft_tcam<T, size, counter> &tcam, std::uint32_t threads)
+	{
+		std::vector<key_type> data, mask;
+		std::vector<std::uint32_t> priority;
+		std::vector<T> object;
+
+		tcam.get_entries(data, mask, priority, object);
+
+		return build(data, mask, priority, object, threads);
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_rfc<T, size>::build(const std::vector<key_type> &data, const std::vector<key_type> &mask,
+			const std::vector<std::uint32_t> &priority, const std::vector<T> &object,
+			std::uint32_t threads)
+	{
+		std::vector<std::uint32_t> ids, level, next;
+		std::vector<std::vector<bitmap>> classes(m_chunk_count);
+		std::vector<std::thread> workers;
+		std::uint32_t rules = data.size();
+		std::uint32_t words = (rules + 63) / 64;
+
+		if ((mask.size() != data.size()) || (priority.size() != data.size()) || (object.size() != data.size())) {
+			std::cerr << "build: rule list error." << std::endl;
+			return -1;
+		}
+		for (std::uint32_t i = 0; i < rules; ++i) {
+			if (!soft_tcam_bits<size>::is_valid(data[i], mask[i])) {
+				std::cerr << "build: data/mask error." << std::endl;
+				return -1;
+			}
+			ids.push_back(i);
+		}
+		if (threads == 0) {
+			threads = std::max<std::uint32_t>(std::thread::hardware_concurrency(), 1);
+		}
+
+		/*
+		 * rule i of the bitmaps is m_object[i], highest priority first, so
+		 * the best rule of a class is its lowest bit.
+		 */
+		std::stable_sort(ids.begin(), ids.end(),
+				[&](std::uint32_t l, std::uint32_t r) { return priority[l] > priority[r]; });
+		m_chunks.assign(m_chunk_count, std::vector<std::uint32_t>());
+		m_steps.clear();
+		m_priority.clear();
+		m_object.clear();
+		for (auto it = ids.begin(); it != ids.end(); ++it) {
+			m_priority.push_back(priority[*it]);
+			m_object.push_back(object[*it]);
+		}
+
+		/*
+		 * phase 0, one chunk per thread at a time.
+		 */
+		for (std::uint32_t t = 0; t < threads; ++t) {
+			workers.emplace_back([&, t]() {
+				for (std::uint32_t c = t; c < m_chunk_count; c += threads) {
+					std::unordered_map<bitmap, std::uint32_t, bitmap_hash> seen;
+					std::vector<std::uint32_t> rd(rules), rm(rules);
+					std::uint32_t low = c * m_chunk_bits;
+					std::uint32_t width = std::min<std::uint32_t>(m_chunk_bits, size - low);
+					bitmap x(words);
+					for (std::uint32_t r = 0; r < rules; ++r) {
+						rd[r] = soft_tcam_bits<size>::get_bits(data[ids[r]], low, width);
+						rm[r] = soft_tcam_bits<size>::get_bits(mask[ids[r]], low, width);
+					}
+					for (std::uint32_t v = 0; v < (std::uint32_t(1) << width); ++v) {
+						std::fill(x.begin(), x.end(), 0);
+						for (std::uint32_t r = 0; r < rules; ++r) {
+							if (((v ^ rd[r]) & rm[r]) == 0) {
+								x[r / 64] |= std::uint64_t(1) << (r % 64);
+							}
+						}
+						if (m_chunk_count == 1) {
+							m_chunks[c].push_back(first_rule(x, rules));
+							continue;
+						}
+						auto it = seen.find(x);
+						if (it == seen.end()) {
+							it = seen.emplace(x, classes[c].size()).first;
+							classes[c].push_back(x);
+						}
+						m_chunks[c].push_back(it->second);
+					}
+				}
+			});
+		}
+		for (auto it = workers.begin(); it != workers.end(); ++it) {
+			it->join();
+		}
+
+		/*
+		 * combine neighbours until one is left, the last cross product
+		 * gives rule indices instead of classes.
+		 */
+		for (std::uint32_t c = 0; c < m_chunk_count; ++c) {
+			level.push_back(c);
+		}
+		while (level.size() > 1) {
+			next.clear();
+			for (std::uint32_t k = 0; k + 1 < level.size(); k += 2) {
+				step s;
+				std::vector<bitmap> result;
+				s.a = level[k];
+				s.b = level[k + 1];
+				s.width = classes[s.b].size();
+				if (classes[s.a].size() * classes[s.b].size() > max_table) {
+					std::cerr << "build: table too large." << std::endl;
+					m_chunks.clear();
+					m_steps.clear();
+					m_priority.clear();
+					m_object.clear();
+					return -1;
+				}
+				combine(classes[s.a], classes[s.b], s.table, result, level.size() == 2, rules, threads);
+				std::vector<bitmap>().swap(classes[s.a]);
+				std::vector<bitmap>().swap(classes[s.b]);
+				classes.push_back(std::move(result));
+				next.push_back(m_chunk_count + m_steps.size());
+				m_steps.push_back(std::move(s));
+			}
+			if (level.size() % 2 != 0) {
+				next.push_back(level.back());
+			}
+			level.swap(next);
+		}
+
+		return 0;
+	}
+
+	template<class T, size_t size>
+	std::uint32_t
+	soft_tcam_rfc<T, size>::first_rule(const bitmap &b, std::uint32_t rules)
+	{
+		for (std::uint32_t w = 0; w < b.size(); ++w) {
+			if (b[w] != 0) {
+				return w * 64 + __builtin_ctzll(b[w]);
+			}
+		}
+
+		return rules;
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_rfc<T, size>::combine(const std::vector<bitmap> &ca, const std::vector<bitmap> &cb,
+			std::vector<std::uint32_t> &table, std::vector<bitmap> &classes,
+			bool last, std::uint32_t rules, std::uint32_t threads)
+	{
+		std::vector<std::vector<bitmap>> found(threads);
+		std::vector<std::vector<std::uint32_t>> remap(threads);
+		std::unordered_map<bitmap, std::uint32_t, bitmap_hash> seen;
+		std::vector<std::thread> workers;
+		size_t na = ca.size(), nb = cb.size();
+
+		/*
+		 * each thread takes every threads-th row and numbers the classes
+		 * it finds on its own, they are merged afterwards.
+		 */
+		table.assign(na * nb, 0);
+		for (std::uint32_t t = 0; t < threads; ++t) {
+			workers.emplace_back([&, t]() {
+				std::unordered_map<bitmap, std::uint32_t, bitmap_hash> local;
+				bitmap x(na == 0 ? 0 : ca[0].size());
+				for (size_t i = t; i < na; i += threads) {
+					for (size_t j = 0; j < nb; ++j) {
+						for (size_t w = 0; w < x.size(); ++w) {
+							x[w] = ca[i][w] & cb[j][w];
+						}
+						if (last) {
+							table[i * nb + j] = first_rule(x, rules);
+							continue;
+						}
+						auto it = local.find(x);
+						if (it == local.end()) {
+							it = local.emplace(x, found[t].size()).first;
+							found[t].push_back(x);
+						}
+						table[i * nb + j] = it->second;
+					}
+				}
+			});
+		}
+		for (auto it = workers.begin(); it != workers.end(); ++it) {
+			it->join();
+		}
+		if (last) {
+			return;
+		}
+
+		classes.clear();
+		for (std::uint32_t t = 0; t < threads; ++t) {
+			for (auto it = found[t].begin(); it != found[t].end(); ++it) {
+				auto s = seen.find(*it);
+				if (s == seen.end()) {
+					s = seen.emplace(*it, classes.size()).first;
+					classes.push_back(*it);
+				}
+				remap[t].push_back(s->second);
+			}
+		}
+		for (std::uint32_t t = 0; t < threads; ++t) {
+			for (size_t i = t; i < na; i += threads) {
+				for (size_t j = 0; j < nb; ++j) {
+					table[i * nb + j] = remap[t][table[i * nb + j]];
+				}
+			}
+		}
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_rfc<T, size>::find(const std::bitset<size> &key) const
+	{
+		return find(soft_tcam_bits<size>::from_bitset(key));
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_rfc<T, size>::find(const key_type &key) const
+	{
+		std::uint32_t results[2 * size];
+		std::uint32_t low, r;
+
+		if (m_chunks.empty()) {
+			return nullptr;
+		}
+
+		for (std::uint32_t c = 0; c < m_chunk_count; ++c) {
+			low = c * m_chunk_bits;
+			results[c] = m_chunks[c][soft_tcam_bits<size>::get_bits(key, low,
+					std::min<std::uint32_t>(m_chunk_bits, size - low))];
+		}
+		for (std::uint32_t j = 0; j < m_steps.size(); ++j) {
+			const step &s = m_steps[j];
+			results[m_chunk_count + j] = s.table[size_t(results[s.a]) * s.width + results[s.b]];
+		}
+		r = results[m_chunk_count + m_steps.size() - 1];
+
+		return (r < m_object.size()) ? &m_object[r] : nullptr;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_rfc<T, size>::get_table_count() const
+	{
+		return m_chunks.size() + m_steps.size();
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_rfc<T, size>::get_memory_size() const
+	{
+		size_t bytes = m_object.size() * (sizeof(std::uint32_t) + sizeof(T));
+
+		for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it) {
+			bytes += it->size() * sizeof(std::uint32_t);
+		}
+		for (auto it = m_steps.begin(); it != m_steps.end(); ++it) {
+			bytes += it->table.size() * sizeof(std::uint32_t);
+		}
+
+		return bytes;
+	}
+
+}
@@ -0,0 +1,113 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_RFC_H
+#define SOFT_TCAM_RFC_H
+
+#include <cstdint>
+#include <bitset>
+#include <vector>
+
+#include "soft_tcam_bits.h"
+#include "soft_tcam.h"
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_rfc
+	 *
+	 * recursive flow classification, built from a fixed rule list. the key
+	 * is cut into chunks of chunk_bits bits. for each chunk a table maps
+	 * every chunk value to the class of values matched by the same rules.
+	 * then two results at a time are combined through a cross product table
+	 * into a class of the pair, until one is left, which is the index of the
+	 * best rule. a lookup always reads one entry per table, no matter what
+	 * the rules look like, at the cost of tables that can get large. the
+	 * cross products are built by several threads.
+	 */
+	template<class T, size_t size>
+	class soft_tcam_rfc {
+
+	public:
+
+		typedef typename soft_tcam_bits<size>::key_type key_type;
+
+		/*
+		 * ctor
+		 *
+		 * chunk_bits is between 1 and 16.
+		 */
+		soft_tcam_rfc(std::uint32_t chunk_bits = 8);
+
+		/*
+		 * build
+		 *
+		 * threads 0 means std::thread::hardware_concurrency().
+		 */
+		template<class counter>
+		int build(soft_tcam<T, size, counter> &tcam, std::uint32_t threads = 0);
+		int build(const std::vector<key_type> &data, const std::vector<key_type> &mask,
+				const std::vector<std::uint32_t> &priority, const std::vector<T> &object,
+				std::uint32_t threads = 0);
+
+		/*
+		 * find
+		 */
+		const T *find(const std::bitset<size> &key) const;
+		const T *find(const key_type &key) const;
+
+		/*
+		 * get_table_count
+		 */
+		size_t get_table_count() const;
+
+		/*
+		 * get_memory_size
+		 */
+		size_t get_memory_size() const;
+
+	private:
+
+		typedef std::vector<std::uint64_t> bitmap;
+
+		struct bitmap_hash {
+			size_t operator()(const bitmap &b) const;
+		};
+
+		/*
+		 * result = table[results[a] * width + results[b]], width being the
+		 * number of classes of b.
+		 */
+		struct step {
+			std::uint32_t a;
+			std::uint32_t b;
+			std::uint32_t width;
+			std::vector<std::uint32_t> table;
+		};
+
+		/*
+		 * cross products larger than this many entries are refused.
+		 */
+		static const size_t max_table = size_t(1) << 28;
+
+		static std::uint32_t first_rule(const bitmap &b, std::uint32_t rules);
+		static void combine(const std::vector<bitmap> &ca, const std::vector<bitmap> &cb,
+				std::vector<std::uint32_t> &table, std::vector<bitmap> &classes,
+				bool last, std::uint32_t rules, std::uint32_t threads);
+
+		std::uint32_t m_chunk_bits;
+		std::uint32_t m_chunk_count;
+		std::vector<std::vector<std::uint32_t>> m_chunks;
+		std::vector<step> m_steps;
+		std::vector<std::uint32_t> m_priority;
+		std::vector<T> m_object;
+
+	};
+
+}
+
+#include "soft_tcam_rfc.cc"
+
+#endif // SOFT_TCAM_RFC_H
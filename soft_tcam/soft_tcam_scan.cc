@@ -0,0 +1,223 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <iostream>
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "soft_tcam_scan.h"
+
+namespace soft_tcam {
+
+	template<size_t size, class K>
+	size_t
+	soft_tcam_scan_kernel<size, K>::find_first(const K &key, const K *data, const K *mask, size_t n)
+	{
+		size_t i = 0;
+
+		/*
+		 * only find out whether a block has a match, the loop below finds
+		 * which row it is.
+		 */
+		for (; i + 8 <= n; i += 8) {
+			bool hit = false;
+			for (std::uint32_t j = 0; j < 8; ++j) {
+				hit |= soft_tcam_bits<size>::is_match(key, data[i + j], mask[i + j], 0, size);
+			}
+			if (hit) {
+				break;
+			}
+		}
+		for (; i < n; ++i) {
+			if (soft_tcam_bits<size>::is_match(key, data[i], mask[i], 0, size)) {
+				return i;
+			}
+		}
+
+		return n;
+	}
+
+	template<size_t size, class K>
+	const char *
+	soft_tcam_scan_kernel<size, K>::get_name()
+	{
+		return "scalar";
+	}
+
+#ifdef __AVX2__
+	template<size_t size>
+	size_t
+	soft_tcam_scan_kernel<size, std::uint32_t>::find_first(const std::uint32_t &key, const std::uint32_t *data,
+			const std::uint32_t *mask, size_t n)
+	{
+		__m256i k = _mm256_set1_epi32(key);
+		__m256i zero = _mm256_setzero_si256();
+		size_t i = 0;
+
+		for (; i + 8 <= n; i += 8) {
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+			__m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask + i));
+			__m256i x = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_xor_si256(k, d), m), zero);
+			std::uint32_t hit = _mm256_movemask_ps(_mm256_castsi256_ps(x));
+			if (hit != 0) {
+				return i + __builtin_ctz(hit);
+			}
+		}
+		for (; i < n; ++i) {
+			if (((key ^ data[i]) & mask[i]) == 0) {
+				return i;
+			}
+		}
+
+		return n;
+	}
+
+	template<size_t size>
+	const char *
+	soft_tcam_scan_kernel<size, std::uint32_t>::get_name()
+	{
+		return "avx2";
+	}
+
+	template<size_t size>
+	size_t
+	soft_tcam_scan_kernel<size, std::uint64_t>::find_first(const std::uint64_t &key, const std::uint64_t *data,
+			const std::uint64_t *mask, size_t n)
+	{
+		__m256i k = _mm256_set1_epi64x(key);
+		__m256i zero = _mm256_setzero_si256();
+		size_t i = 0;
+
+		for (; i + 4 <= n; i += 4) {
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+			__m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask + i));
+			__m256i x = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_xor_si256(k, d), m), zero);
+			std::uint32_t hit = _mm256_movemask_pd(_mm256_castsi256_pd(x));
+			if (hit != 0) {
+				return i + __builtin_ctz(hit);
+			}
+		}
+		for (; i < n; ++i) {
+			if (((key ^ data[i]) & mask[i]) == 0) {
+				return i;
+			}
+		}
+
+		return n;
+	}
+
+	template<size_t size>
+	const char *
+	soft_tcam_scan_kernel<size, std::uint64_t>::get_name()
+	{
+		return "avx2";
+	}
+#endif
+
+	template<class T, size_t size>
+	soft_tcam_scan<T, size>::soft_tcam_scan()
+	{
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_scan<T, size>::insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+			const T &object)
+	{
+		return insert(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_scan<T, size>::insert(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object)
+	{
+		size_t i;
+
+		if (!soft_tcam_bits<size>::is_valid(data, mask)) {
+			std::cerr << "insert: data/mask error." << std::endl;
+			return -1;
+		}
+
+		/*
+		 * after every rule of the same or higher priority.
+		 */
+		i = std::upper_bound(m_priority.begin(), m_priority.end(), priority,
+				[](std::uint32_t l, std::uint32_t r) { return l > r; }) - m_priority.begin();
+
+		m_data.insert(m_data.begin() + i, data);
+		m_mask.insert(m_mask.begin() + i, mask);
+		m_priority.insert(m_priority.begin() + i, priority);
+		m_object.insert(m_object.begin() + i, object);
+
+		return 0;
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_scan<T, size>::erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+			const T &object)
+	{
+		return erase(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_scan<T, size>::erase(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object)
+	{
+		size_t i;
+
+		i = std::lower_bound(m_priority.begin(), m_priority.end(), priority,
+				[](std::uint32_t l, std::uint32_t r) { return l > r; }) - m_priority.begin();
+
+		for (; (i < m_priority.size()) && (m_priority[i] == priority); ++i) {
+			if ((m_data[i] == data) && (m_mask[i] == mask) && (m_object[i] == object)) {
+				m_data.erase(m_data.begin() + i);
+				m_mask.erase(m_mask.begin() + i);
+				m_priority.erase(m_priority.begin() + i);
+				m_object.erase(m_object.begin() + i);
+				return 0;
+			}
+		}
+
+		std::cerr << "erase: entry not found." << std::endl;
+		return -1;
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_scan<T, size>::find(const std::bitset<size> &key) const
+	{
+		return find(soft_tcam_bits<size>::from_bitset(key));
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_scan<T, size>::find(const key_type &key) const
+	{
+		size_t i;
+
+		i = soft_tcam_scan_kernel<size>::find_first(key, m_data.data(), m_mask.data(), m_data.size());
+		if (i == m_data.size()) {
+			return nullptr;
+		}
+
+		return &m_object[i];
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_scan<T, size>::get_entry_count() const
+	{
+		return m_data.size();
+	}
+
+}
@@ -0,0 +1,108 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_SCAN_H
+#define SOFT_TCAM_SCAN_H
+
+#include <cstdint>
+#include <bitset>
+#include <vector>
+
+#include "soft_tcam_bits.h"
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_scan_kernel
+	 *
+	 * find_first returns the first i in [0, n) with
+	 * ((key ^ data[i]) & mask[i]) == 0, or n. rows are checked in blocks so
+	 * that the compiler can vectorize them. with AVX2 the 32 and 64 bit keys
+	 * use it directly. get_name says which of the two is built, "avx2" or
+	 * "scalar".
+	 */
+	template<size_t size, class K = typename soft_tcam_bits<size>::key_type>
+	struct soft_tcam_scan_kernel {
+		static size_t find_first(const K &key, const K *data, const K *mask, size_t n);
+		static const char *get_name();
+	};
+
+#ifdef __AVX2__
+	template<size_t size>
+	struct soft_tcam_scan_kernel<size, std::uint32_t> {
+		static size_t find_first(const std::uint32_t &key, const std::uint32_t *data,
+				const std::uint32_t *mask, size_t n);
+		static const char *get_name();
+	};
+
+	template<size_t size>
+	struct soft_tcam_scan_kernel<size, std::uint64_t> {
+		static size_t find_first(const std::uint64_t &key, const std::uint64_t *data,
+				const std::uint64_t *mask, size_t n);
+		static const char *get_name();
+	};
+#endif
+
+	/*
+	 * soft_tcam_scan
+	 *
+	 * brute force ternary matcher with the same interface as soft_tcam. the
+	 * rules are kept in arrays sorted by priority, highest first, so the
+	 * first rule that matches is the answer. for up to a few thousand rules
+	 * this beats walking the trie.
+	 */
+	template<class T, size_t size>
+	class soft_tcam_scan {
+
+	public:
+
+		typedef typename soft_tcam_bits<size>::key_type key_type;
+
+		/*
+		 * ctor
+		 */
+		soft_tcam_scan();
+
+		/*
+		 * insert
+		 */
+		int insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+				const T &object);
+		int insert(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * erase
+		 */
+		int erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+				const T &object);
+		int erase(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * find
+		 */
+		const T *find(const std::bitset<size> &key) const;
+		const T *find(const key_type &key) const;
+
+		/*
+		 * get_entry_count
+		 */
+		size_t get_entry_count() const;
+
+	private:
+
+		std::vector<key_type> m_data;
+		std::vector<key_type> m_mask;
+		std::vector<std::uint32_t> m_priority;
+		std::vector<T> m_object;
+
+	};
+
+}
+
+#include "soft_tcam_scan.cc"
+
+#endif // SOFT_TCAM_SCAN_H
@@ -0,0 +1,202 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "soft_tcam_snapshot.h"
+
+namespace soft_tcam {
+
+	template<class T, size_t size>
+	const std::uint32_t soft_tcam_snapshot<T, size>::bucket_position;
+
+	template<class T, size_t size>
+	const std::uint32_t soft_tcam_snapshot<T, size>::multibit_position;
+
+	template<class T, size_t size>
+	soft_tcam_snapshot<T, size>::soft_tcam_snapshot(bool huge, bool lock)
+		: m_nodes(soft_tcam_allocator<node>(huge, lock)),
+		  m_children(soft_tcam_allocator<std::uint32_t>(huge, lock)),
+		  m_bucket_data(soft_tcam_allocator<key_type>(huge, lock)),
+		  m_bucket_mask(soft_tcam_allocator<key_type>(huge, lock)),
+		  m_bucket_priority(soft_tcam_allocator<std::uint32_t>(huge, lock)),
+		  m_bucket_object(soft_tcam_allocator<T>(huge, lock))
+	{
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_snapshot<T, size>::find(const std::bitset<size> &key) const
+	{
+		return find(soft_tcam_bits<size>::from_bitset(key));
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_snapshot<T, size>::find(const key_type &key) const
+	{
+		const node *nodes = m_nodes.data();
+		const T *best = nullptr;
+		std::uint32_t best_priority = 0;
+		std::uint32_t index, temp, ndc, first, count, i;
+		std::uint32_t stack_node[size], *stack_node_ptr = &stack_node[0];
+		key_type k;
+
+		best = m_exact.find(key, best_priority);
+		if ((best != nullptr) && (m_nodes.empty() || (best_priority >= nodes[0].priority))) {
+			return best;
+		}
+		if (m_nodes.empty()) {
+			return best;
+		}
+
+		/*
+		 * same walk as soft_tcam::find_entry, but the span of each node is
+		 * already cut out of its mask so no range is computed, and children
+		 * are at index + offset. offset 0 means none, since a child always
+		 * comes after its parent.
+		 */
+		k = m_order.apply(key);
+		index = 0;
+retry:
+		for (;;) {
+			const node *n = &nodes[index];
+			if ((best != nullptr) && (n->priority <= best_priority)) {
+				break;
+			}
+			if (!soft_tcam_bits<size>::is_match(k, n->data, n->mask, 0, size)) {
+				break;
+			}
+			if (n->position == size) {
+				best = &n->object;
+				best_priority = n->priority;
+				break;
+			}
+			if (n->position == bucket_position) {
+				first = n->n0;
+				count = n->n1;
+				i = soft_tcam_scan_kernel<size>::find_first(k, &m_bucket_data[first],
+						&m_bucket_mask[first], count);
+				if ((i != count) && ((best == nullptr) || (m_bucket_priority[first + i] > best_priority))) {
+					best = &m_bucket_object[first + i];
+					best_priority = m_bucket_priority[first + i];
+				}
+				break;
+			}
+			if (n->position > bucket_position) {
+				/*
+				 * children of a multibit node are plain indexes, not
+				 * offsets, 0 for none.
+				 */
+				temp = m_children[n->n0 + soft_tcam_bits<size>::get_bits(k, n->position - multibit_position, n->n1)];
+				ndc = n->ndc;
+				if (ndc != 0) {
+					if (temp != 0) {
+						if (nodes[index + ndc].priority > nodes[temp].priority) {
+							*stack_node_ptr = temp;
+							temp = index + ndc;
+						} else {
+							*stack_node_ptr = index + ndc;
+						}
+						++stack_node_ptr;
+					} else {
+						temp = index + ndc;
+					}
+				}
+				if (temp == 0) {
+					break;
+				}
+				index = temp;
+				continue;
+			}
+			if (!soft_tcam_bits<size>::test(k, n->position)) {
+				temp = n->n0;
+			} else {
+				temp = n->n1;
+			}
+			ndc = n->ndc;
+			if (ndc != 0) {
+				if (temp != 0) {
+					if (nodes[index + ndc].priority > nodes[index + temp].priority) {
+						std::swap(temp, ndc);
+					}
+					*stack_node_ptr = index + ndc;
+					++stack_node_ptr;
+				} else {
+					temp = ndc;
+				}
+			}
+			if (temp == 0) {
+				break;
+			}
+			index += temp;
+		}
+		if (stack_node_ptr != &stack_node[0]) {
+			--stack_node_ptr;
+			index = *stack_node_ptr;
+			goto retry;
+		}
+
+		return best;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_snapshot<T, size>::get_node_count() const
+	{
+		return m_nodes.size();
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_snapshot<T, size>::get_depth() const
+	{
+		std::vector<std::uint32_t> depth(m_nodes.size(), 1);
+		size_t deepest = 0;
+
+		/*
+		 * children always come after their parent.
+		 */
+		for (std::uint32_t i = 0; i < m_nodes.size(); ++i) {
+			const node &n = m_nodes[i];
+			deepest = std::max<size_t>(deepest, depth[i]);
+			if ((n.position == size) || (n.position == bucket_position)) {
+				continue;
+			}
+			if (n.ndc != 0) {
+				depth[i + n.ndc] = std::max(depth[i + n.ndc], depth[i] + 1);
+			}
+			if (n.position > bucket_position) {
+				for (std::uint32_t j = 0; j < (std::uint32_t(1) << n.n1); ++j) {
+					std::uint32_t c = m_children[n.n0 + j];
+					if (c != 0) {
+						depth[c] = std::max(depth[c], depth[i] + 1);
+					}
+				}
+				continue;
+			}
+			if (n.n0 != 0) {
+				depth[i + n.n0] = std::max(depth[i + n.n0], depth[i] + 1);
+			}
+			if (n.n1 != 0) {
+				depth[i + n.n1] = std::max(depth[i + n.n1], depth[i] + 1);
+			}
+		}
+
+		return deepest;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_snapshot<T, size>::get_memory_size() const
+	{
+		return m_nodes.size() * sizeof(node)
+			+ m_children.size() * sizeof(std::uint32_t)
+			+ m_bucket_data.size() * (sizeof(key_type) * 2 + sizeof(std::uint32_t) + sizeof(T))
+			+ m_exact.get_memory_size();
+	}
+
+}
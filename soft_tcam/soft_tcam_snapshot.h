@@ -0,0 +1,127 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_SNAPSHOT_H
+#define SOFT_TCAM_SNAPSHOT_H
+
+#include <cstdint>
+#include <bitset>
+#include <vector>
+
+#include "soft_tcam_bits.h"
+#include "soft_tcam_allocator.h"
+#include "soft_tcam_order.h"
+#include "soft_tcam_scan.h"
+#include "soft_tcam_exact.h"
+
+namespace soft_tcam {
+
+	template<class T, size_t size, class counter> class soft_tcam;
+
+	/*
+	 * soft_tcam_snapshot
+	 *
+	 * read only copy of a soft_tcam made by soft_tcam::compile(). the nodes
+	 * are in one array in breadth first order, so the upper levels that every
+	 * lookup reads share cache lines and pages. a node stores the bits it
+	 * checks already cut down to its own span and refers to its children by
+	 * offset. later updates to the soft_tcam are not seen until the next
+	 * compile().
+	 *
+	 * with a bucket size, a subtree with that many rules or less is not
+	 * walked but kept as a bucket, a list of its rules sorted by priority
+	 * that is scanned with soft_tcam_scan_kernel.
+	 *
+	 * with a max stride, a node whose subtree down to the next k bits has
+	 * no wildcard branch becomes a multibit node that reads those k bits at
+	 * once and goes straight to one of 2^k children, the nodes below the
+	 * span. k is chosen per node, the largest one up to the max stride for
+	 * which at least half of the 2^k children are there.
+	 *
+	 * the rules the soft_tcam keeps in its soft_tcam_exact are copied
+	 * along and probed before the walk, as soft_tcam::find() does.
+	 */
+	template<class T, size_t size>
+	class soft_tcam_snapshot {
+
+	public:
+
+		typedef typename soft_tcam_bits<size>::key_type key_type;
+
+		/*
+		 * ctor
+		 *
+		 * huge and lock are passed to the soft_tcam_allocator of the
+		 * arrays. compile() uses those of its soft_tcam.
+		 */
+		soft_tcam_snapshot(bool huge = false, bool lock = false);
+
+		/*
+		 * find
+		 */
+		const T *find(const std::bitset<size> &key) const;
+		const T *find(const key_type &key) const;
+
+		/*
+		 * get_node_count
+		 */
+		size_t get_node_count() const;
+
+		/*
+		 * get_depth
+		 *
+		 * nodes on the longest path from the root.
+		 */
+		size_t get_depth() const;
+
+		/*
+		 * get_memory_size
+		 */
+		size_t get_memory_size() const;
+
+	private:
+
+		template<class, size_t, class> friend class soft_tcam;
+
+		struct node {
+			key_type data;
+			key_type mask;
+			std::uint32_t position;
+			std::uint32_t n0;
+			std::uint32_t n1;
+			std::uint32_t ndc;
+			std::uint32_t priority;
+			T object;
+		};
+
+		/*
+		 * a bucket node has this position, n0 is its first rule and n1 the
+		 * number of rules.
+		 */
+		static const std::uint32_t bucket_position = size + 1;
+
+		/*
+		 * a multibit node reading bits [p, p + n1) has position
+		 * multibit_position + p, n0 is the first of its children in
+		 * m_children.
+		 */
+		static const std::uint32_t multibit_position = size + 2;
+
+		std::vector<node, soft_tcam_allocator<node>> m_nodes;
+		std::vector<std::uint32_t, soft_tcam_allocator<std::uint32_t>> m_children;
+		std::vector<key_type, soft_tcam_allocator<key_type>> m_bucket_data;
+		std::vector<key_type, soft_tcam_allocator<key_type>> m_bucket_mask;
+		std::vector<std::uint32_t, soft_tcam_allocator<std::uint32_t>> m_bucket_priority;
+		std::vector<T, soft_tcam_allocator<T>> m_bucket_object;
+		soft_tcam_exact<T, size> m_exact;
+		soft_tcam_order<size> m_order;
+
+	};
+
+}
+
+#include "soft_tcam_snapshot.cc"
+
+#endif // SOFT_TCAM_SNAPSHOT_H
@@ -0,0 +1,393 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <utility>
+
+#include "soft_tcam_tuple.h"
+
+namespace soft_tcam {
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_tuple<T, size>::mask_hash::operator()(const key_type &mask) const
+	{
+		return soft_tcam_bits<size>::hash(mask);
+	}
+
+	template<class T, size_t size>
+	soft_tcam_tuple<T, size>::soft_tcam_tuple(bool bloom)
+	{
+		m_bloom = bloom;
+		m_entries = 0;
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_tuple<T, size>::insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+			const T &object)
+	{
+		return insert(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_tuple<T, size>::insert(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object)
+	{
+		std::uint64_t hash;
+		size_t index, i, cap;
+
+		if (!soft_tcam_bits<size>::is_valid(data, mask)) {
+			std::cerr << "insert: data/mask error." << std::endl;
+			return -1;
+		}
+
+		index = find_tuple(mask);
+		if (index == m_tuples.size()) {
+			m_index[mask] = index;
+			m_tuples.push_back(tuple());
+			m_tuples.back().mask = mask;
+			m_tuples.back().used = 0;
+			rehash(m_tuples.back(), min_slots);
+		}
+		tuple &t = m_tuples[index];
+
+		if ((t.used + 1) * 2 > t.slots.size()) {
+			rehash(t, t.slots.size() * 2);
+		}
+
+		hash = soft_tcam_bits<size>::hash(data);
+		cap = t.slots.size();
+		i = find_slot(t, data, hash);
+		if (i == cap) {
+			for (i = hash & (cap - 1); t.slots[i].used; i = (i + 1) & (cap - 1)) {
+			}
+			t.slots[i].data = data;
+			t.slots[i].hash = std::uint32_t(hash);
+			t.slots[i].used = true;
+			++t.used;
+			set_bloom(t, hash);
+		}
+
+		slot &s = t.slots[i];
+		auto it = std::upper_bound(s.rules.begin(), s.rules.end(), priority,
+				[](std::uint32_t p, const rule &r) { return p > r.priority; });
+		s.rules.insert(it, rule{priority, object});
+		s.priority = s.rules.front().priority;
+		s.object = s.rules.front().object;
+
+		if (priority > t.max_priority) {
+			t.max_priority = priority;
+		}
+		++m_entries;
+		sort_tuple(index);
+
+		return 0;
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_tuple<T, size>::erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+			const T &object)
+	{
+		return erase(soft_tcam_bits<size>::from_bitset(data), soft_tcam_bits<size>::from_bitset(mask),
+				priority, object);
+	}
+
+	template<class T, size_t size>
+	int
+	soft_tcam_tuple<T, size>::erase(const key_type &data, const key_type &mask, std::uint32_t priority,
+			const T &object)
+	{
+		size_t index, i;
+
+		index = find_tuple(mask);
+		if (index == m_tuples.size()) {
+			std::cerr << "erase: entry not found." << std::endl;
+			return -1;
+		}
+		tuple &t = m_tuples[index];
+
+		i = find_slot(t, data, soft_tcam_bits<size>::hash(data));
+		if (i == t.slots.size()) {
+			std::cerr << "erase: entry not found." << std::endl;
+			return -1;
+		}
+
+		slot &s = t.slots[i];
+		auto it = s.rules.begin();
+		while ((it != s.rules.end()) && ((it->priority != priority) || !(it->object == object))) {
+			++it;
+		}
+		if (it == s.rules.end()) {
+			std::cerr << "erase: entry not found." << std::endl;
+			return -1;
+		}
+		s.rules.erase(it);
+		--m_entries;
+
+		if (!s.rules.empty()) {
+			s.priority = s.rules.front().priority;
+			s.object = s.rules.front().object;
+		} else {
+			erase_slot(t, i);
+			--t.used;
+			if (t.used == 0) {
+				erase_tuple(index);
+				return 0;
+			}
+			if ((t.slots.size() > min_slots) && (t.used * 8 < t.slots.size())) {
+				rehash(t, t.slots.size() / 2);
+				sort_tuple(index);
+				return 0;
+			}
+		}
+
+		if (priority == t.max_priority) {
+			update_max_priority(t);
+			sort_tuple(index);
+		}
+
+		return 0;
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_tuple<T, size>::find(const std::bitset<size> &key) const
+	{
+		return find(soft_tcam_bits<size>::from_bitset(key));
+	}
+
+	template<class T, size_t size>
+	const T *
+	soft_tcam_tuple<T, size>::find(const key_type &key) const
+	{
+		const T *best = nullptr;
+		std::uint32_t best_priority = 0;
+		std::uint64_t hash;
+		key_type k;
+		size_t i;
+
+		for (auto it = m_tuples.begin(); it != m_tuples.end(); ++it) {
+			if ((best != nullptr) && (it->max_priority <= best_priority)) {
+				break;
+			}
+			k = key;
+			soft_tcam_bits<size>::intersect(k, it->mask);
+			hash = soft_tcam_bits<size>::hash(k);
+			if (m_bloom && !test_bloom(*it, hash)) {
+				continue;
+			}
+			i = find_slot(*it, k, hash);
+			if (i == it->slots.size()) {
+				continue;
+			}
+			if ((best == nullptr) || (it->slots[i].priority > best_priority)) {
+				best = &it->slots[i].object;
+				best_priority = it->slots[i].priority;
+			}
+		}
+
+		return best;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_tuple<T, size>::get_tuple_count() const
+	{
+		return m_tuples.size();
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_tuple<T, size>::get_entry_count() const
+	{
+		return m_entries;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_tuple<T, size>::get_memory_size() const
+	{
+		size_t bytes = m_tuples.size() * sizeof(tuple)
+			+ m_index.bucket_count() * sizeof(void *)
+			+ m_index.size() * (sizeof(std::pair<const key_type, size_t>) + sizeof(void *));
+
+		for (auto it = m_tuples.begin(); it != m_tuples.end(); ++it) {
+			bytes += it->slots.size() * sizeof(slot) + it->bloom.size() * sizeof(std::uint64_t);
+			for (auto s = it->slots.begin(); s != it->slots.end(); ++s) {
+				bytes += s->rules.capacity() * sizeof(rule);
+			}
+		}
+
+		return bytes;
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_tuple<T, size>::find_tuple(const key_type &mask) const
+	{
+		auto it = m_index.find(mask);
+
+		return (it != m_index.end()) ? it->second : m_tuples.size();
+	}
+
+	template<class T, size_t size>
+	size_t
+	soft_tcam_tuple<T, size>::find_slot(const tuple &t, const key_type &data, std::uint64_t hash) const
+	{
+		const slot *slots = t.slots.data();
+		size_t cap = t.slots.size();
+		size_t i;
+
+		/*
+		 * the table is at most half full so there is always an empty
+		 * slot to stop at.
+		 */
+		for (i = hash & (cap - 1); slots[i].used; i = (i + 1) & (cap - 1)) {
+			if ((slots[i].hash == std::uint32_t(hash)) && (slots[i].data == data)) {
+				return i;
+			}
+		}
+
+		return cap;
+	}
+
+	template<class T, size_t size>
+	bool
+	soft_tcam_tuple<T, size>::test_bloom(const tuple &t, std::uint64_t hash) const
+	{
+		size_t bits = t.bloom.size() * 64;
+		size_t b1 = (hash >> 24) & (bits - 1);
+		size_t b2 = (hash >> 44) & (bits - 1);
+
+		return ((t.bloom[b1 / 64] >> (b1 % 64)) & 1) && ((t.bloom[b2 / 64] >> (b2 % 64)) & 1);
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_tuple<T, size>::set_bloom(tuple &t, std::uint64_t hash)
+	{
+		size_t bits = t.bloom.size() * 64;
+		size_t b1 = (hash >> 24) & (bits - 1);
+		size_t b2 = (hash >> 44) & (bits - 1);
+
+		if (t.bloom.empty()) {
+			return;
+		}
+		t.bloom[b1 / 64] |= std::uint64_t(1) << (b1 % 64);
+		t.bloom[b2 / 64] |= std::uint64_t(1) << (b2 % 64);
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_tuple<T, size>::rehash(tuple &t, size_t count)
+	{
+		std::vector<slot> old;
+		std::uint64_t hash;
+		size_t i;
+
+		/*
+		 * a bloom filter can not forget erased rules, so it is rebuilt
+		 * here along with max_priority. 8 bits per slot.
+		 */
+		old.swap(t.slots);
+		t.slots.resize(count);
+		t.bloom.assign(m_bloom ? count / 8 : 0, 0);
+		t.max_priority = 0;
+
+		for (auto it = old.begin(); it != old.end(); ++it) {
+			if (!it->used) {
+				continue;
+			}
+			hash = soft_tcam_bits<size>::hash(it->data);
+			for (i = hash & (count - 1); t.slots[i].used; i = (i + 1) & (count - 1)) {
+			}
+			t.slots[i] = std::move(*it);
+			set_bloom(t, hash);
+			t.max_priority = std::max(t.max_priority, t.slots[i].priority);
+		}
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_tuple<T, size>::erase_slot(tuple &t, size_t index)
+	{
+		size_t mask = t.slots.size() - 1;
+		size_t i = index, j = index, k;
+
+		/*
+		 * move the following slots back so that no probe sequence is
+		 * broken by the hole.
+		 */
+		for (;;) {
+			j = (j + 1) & mask;
+			if (!t.slots[j].used) {
+				break;
+			}
+			k = t.slots[j].hash & mask;
+			if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j))) {
+				continue;
+			}
+			t.slots[i] = std::move(t.slots[j]);
+			i = j;
+		}
+		t.slots[i] = slot();
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_tuple<T, size>::update_max_priority(tuple &t)
+	{
+		std::uint32_t max_priority = 0;
+
+		/*
+		 * most tables give many rules the same priority, so the scan
+		 * usually stops at the first slot that still has the old one.
+		 */
+		for (auto it = t.slots.begin(); it != t.slots.end(); ++it) {
+			if (!it->used) {
+				continue;
+			}
+			if (it->priority == t.max_priority) {
+				return;
+			}
+			max_priority = std::max(max_priority, it->priority);
+		}
+		t.max_priority = max_priority;
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_tuple<T, size>::sort_tuple(size_t index)
+	{
+		while ((index > 0) && (m_tuples[index - 1].max_priority < m_tuples[index].max_priority)) {
+			std::swap(m_tuples[index - 1], m_tuples[index]);
+			m_index[m_tuples[index].mask] = index;
+			--index;
+		}
+		while ((index + 1 < m_tuples.size()) && (m_tuples[index + 1].max_priority > m_tuples[index].max_priority)) {
+			std::swap(m_tuples[index + 1], m_tuples[index]);
+			m_index[m_tuples[index].mask] = index;
+			++index;
+		}
+		m_index[m_tuples[index].mask] = index;
+	}
+
+	template<class T, size_t size>
+	void
+	soft_tcam_tuple<T, size>::erase_tuple(size_t index)
+	{
+		m_index.erase(m_tuples[index].mask);
+		m_tuples.erase(m_tuples.begin() + index);
+		for (; index < m_tuples.size(); ++index) {
+			m_index[m_tuples[index].mask] = index;
+		}
+	}
+
+}
@@ -0,0 +1,141 @@
+/*
+ * Author:
+ * 	Masakazu Asama <m-asama@ginzado.co.jp>
+ */
+
+#ifndef SOFT_TCAM_TUPLE_H
+#define SOFT_TCAM_TUPLE_H
+
+#include <cstdint>
+#include <bitset>
+#include <vector>
+#include <unordered_map>
+
+#include "soft_tcam_bits.h"
+
+namespace soft_tcam {
+
+	/*
+	 * soft_tcam_tuple
+	 *
+	 * tuple space search with the same interface as soft_tcam. the rules are
+	 * grouped by mask and every mask (tuple) has its own open addressing hash
+	 * table keyed by data. find looks up key & mask in each tuple, the tuple
+	 * with the highest priority first, and stops when no tuple left can beat
+	 * the best match. insert and erase find the tuple by its mask in an index
+	 * and touch one hash table only. this suits
+	 * tables with few distinct masks and many rules for each.
+	 */
+	template<class T, size_t size>
+	class soft_tcam_tuple {
+
+	public:
+
+		typedef typename soft_tcam_bits<size>::key_type key_type;
+
+		/*
+		 * ctor
+		 *
+		 * with bloom, each tuple also has a bloom filter that is checked
+		 * before its hash table.
+		 */
+		soft_tcam_tuple(bool bloom = false);
+
+		/*
+		 * insert
+		 */
+		int insert(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+				const T &object);
+		int insert(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * erase
+		 */
+		int erase(const std::bitset<size> &data, const std::bitset<size> &mask, std::uint32_t priority,
+				const T &object);
+		int erase(const key_type &data, const key_type &mask, std::uint32_t priority,
+				const T &object);
+
+		/*
+		 * find
+		 */
+		const T *find(const std::bitset<size> &key) const;
+		const T *find(const key_type &key) const;
+
+		/*
+		 * get_tuple_count
+		 */
+		size_t get_tuple_count() const;
+
+		/*
+		 * get_entry_count
+		 */
+		size_t get_entry_count() const;
+
+		/*
+		 * get_memory_size
+		 */
+		size_t get_memory_size() const;
+
+	private:
+
+		struct rule {
+			std::uint32_t priority;
+			T object;
+		};
+
+		/*
+		 * priority and object are those of rules[0], the best rule with
+		 * this data, so find does not look at rules.
+		 */
+		struct slot {
+			key_type data;
+			std::uint32_t hash;
+			bool used;
+			std::uint32_t priority;
+			T object;
+			std::vector<rule> rules;
+		};
+
+		/*
+		 * max_priority is the best priority in the tuple. erasing the last
+		 * rule with it looks for the next best, so find does not keep
+		 * probing a tuple that can no longer win.
+		 */
+		struct tuple {
+			key_type mask;
+			std::uint32_t max_priority;
+			size_t used;
+			std::vector<slot> slots;
+			std::vector<std::uint64_t> bloom;
+		};
+
+		struct mask_hash {
+			size_t operator()(const key_type &mask) const;
+		};
+
+		static const size_t min_slots = 8;
+
+		size_t find_tuple(const key_type &mask) const;
+		size_t find_slot(const tuple &t, const key_type &data, std::uint64_t hash) const;
+		bool test_bloom(const tuple &t, std::uint64_t hash) const;
+		void set_bloom(tuple &t, std::uint64_t hash);
+		void rehash(tuple &t, size_t count);
+		void erase_slot(tuple &t, size_t index);
+		void update_max_priority(tuple &t);
+		void sort_tuple(size_t index);
+		void erase_tuple(size_t index);
+
+		bool m_bloom;
+		std::vector<tuple> m_tuples;
+		std::unordered_map<key_type, size_t, mask_hash> m_index;
+		size_t m_entries;
+
+	};
+
+}
+
+#include "soft_tcam_tuple.cc"
+
+#endif // SOFT_TCAM_TUPLE_H
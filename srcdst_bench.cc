@@ -6,17 +6,137 @@
 #include <bitset>
 #include <iostream>
 #include <iomanip>
+#include <cstring>
+#include <vector>
+#include <algorithm>
 
 #include <time.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 
 #include "soft_tcam.h"
+#include "soft_tcam_cuts.h"
+#include "soft_tcam_rfc.h"
+#include "soft_tcam_forest.h"
+
+static const std::uint32_t cuts_binth = 8;
+static const double cuts_spfac = 4.0;
+static const std::uint64_t mixed_lim = 256;
+static const std::uint64_t mixed_miss = 0x0001000000000000;
+static const std::uint64_t mixed_filter = 0x0008000000000000;
+static const size_t dag_max_nodes = 1 << 20;
+
+/*
+ * the src/dst rules, a route for each dst, a filter for each src and a
+ * default route, in that order of priority. keys with mixed_miss set fall
+ * through to the dst routes. the src filters are for keys with
+ * mixed_filter set, so they only cost a walk.
+ */
+template<class table>
+static void
+load_mixed(table &t)
+{
+	for (std::uint64_t i = 0; i < mixed_lim; ++i) {
+		for (std::uint64_t j = 0; j < mixed_lim; ++j) {
+			t.insert(std::uint64_t((i << 52) + (j << 20)), std::uint64_t(0xffff0000ffff0000), 4,
+					std::uint64_t((i << 52) + (j << 20)));
+		}
+	}
+	for (std::uint64_t j = 0; j < mixed_lim; ++j) {
+		t.insert(std::uint64_t(j << 20), std::uint64_t(0x00000000fff00000), 3, std::uint64_t((j << 20) + 1));
+	}
+	for (std::uint64_t i = 0; i < mixed_lim; ++i) {
+		t.insert(std::uint64_t((i << 52) + mixed_filter), std::uint64_t(0xfff8000000000000), 2,
+				std::uint64_t((i << 52) + 2));
+	}
+	t.insert(std::uint64_t(0), std::uint64_t(0), 1, std::uint64_t(1));
+}
+
+template<class table>
+static double
+bench_mixed(table &t)
+{
+	const std::uint64_t *result;
+	struct rusage ru1, ru2;
+	std::uint64_t find_counter = 0, k;
+	double fps;
+
+	getrusage(RUSAGE_SELF, &ru1);
+
+	for (std::uint64_t c = 0; c < 100; ++c) {
+		for (std::uint64_t i = 0; i < mixed_lim; ++i) {
+			for (std::uint64_t j = 0; j < mixed_lim; ++j) {
+				k = (i << 52) + (j << 20) + (((i ^ j) & 1) ? mixed_miss : 0);
+				result = t.find(k);
+				if ((result == nullptr)
+				 || (*result != (((i ^ j) & 1) ? (j << 20) + 1 : k))) {
+					std::cout << "miss-match " << k << std::endl;
+					exit(1);
+				}
+				++find_counter;
+			}
+		}
+	}
+
+	getrusage(RUSAGE_SELF, &ru2);
+
+	timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
+	fps = ru2.ru_utime.tv_usec;
+	fps /= 1000000;
+	fps += ru2.ru_utime.tv_sec;
+
+	return find_counter / fps;
+}
+
+/*
+ * time of each lookup of one pass over the mixed keys, sorted. the clock
+ * is read around every lookup, so the times include its cost.
+ */
+template<class table>
+static std::vector<double>
+bench_mixed_latency(table &t)
+{
+	std::vector<double> times;
+	struct timespec ts1, ts2;
+	const std::uint64_t *result;
+	std::uint64_t k;
+
+	for (std::uint64_t i = 0; i < mixed_lim; ++i) {
+		for (std::uint64_t j = 0; j < mixed_lim; ++j) {
+			k = (i << 52) + (j << 20) + (((i ^ j) & 1) ? mixed_miss : 0);
+			clock_gettime(CLOCK_MONOTONIC, &ts1);
+			result = t.find(k);
+			clock_gettime(CLOCK_MONOTONIC, &ts2);
+			if (result == nullptr) {
+				exit(1);
+			}
+			times.push_back((ts2.tv_sec - ts1.tv_sec) * 1000000000.0 + (ts2.tv_nsec - ts1.tv_nsec));
+		}
+	}
+	std::sort(times.begin(), times.end());
+
+	return times;
+}
+
+template<class table>
+static void
+print_mixed_latency(table &t)
+{
+	std::vector<double> times = bench_mixed_latency(t);
+
+	std::cout << "Latency ns (p50, p99, max) = "
+		  << std::fixed << std::setprecision(0)
+		  << times[times.size() / 2] << ", "
+		  << times[times.size() * 99 / 100] << ", "
+		  << times.back()
+		  << std::setprecision(2)
+		  << std::endl;
+}
 
 int
 main(int argc, char *argv[])
 {
-	soft_tcam::soft_tcam<std::uint64_t, 64> *tcam;
+	soft_tcam::soft_tcam<std::uint64_t, 64, soft_tcam::soft_tcam_counter_enabled> *tcam;
 	const std::uint64_t *result;
 	struct rusage ru1, ru2;
 	std::uint64_t find_counter = 0;
@@ -24,18 +144,30 @@ main(int argc, char *argv[])
 
 	const int lim = 256;
 
-	if (argc != 2) {
+	if ((argc != 2) && (argc != 3)) {
 		std::cout << std::endl
 			  << "usage:" << std::endl
-			  << "        $ " << argv[0] << " sort" << std::endl
+			  << "        $ " << argv[0] << " sort [order]" << std::endl
 			  << std::endl
 			  << "where:" << std::endl
 			  << "           sort := [ \"none\" | \"best\" | \"worst\" ]" << std::endl
+			  << "          order := [ \"lsb\" | \"msb\" | \"interleave\" ] (default: lsb)" << std::endl
 			  << std::endl;
 		exit(1);
 	}
 
-	tcam = new soft_tcam::soft_tcam<std::uint64_t, 64>();
+	tcam = new soft_tcam::soft_tcam<std::uint64_t, 64, soft_tcam::soft_tcam_counter_enabled>();
+
+	if (argc == 3) {
+		if (!strncmp(argv[2], "msb", 4)) {
+			tcam->set_order(soft_tcam::soft_tcam_order<64>::msb_first());
+		} else if (!strncmp(argv[2], "interleave", 11)) {
+			tcam->set_order(soft_tcam::soft_tcam_order<64>::interleave({32, 32}));
+		} else if (strncmp(argv[2], "lsb", 4)) {
+			std::cout << "order arg error" << std::endl;
+			exit(1);
+		}
+	}
 
 	std::cout << "Inserting entries...";
 
@@ -43,7 +175,7 @@ main(int argc, char *argv[])
 
 	for (std::uint64_t i = 0; i < lim; ++i) {
 		for (std::uint64_t j = 0; j < lim; ++j) {
-			std::bitset<64> d((i << 52) + (j << 20)), m(0xffff0000ffff0000);
+			std::uint64_t d((i << 52) + (j << 20)), m(0xffff0000ffff0000);
 			tcam->insert(d, m, 1, std::uint64_t((i << 52) + (j << 20)));
 		}
 	}
@@ -57,19 +189,20 @@ main(int argc, char *argv[])
 	*/
 
 	std::cout << "Allocated soft_tcam_node = "
-		  << soft_tcam::soft_tcam_node<std::uint64_t, 64>::get_alloc_counter()
-		  << " ( " << (soft_tcam::soft_tcam_node<std::uint64_t, 64>::get_alloc_counter()
-					  * sizeof(soft_tcam::soft_tcam_node<std::uint64_t, 64>)) << " bytes)"
+		  << tcam->get_node_count()
+		  << " ( " << (tcam->get_node_count()
+					  * sizeof(soft_tcam::soft_tcam_node<std::uint64_t, 64, soft_tcam::soft_tcam_counter_enabled>)) << " bytes)"
 		  << std::endl;
 	std::cout << "Allocated soft_tcam_entry = "
-		  << soft_tcam::soft_tcam_entry<std::uint64_t, 64>::get_alloc_counter()
-		  << " ( " << (soft_tcam::soft_tcam_entry<std::uint64_t, 64>::get_alloc_counter()
-					  * sizeof(soft_tcam::soft_tcam_entry<std::uint64_t, 64>)) << " bytes)"
+		  << tcam->get_entry_count()
+		  << " ( " << (tcam->get_entry_count()
+					  * sizeof(soft_tcam::soft_tcam_entry<std::uint64_t, 64, soft_tcam::soft_tcam_counter_enabled>)) << " bytes)"
 		  << std::endl;
 
-	std::bitset<64> k(0x0123456789abcdef);
+	std::uint64_t k(0x0123456789abcdef);
 
-	soft_tcam::soft_tcam<std::uint64_t, 64>::clear_access_counter();
+	soft_tcam::soft_tcam<std::uint64_t, 64, soft_tcam::soft_tcam_counter_enabled>::clear_access_counter();
+	tcam->clear_visit_counter();
 
 	for (std::uint64_t j = 0; j < lim; ++j) {
 		for (std::uint64_t i = 0; i < lim; ++i) {
@@ -78,10 +211,15 @@ main(int argc, char *argv[])
 		}
 	}
 
+	std::cout << "Visited nodes per find = "
+		  << std::fixed << std::setprecision(2)
+		  << (double)tcam->get_visit_counter() / (lim * lim)
+		  << std::endl;
+
 	if (!strncmp(argv[1], "best", 5)) {
-		soft_tcam::soft_tcam<std::uint64_t, 64>::sort_best();
+		soft_tcam::soft_tcam<std::uint64_t, 64, soft_tcam::soft_tcam_counter_enabled>::sort_best();
 	} else if (!strncmp(argv[1], "worst", 6)) {
-		soft_tcam::soft_tcam<std::uint64_t, 64>::sort_worst();
+		soft_tcam::soft_tcam<std::uint64_t, 64, soft_tcam::soft_tcam_counter_enabled>::sort_worst();
 	} else if (!strncmp(argv[1], "none", 5)) {
 	} else {
 		std::cout << "sort arg error" << std::endl;
@@ -135,6 +273,210 @@ main(int argc, char *argv[])
 	fps += ru2.ru_utime.tv_sec;
 	fps = find_counter / fps;
 
+	std::cout << "Find counter = "
+		  << find_counter
+		  << std::endl;
+	std::cout << "Find per second = "
+		  << std::fixed << fps
+		  << std::endl;
+
+	std::vector<std::uint64_t> keys(lim);
+	std::vector<const std::uint64_t *> results(lim);
+
+	std::cout << "Finding entries in batches of " << lim << "...";
+
+	find_counter = 0;
+	getrusage(RUSAGE_SELF, &ru1);
+
+	for (std::uint64_t c = 0; c < 1000; ++c) {
+		for (std::uint64_t i = 0; i < lim; ++i) {
+			for (std::uint64_t j = 0; j < lim; ++j) {
+				keys[j] = (i << 52) + (j << 20);
+			}
+			tcam->find_batch(keys.data(), lim, results.data());
+			find_counter += lim;
+		}
+	}
+
+	getrusage(RUSAGE_SELF, &ru2);
+
+	std::cout << "done." << std::endl;
+
+	timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
+	fps = ru2.ru_utime.tv_usec;
+	fps /= 1000000;
+	fps += ru2.ru_utime.tv_sec;
+	fps = find_counter / fps;
+
+	std::cout << "Find counter = "
+		  << find_counter
+		  << std::endl;
+	std::cout << "Find per second = "
+		  << std::fixed << fps
+		  << std::endl;
+
+	{
+		soft_tcam::soft_tcam<std::uint64_t, 64> mixed;
+		soft_tcam::soft_tcam_forest<std::uint64_t, 64> forest({32, 32});
+
+		load_mixed(mixed);
+		load_mixed(forest);
+
+		std::cout << "Mixed src/dst, dst, src and default rules = "
+			  << forest.get_entry_count()
+			  << std::endl;
+		std::cout << "Find per second (mixed, tcam) = "
+			  << std::fixed << bench_mixed(mixed)
+			  << std::endl;
+		print_mixed_latency(mixed);
+
+		soft_tcam::soft_tcam_snapshot<std::uint64_t, 64> snapshot = mixed.compile();
+		std::cout << "Compiled snapshot = "
+			  << snapshot.get_node_count()
+			  << " ( " << snapshot.get_memory_size() << " bytes, depth "
+			  << snapshot.get_depth() << ")"
+			  << std::endl;
+		std::cout << "Find per second (mixed, snapshot) = "
+			  << std::fixed << bench_mixed(snapshot)
+			  << std::endl;
+		print_mixed_latency(snapshot);
+
+		soft_tcam::soft_tcam_snapshot<std::uint64_t, 64> dag = mixed.compile_dag(dag_max_nodes);
+		std::cout << "Compiled dag snapshot = "
+			  << dag.get_node_count()
+			  << " ( " << dag.get_memory_size() << " bytes, depth "
+			  << dag.get_depth() << ", max nodes " << dag_max_nodes << ")"
+			  << std::endl;
+		std::cout << "Find per second (mixed, dag snapshot) = "
+			  << std::fixed << bench_mixed(dag)
+			  << std::endl;
+		print_mixed_latency(dag);
+		std::cout << "Forest partitions = "
+			  << forest.get_partition_count()
+			  << std::endl;
+		forest.dump();
+		std::cout << "Find per second (mixed, forest) = "
+			  << std::fixed << bench_mixed(forest)
+			  << std::endl;
+	}
+
+	soft_tcam::soft_tcam_cuts<std::uint64_t, 64> cuts({32, 32});
+
+	std::cout << "Building cuts (binth " << cuts_binth << ", spfac " << cuts_spfac << ")...";
+	std::cout.flush();
+
+	getrusage(RUSAGE_SELF, &ru1);
+
+	cuts.build(*tcam, cuts_binth, cuts_spfac);
+
+	getrusage(RUSAGE_SELF, &ru2);
+
+	std::cout << "done." << std::endl;
+
+	timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
+	std::cout << "Build seconds = "
+		  << std::fixed << (ru2.ru_utime.tv_sec + ru2.ru_utime.tv_usec / 1000000.0)
+		  << std::endl;
+	std::cout << "Cuts nodes = "
+		  << cuts.get_node_count()
+		  << " ( " << cuts.get_memory_size() << " bytes, "
+		  << cuts.get_rule_count() << " rules, depth " << cuts.get_depth() << ")"
+		  << std::endl;
+
+	std::cout << "Finding entries with cuts...";
+
+	find_counter = 0;
+	getrusage(RUSAGE_SELF, &ru1);
+
+	for (std::uint64_t c = 0; c < 1000; ++c) {
+		for (std::uint64_t i = 0; i < lim; ++i) {
+			for (std::uint64_t j = 0; j < lim; ++j) {
+				k = (i << 52) + (j << 20);
+				result = cuts.find(k);
+				if ((result == nullptr) || (*result != k)) {
+					std::cout << "miss-match " << k << std::endl;
+					exit(1);
+				}
+				++find_counter;
+			}
+		}
+	}
+
+	getrusage(RUSAGE_SELF, &ru2);
+
+	std::cout << "done." << std::endl;
+
+	timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
+	fps = ru2.ru_utime.tv_usec;
+	fps /= 1000000;
+	fps += ru2.ru_utime.tv_sec;
+	fps = find_counter / fps;
+
+	std::cout << "Find counter = "
+		  << find_counter
+		  << std::endl;
+	std::cout << "Find per second = "
+		  << std::fixed << fps
+		  << std::endl;
+
+	soft_tcam::soft_tcam_rfc<std::uint64_t, 64> rfc;
+
+	std::cout << "Building rfc...";
+	std::cout.flush();
+
+	/*
+	 * the build runs on several threads, so take the wall clock time.
+	 */
+	struct timeval tv1, tv2;
+	gettimeofday(&tv1, nullptr);
+
+	if (rfc.build(*tcam) != 0) {
+		std::cout << "failed." << std::endl;
+		return 0;
+	}
+
+	gettimeofday(&tv2, nullptr);
+
+	std::cout << "done." << std::endl;
+
+	timersub(&tv2, &tv1, &tv2);
+	std::cout << "Build seconds = "
+		  << std::fixed << (tv2.tv_sec + tv2.tv_usec / 1000000.0)
+		  << std::endl;
+	std::cout << "Rfc tables = "
+		  << rfc.get_table_count()
+		  << " ( " << rfc.get_memory_size() << " bytes)"
+		  << std::endl;
+
+	std::cout << "Finding entries with rfc...";
+
+	find_counter = 0;
+	getrusage(RUSAGE_SELF, &ru1);
+
+	for (std::uint64_t c = 0; c < 1000; ++c) {
+		for (std::uint64_t i = 0; i < lim; ++i) {
+			for (std::uint64_t j = 0; j < lim; ++j) {
+				k = (i << 52) + (j << 20);
+				result = rfc.find(k);
+				if ((result == nullptr) || (*result != k)) {
+					std::cout << "miss-match " << k << std::endl;
+					exit(1);
+				}
+				++find_counter;
+			}
+		}
+	}
+
+	getrusage(RUSAGE_SELF, &ru2);
+
+	std::cout << "done." << std::endl;
+
+	timersub(&ru2.ru_utime, &ru1.ru_utime, &ru2.ru_utime);
+	fps = ru2.ru_utime.tv_usec;
+	fps /= 1000000;
+	fps += ru2.ru_utime.tv_sec;
+	fps = find_counter / fps;
+
 	std::cout << "Find counter = "
 		  << find_counter
 		  << std::endl;